@@ -0,0 +1,310 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*   . */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "system.h"
+#include "misc.h"
+#include "sha256.h"
+#include "cache.h"
+
+/*       . */
+#define CACHE_BUFSIZE 65536
+
+/*  ( )  ,    
+ *     . */
+#define CACHE_TMP_AGE 3600
+
+/*  ,     . */
+struct cache_entry {
+	char name[CACHE_KEY_SIZE];
+	off_t size;
+	time_t mtime;
+};
+
+/*   #src   #dst.  0   . */
+static int
+copy_path( const char *src, const char *dst )
+{
+	FILE *in, *out;
+	char *buf;
+	size_t rd;
+	int ret = 0;
+
+	buf = malloc( CACHE_BUFSIZE );
+	if ( !buf ) return 1;
+
+	in = fopen( src, "rb" );
+	if ( !in ) {
+		free( buf );
+		return 1;
+	}
+	out = fopen( dst, "wb" );
+	if ( !out ) {
+		fclose( in );
+		free( buf );
+		return 1;
+	}
+
+	while ( (rd = fread( buf, 1, CACHE_BUFSIZE, in )) > 0 ) {
+		if ( fwrite( buf, 1, rd, out ) != rd ) {
+			ret = 1;
+			break;
+		}
+	}
+	if ( ferror( in ) ) ret = 1;
+
+	fclose( in );
+	if ( fclose( out ) ) ret = 1;
+	free( buf );
+
+	if ( ret ) unlink( dst );
+	return ret;
+}
+
+/* ,    #name    . */
+static int
+has_key( const char *name )
+{
+	int i;
+
+	for ( i = 0; i < CACHE_KEY_SIZE - 1; i++ ) {
+		if ( !((name[i] >= '0' && name[i] <= '9') ||
+			   (name[i] >= 'a' && name[i] <= 'f')) )
+			return 0;
+	}
+
+	return 1;
+}
+
+/* ,    #name   . */
+static int
+is_key( const char *name )
+{
+	return has_key( name ) && name[CACHE_KEY_SIZE - 1] == '\0';
+}
+
+/* ,    #name    
+ * (.<>.< >, . cache_store()). */
+static int
+is_tmp( const char *name )
+{
+	const char *p;
+
+	if ( name[0] != '.' || !has_key( name + 1 ) )
+		return 0;
+	p = name + CACHE_KEY_SIZE;
+	if ( *p++ != '.' || *p == '\0' )
+		return 0;
+	for ( ; *p; p++ )
+		if ( *p < '0' || *p > '9' )
+			return 0;
+
+	return 1;
+}
+
+/*      . */
+static int
+cmp_mtime( const void *a, const void *b )
+{
+	const struct cache_entry *ea = a;
+	const struct cache_entry *eb = b;
+
+	if ( ea->mtime < eb->mtime ) return -1;
+	if ( ea->mtime > eb->mtime ) return 1;
+	return strcmp( ea->name, eb->name );
+}
+
+/*        #dir, 
+ *     #limit  (0 ---  ),
+ *   ,   . */
+static void
+cache_trim( const char *dir, unsigned long long limit )
+{
+	DIR *d;
+	struct dirent *de;
+	struct stat st;
+	struct cache_entry *entries = NULL, *p;
+	size_t count = 0, alloc = 0, i;
+	unsigned long long total = 0;
+	char path[MAXLINE];
+	time_t now;
+
+	d = opendir( dir );
+	if ( !d ) return;
+
+	now = time( NULL );
+	while ( (de = readdir( d )) != NULL ) {
+		/*  ,    ,   
+		 *   . */
+		if ( is_tmp( de->d_name ) ) {
+			snprintf( path, sizeof(path), "%s/%s", dir, de->d_name );
+			if ( stat( path, &st ) == 0 &&
+				 st.st_mtime + CACHE_TMP_AGE < now )
+				unlink( path );
+			continue;
+		}
+		if ( !is_key( de->d_name ) ) continue;
+		snprintf( path, sizeof(path), "%s/%s", dir, de->d_name );
+		if ( stat( path, &st ) != 0 ) continue;
+		if ( count == alloc ) {
+			alloc = alloc ? 2 * alloc : 64;
+			p = realloc( entries, alloc * sizeof(*entries) );
+			if ( !p ) break;
+			entries = p;
+		}
+		strcpy( entries[count].name, de->d_name );
+		entries[count].size = st.st_size;
+		entries[count].mtime = st.st_mtime;
+		total += st.st_size;
+		count++;
+	}
+	closedir( d );
+
+	if ( limit && total > limit ) {
+		qsort( entries, count, sizeof(*entries), cmp_mtime );
+		for ( i = 0; i < count && total > limit; i++ ) {
+			snprintf( path, sizeof(path), "%s/%s", dir, entries[i].name );
+			if ( unlink( path ) == 0 )
+				total -= entries[i].size;
+		}
+	}
+
+	free( entries );
+}
+
+int
+cache_key( const char *file_name, const char *options, char *key )
+{
+	struct sha256 s;
+	unsigned char digest[SHA256_SIZE];
+	unsigned char len[8];
+	unsigned char *buf;
+	FILE *f;
+	size_t rd;
+	uint64_t n;
+	int ret = 0;
+	int i;
+
+	buf = malloc( CACHE_BUFSIZE );
+	if ( !buf ) return 1;
+
+	f = fopen( file_name, "rb" );
+	if ( !f ) {
+		free( buf );
+		return 1;
+	}
+
+	/*    (8 ,    )  
+	 *    . */
+	sha256_init( &s );
+	n = strlen( options );
+	for ( i = 0; i < 8; i++ )
+		len[i] = (unsigned char) (n >> (8 * i));
+	sha256_update( &s, len, sizeof(len) );
+	sha256_update( &s, options, n );
+	while ( (rd = fread( buf, 1, CACHE_BUFSIZE, f )) > 0 ) {
+		sha256_update( &s, buf, rd );
+	}
+	if ( ferror( f ) ) ret = 1;
+	fclose( f );
+	free( buf );
+
+	sha256_final( &s, digest );
+	sha256_hex( digest, key );
+
+	return ret;
+}
+
+int
+cache_fetch( const char *dir, const char *key, const char *dest )
+{
+	char path[MAXLINE];
+
+	snprintf( path, sizeof(path), "%s/%s", dir, key );
+	if ( access( path, R_OK ) != 0 ) return 1;
+
+	if ( copy_path( path, dest ) != 0 ) return 1;
+
+	/*      ţ . */
+	utime( path, NULL );
+
+	return 0;
+}
+
+int
+cache_store( const char *dir, const char *key, const char *src,
+			 unsigned long long limit )
+{
+	char path[MAXLINE];
+	char tmp[MAXLINE];
+
+#ifdef __MINGW32__
+	if ( mkdir( dir ) != 0 && errno != EEXIST ) return 1;
+#else
+	if ( mkdir( dir, 0777 ) != 0 && errno != EEXIST ) return 1;
+#endif
+
+	/*     ,    
+	 * ,   :   
+	 *   ,  . */
+	snprintf( path, sizeof(path), "%s/%s", dir, key );
+	snprintf( tmp, sizeof(tmp), "%s/.%s.%lu", dir, key,
+			  (unsigned long) getpid() );
+	if ( copy_path( src, tmp ) != 0 ) return 1;
+	if ( rename( tmp, path ) != 0 ) {
+		unlink( tmp );
+		return 1;
+	}
+
+	cache_trim( dir, limit );
+
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __CACHE_H
+#define __CACHE_H
+
+/*   .
+ *
+ *         ,
+ *  :  SHA-256    
+ *     .    
+ *         
+ *  .    ( 
+ *   ),      
+ *  ,     .
+ *  ,   , , 
+ *    .
+ */
+
+#include <sys/types.h>
+
+/*    ,   . */
+#define CACHE_KEY_SIZE 65
+
+/**
+ *   #key    #file_name  
+ *  #options.  0     -0, 
+ *     .
+ */
+int cache_key( const char *file_name, const char *options, char *key );
+
+/**
+ *   #key   #dir   #dest  
+ * ţ  .  0,    
+ * .
+ */
+int cache_fetch( const char *dir, const char *key, const char *dest );
+
+/**
+ *   #src   #dir   #key, 
+ *   . ,    #limit
+ * ( ),     ,  
+ *    ,     
+ * .  0   .
+ */
+int cache_store( const char *dir, const char *key, const char *src,
+				 unsigned long long limit );
+
+#endif /* __CACHE_H */
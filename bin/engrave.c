@@ -55,9 +55,24 @@
 #include <tiffio.h>
 #include <math.h>
 #include "misc.h"	/*   */
+#include "smp.h"	/*   ޣ */
+#include "tiffin.h"	/*  TIFF  */
+#include "readahead.h"	/*   */
+#include "stats.h"	/*  */
+#include "cache.h"	/*   */
+#include "aout.h"	/*   */
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #ifdef WITH_PDFWRITER
 #include "pdfwriter.h"
+#include "weightfunc.h"	/*    PDF */
+#endif
+
+#ifndef __MINGW32__
+#include "serve.h"	/*   */
 #endif
 
 #define EXIT_FAILURE 1
@@ -68,6 +83,17 @@ char *program_name;
 /*    getopt_long */
 enum {DUMMY_KEY=129
      ,BRIEF_KEY
+     ,SERVE_KEY
+     ,DECODE_THREADS_KEY
+     ,READ_AHEAD_KEY
+     ,ENCODE_AHEAD_KEY
+     ,IO_DEPTH_KEY
+     ,STATS_KEY
+     ,PDF_ENCODING_KEY
+     ,COMBINE_KEY
+     ,CACHE_KEY
+     ,CACHE_LIMIT_KEY
+     ,BITS_KEY
 };
 
 /* ,   . */
@@ -95,6 +121,7 @@ int miniswhite;	/* 
 float hres;	/*        */
 float vres;	/*        */
 int is_cmyk;	/*     4  */
+int sample_bits;	/*  ޣ: 8  16 */
 
 /*       
  *  . */
@@ -112,6 +139,13 @@ int want_intensity;
 /*    ; */
 char filter[MAXLINE] = "";
 
+/*     . */
+#define MAX_FILTERS 32
+
+/*     :  
+ *    (. describe_filter()). */
+static int feed_filters = 1;
+
 /*      */
 char filterdir[MAXLINE];
 char psdir[MAXLINE]; /*    PostScript  */
@@ -122,10 +156,100 @@ int want_preview;	/* 
 /*   . */
 int want_test_run = 0;
 
+/*   ,     
+ * (0 --  ). */
+unsigned long batch_rows = 0;
+
+/*      TIFF. */
+int decode_threads = 1;
+
+/*        (0 -- 
+ *   ). */
+int read_ahead = 0;
+
+/*    ϣ     
+ *   (0 --     ). */
+int encode_ahead = 0;
+
+/*       (0 -- 
+ *   stdio). */
+int io_depth = 0;
+
+/*      JSON. */
+int want_stats = 0;
+
+/*     ϣ,   . */
+#define STATS_MAX_FILTERS 32
+#define STATS_MAX_LAYERS 256
+#define STATS_MAX_FILTER_LAYERS 16
+
+/*    . */
+struct job_stats {
+  double start;		/*   . */
+  double user0, sys0;	/*     . */
+  double cuser0, csys0;	/*     . */
+  unsigned long long bytes_in;	/* ߣ ,  . */
+
+  /*  . */
+  struct stats_timer decode;	/*  () . */
+  struct stats_timer transfer;	/*   . */
+  struct stats_timer filter_wait;	/*   . */
+  struct stats_timer preview;	/*  . */
+  struct stats_timer assembly;	/*  ϣ. */
+  struct stats_timer finalize;	/*    (PDF). */
+
+  /* ,   . */
+  int filter_count;
+  struct {
+	char name[64];
+	double wall, user, sys, encode;
+	int valid;
+	/*     . */
+	int layer_count;
+	struct {
+	  char kind[16];
+	  double encode;
+	  long long bytes;
+	} layers[STATS_MAX_FILTER_LAYERS];
+  } filters[STATS_MAX_FILTERS];
+
+  /*  ϣ . */
+  int layer_count;
+  struct {
+	char fsuf[4];
+	int fidx;
+	int color_idx;
+	long long bytes;
+  } layers[STATS_MAX_LAYERS];
+};
+
+/*   . */
+static struct job_stats jstats;
+
 /*  */
 typedef enum { EPS_FMT, TIFF_FMT, PDF_FMT } outformat_t;
 outformat_t outformat = EPS_FMT;
 
+/*   ϣ PDF:    (native) 
+ *   TIFF (tiff). */
+typedef enum { PDF_ENC_JBIG2, PDF_ENC_G4, PDF_ENC_GLYPHS,
+			   PDF_ENC_TIFF } pdf_encoding_t;
+pdf_encoding_t pdf_encoding = PDF_ENC_JBIG2;
+
+/*   PDF-,    
+ *  ( --     ). */
+char combine_name[MAXLINE] = "";
+/*   PDF-. */
+void *combine_pdfctx = NULL;
+
+/*      . */
+char serve_path[MAXLINE] = "";
+
+/*    ( --   ). */
+char cache_dir[MAXLINE] = "";
+/*      (0 --  ). */
+unsigned long cache_limit = 1024;
+
 /*      */
 static struct option const long_options[] =
 {
@@ -139,6 +263,7 @@ static struct option const long_options[] =
 	{"height", required_argument, NULL, 'h'},
 	{"hres", required_argument, NULL, 'x'},
 	{"vres", required_argument, NULL, 'y'},
+	{"bits", required_argument, NULL, BITS_KEY},
 	{"cmyk", optional_argument, NULL, 'c'},
 	{"density", no_argument, NULL, 'D'},
 	{"intensity", no_argument, NULL, 'I'},
@@ -150,9 +275,85 @@ static struct option const long_options[] =
 	{"preview", no_argument, NULL, 'p'},
 	{"test-run", no_argument, NULL, 'T'},
 	{"format", required_argument, NULL, 't'},
+	{"batch-rows", required_argument, NULL, 'B'},
+	{"serve", required_argument, NULL, SERVE_KEY},
+	{"decode-threads", required_argument, NULL, DECODE_THREADS_KEY},
+	{"read-ahead", required_argument, NULL, READ_AHEAD_KEY},
+	{"encode-ahead", required_argument, NULL, ENCODE_AHEAD_KEY},
+	{"io-depth", required_argument, NULL, IO_DEPTH_KEY},
+	{"stats", required_argument, NULL, STATS_KEY},
+	{"pdf-encoding", required_argument, NULL, PDF_ENCODING_KEY},
+	{"combine", required_argument, NULL, COMBINE_KEY},
+	{"cache", required_argument, NULL, CACHE_KEY},
+	{"cache-limit", required_argument, NULL, CACHE_LIMIT_KEY},
 	{NULL, 0, NULL, 0}
 };
 
+/*   ,    . */
+struct prolog {
+	char path[MAXLINE];	/*   . */
+	char *data;	/* . */
+	size_t len;	/*  . */
+	struct prolog *next;
+};
+
+/*   ,    . */
+static struct prolog *prologs = NULL;
+
+/*    PostScript-   #dir
+ *  .    ,    
+ *  . */
+static void
+load_prologs( const char *dir )
+{
+	DIR *d;
+	struct dirent *ent;
+	struct prolog *pr;
+	FILE *f;
+	long len;
+	size_t nl;
+
+	d = opendir( dir );
+	if ( d == NULL ) return;
+
+	while ( (ent = readdir( d )) != NULL ) {
+		nl = strlen( ent->d_name );
+		if ( nl < 4 || strcmp( ent->d_name + nl - 3, ".ps" ) != 0 )
+			continue;
+
+		pr = calloc( 1, sizeof(struct prolog) );
+		if ( pr == NULL ) break;
+		strcpy( pr->path, dir );
+		pathcat( pr->path, ent->d_name );
+
+		f = fopen( pr->path, "r" );
+		if ( f == NULL ) {
+			free( pr );
+			continue;
+		}
+		fseek( f, 0, SEEK_END );
+		len = ftell( f );
+		fseek( f, 0, SEEK_SET );
+		pr->data = malloc( len > 0 ? len : 1 );
+		if ( pr->data != NULL )
+			pr->len = fread( pr->data, 1, len > 0 ? len : 0, f );
+		fclose( f );
+
+		if ( pr->data == NULL ) {
+			free( pr );
+			continue;
+		}
+
+		if ( want_verbose )
+			fprintf( stderr, "Preloaded file %s\n", pr->path );
+
+		pr->next = prologs;
+		prologs = pr;
+	}
+
+	closedir( d );
+}
+
 /*         .
  * ,    ̣. */
 static void
@@ -160,6 +361,17 @@ dump_file( FILE *out, const char *fn )
 {
 	FILE *f = NULL;
 	static char str[MAXLINE];
+	struct prolog *pr;
+
+	/* ,  ,   . */
+	for ( pr = prologs; pr != NULL; pr = pr->next ) {
+		if ( strcmp( pr->path, fn ) == 0 ) {
+			if (want_verbose)
+				fprintf(stderr, "Including file %s\n", fn);
+			fwrite( pr->data, 1, pr->len, out );
+			return;
+		}
+	}
 
 	/*       
 	 *  . */
@@ -199,10 +411,12 @@ dump_file( FILE *out, const char *fn )
  * :
  * buf --     ;
  * ss --    ;
+ * smp --  ޣ   (16- ޣ
+ *          8-);
  * width --     ;
  * thumbnail_buf --    ;
  * thumbnail_width --    . */
-void get_thumbnail_line(char *buf, size_t ss, size_t width, \
+void get_thumbnail_line(char *buf, size_t ss, size_t smp, size_t width, \
 			char *thumbnail_buf, size_t thumbnail_width) {
 
 	double x = 0;
@@ -217,8 +431,11 @@ void get_thumbnail_line(char *buf, size_t ss, size_t width, \
 	for (sx = 0; sx < thumbnail_width; sx++) {
 		i = ss*rint(x);
 		x += step;
-		memcpy(thumbnail_buf, buf+i, ss);
-		thumbnail_buf += ss;
+		if (smp == 2)
+			smp16to8(thumbnail_buf, buf+i, ss/2);
+		else
+			memcpy(thumbnail_buf, buf+i, ss);
+		thumbnail_buf += ss/smp;
 	}
 }
 
@@ -246,6 +463,8 @@ Options:\n\
   -h HEIGHT, --height=HEIGHT	and height\n\
   -x HRES, --hres=HRES		RAW image horizontal\n\
   -y VRES, --vres=VRES		and vertical resolution\n\
+  --bits=BITS			RAW image samples are BITS wide (8,\n\
+                                default, or 16)\n\
   -c [CMYK], --cmyk[=CMYK]	image is CMYK; optionally selects\n\
                                 individual colorants;\n\
   -D, --density			input and output data is DENSITY\n\
@@ -261,7 +480,32 @@ Options:\n\
                                 (default 'eps')\n\
   -p, --preview			add preview image to the EPS\n\
   -T, --test-run        keep temporary files\n\
-  -t FMT, --format=FMT  output format (eps, tiff)\n\
+  -t FMT, --format=FMT  output format (eps, tiff, pdf)\n\
+  --pdf-encoding=ENC		encode PDF bitmap layers as JBIG2\n\
+                                (jbig2, default) or CCITT G4 (g4)\n\
+                                streams, draw tiles with Type 3 font\n\
+                                glyphs (glyphs), or pass layers as\n\
+                                TIFF (tiff)\n\
+  --combine=FILE		write all images as pages of the single\n\
+                                PDF FILE\n\
+  --cache=DIR			reuse results of identical jobs stored\n\
+                                in DIR\n\
+  --cache-limit=MB		limit the cache size to MB megabytes\n\
+                                (default is 1024, 0 is unlimited)\n\
+  -B ROWS, --batch-rows=ROWS	transfer ROWS scanlines to the filters\n\
+                                at once (default is auto)\n\
+  --decode-threads=N		decode compressed TIFF input in N\n\
+                                threads (default is 1)\n\
+  --read-ahead=N		decode up to N batches of scanlines\n\
+                                ahead in a separate thread\n\
+  --encode-ahead=N		let the filters encode layers in\n\
+                                separate threads, queueing up to N\n\
+                                blocks of operations\n\
+  --io-depth=N			write output and layer files through N\n\
+                                large buffers in flight (io_uring or\n\
+                                pwrite)\n\
+  --stats=json			print per-stage timing statistics\n\
+  --serve=SOCK			accept jobs over the Unix socket SOCK\n\
   -H, --help			display this help and exit\n\
   -v, --verbose			verbose message output\n\
   -V, --version			output version information and exit\n\
@@ -347,6 +591,7 @@ decode_switches (int argc, char **argv)
   height = 0;
   vres = 0;
   hres = 0;
+  sample_bits = 8;
   miniswhite = 0;
   want_verbose = 0;
   want_quiet = 0;
@@ -357,6 +602,16 @@ decode_switches (int argc, char **argv)
   want_preview = 0;
   want_test_run = 0;
   outformat = EPS_FMT;
+  batch_rows = 0;
+  decode_threads = 1;
+  read_ahead = 0;
+  encode_ahead = 0;
+  io_depth = 0;
+  want_stats = 0;
+  pdf_encoding = PDF_ENC_JBIG2;
+  combine_name[0] = '\0';
+  cache_dir[0] = '\0';
+  cache_limit = 1024;
 
   /*        getopt_long. */
   while ((c = getopt_long (argc, argv, 
@@ -379,6 +634,7 @@ decode_switches (int argc, char **argv)
 			   "O:" /* output suffix */
 			   "p"  /* add preview */
 			   "T"  /* test run */
+			   "B:"  /* batch rows */
 			   "t:", /* output format */
 			   long_options, &option_index)) != EOF)
     {
@@ -534,6 +790,111 @@ decode_switches (int argc, char **argv)
 	case 'f':
 		return decode_filter_switches(argc, argv);
 
+	/*     . */
+	case 'B':
+		batch_rows = strtoul(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || strchr(optarg, '-') != NULL) {
+			fprintf(stderr, "%s", "Batch rows value is invalid.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*     TIFF. */
+	case DECODE_THREADS_KEY:
+		decode_threads = strtol(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || decode_threads < 1) {
+			fprintf(stderr, "%s", "Decode threads value is invalid.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*     . */
+	case READ_AHEAD_KEY:
+		read_ahead = strtol(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || read_ahead < 0) {
+			fprintf(stderr, "%s", "Read-ahead value is invalid.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*      . */
+	case ENCODE_AHEAD_KEY:
+		encode_ahead = strtol(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || encode_ahead < 0) {
+			fprintf(stderr, "%s", "Encode-ahead value is invalid.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*      . */
+	case IO_DEPTH_KEY:
+		io_depth = strtol(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || io_depth < 0) {
+			fprintf(stderr, "%s", "I/O depth value is invalid.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*   . */
+	case STATS_KEY:
+		if (strcmp(optarg, "json") != 0) {
+			fprintf(stderr, "Unsupported statistics format: %s\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+		want_stats = 1;
+		break;
+
+	/*    ϣ PDF. */
+	case PDF_ENCODING_KEY:
+		if (strcmp(optarg, "jbig2") == 0 ||
+			strcmp(optarg, "native") == 0) {
+			pdf_encoding = PDF_ENC_JBIG2;
+		} else if (strcmp(optarg, "g4") == 0) {
+			pdf_encoding = PDF_ENC_G4;
+		} else if (strcmp(optarg, "glyphs") == 0) {
+			pdf_encoding = PDF_ENC_GLYPHS;
+		} else if (strcmp(optarg, "tiff") == 0) {
+			pdf_encoding = PDF_ENC_TIFF;
+		} else {
+			fprintf(stderr, "Unsupported PDF encoding: %s\n", optarg);
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*      PDF-. */
+	case COMBINE_KEY:
+		snprintf(combine_name, sizeof(combine_name), "%s", optarg);
+		outformat = PDF_FMT;
+		break;
+
+	/*  ޣ  . */
+	case BITS_KEY:
+		sample_bits = strtoul(optarg, &endptr, 0);
+		if (*endptr != '\0' || (sample_bits != 8 && sample_bits != 16)) {
+			fprintf(stderr, "%s", "Sample bits value should be 8 or 16.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*    . */
+	case CACHE_KEY:
+		snprintf(cache_dir, sizeof(cache_dir), "%s", optarg);
+		break;
+
+	/*    . */
+	case CACHE_LIMIT_KEY:
+		cache_limit = strtoul(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0') {
+			fprintf(stderr, "%s", "Cache limit value is invalid.\n");
+			exit(EXIT_FAILURE);
+		}
+		break;
+
+	/*   . */
+	case SERVE_KEY:
+	  snprintf(serve_path, sizeof(serve_path), "%s", optarg);
+	  break;
+
 	/*
 	 *   (   ).
 	 */
@@ -574,13 +935,181 @@ decode_switches (int argc, char **argv)
   return optind;
 }
 
+#ifdef HAVE_SYS_MMAN_H
+/*       #f
+ *  #size    . 
+ *     NULL,     
+ * ֣ (,  ). */
+static char *
+map_raw_file(FILE *f, size_t size)
+{
+  struct stat st;
+  void *map;
+
+  if (fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode) || size == 0)
+	  return NULL;
+
+  if (st.st_size < size) {
+	  fprintf(stderr, "Image stream suddenly closed.\n");
+	  exit(EXIT_FAILURE);
+  }
+
+  map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+  if (map == MAP_FAILED)
+	  return NULL;
+
+  madvise(map, size, MADV_SEQUENTIAL);
+
+  return map;
+}
+
+/*    #map  #f, 
+ *  #end,    #*released.  
+ *     ,     . */
+static void
+release_raw_map(char *map, FILE *f, size_t *released, size_t end)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+
+  end -= end % page;
+  if (end <= *released)
+	  return;
+
+  madvise(map + *released, end - *released, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+  posix_fadvise(fileno(f), *released, end - *released, POSIX_FADV_DONTNEED);
+#endif
+  *released = end;
+}
+#endif
+
+/*    . */
+struct input_ctx {
+  struct tiffin *tin;	/*  TIFF . */
+  FILE *input_file;	/*   . */
+  size_t rowsize;	/*    . */
+};
+
+/*   #y     #dst. 
+ *     ,     
+ * .  0   . */
+static int
+read_input_row(void *arg, unsigned long y, char *dst)
+{
+  struct input_ctx *in = arg;
+  unsigned char *src;
+
+  if (in->tin == NULL) {
+	  /*       
+	   *  . */
+	  if (fread(dst, in->rowsize, 1, in->input_file) < 1) {
+		  fprintf(stderr, "Image stream suddenly closed.\n");
+		  return 1;
+	  }
+  } else {
+	  /*      TIFF . */
+	  src = tiffin_read_row(in->tin, y);
+	  if (src == NULL) {
+		  fprintf(stderr, "Unable to decode TIFF data at row %lu\n", y);
+		  return 1;
+	  }
+	  memcpy(dst, src, in->rowsize);
+  }
+
+  return 0;
+}
+
+/*   PDF-,    . */
+static int
+close_combined ()
+{
+  int retc = 0;
+
+  if (combine_pdfctx != NULL) {
+	if (pdf_close(combine_pdfctx)) {
+		fprintf(stderr, "Failed to close the combined PDF file\n");
+		retc = EXIT_FAILURE;
+	}
+	combine_pdfctx = NULL;
+  }
+
+  return retc;
+}
+
+/*  ,    , 
+ *    #opt_r. */
+static int
+process_files (int opt_r, int argc, char **argv)
+{
+  int retc = 0;	/*     . */
+
+  /*     .  
+   * TIFF  ,     
+   * . */
+  uint32 opt_width = width, opt_height = height;
+  float opt_hres = hres, opt_vres = vres;
+  int opt_cmyk = is_cmyk, opt_bits = sample_bits;
+  int opt_miniswhite = miniswhite;
+
+  if (combine_name[0] != '\0' && outformat != PDF_FMT) {
+	fprintf(stderr, "Combined output is supported for PDF only\n");
+	return EXIT_FAILURE;
+  }
+
+  /*       ,
+   *       ,
+   * ,    
+   * ,    . */
+  if (opt_r == argc)
+  	retc = process(NULL);
+
+  /*   ,    . */
+  while (opt_r < argc) {
+  	retc = process(argv[opt_r]);
+	if (retc && exit_on_error) {
+		break;
+	}
+	retc = 0;
+
+	/*       . */
+	output_name[0] = '\0';
+	width = opt_width;
+	height = opt_height;
+	hres = opt_hres;
+	vres = opt_vres;
+	is_cmyk = opt_cmyk;
+	sample_bits = opt_bits;
+	miniswhite = opt_miniswhite;
+
+  	opt_r++;
+  }
+
+  /*    :  . */
+  if (close_combined() && retc == 0)
+	retc = EXIT_FAILURE;
+
+  return retc;
+}
+
+#ifndef __MINGW32__
+/*  ,    . 
+ *    ,    . */
+static int
+run_job (int argc, char **argv)
+{
+  /*    . */
+  optind = 0;
+
+  return process_files(decode_switches (argc, argv), argc, argv);
+}
+#endif
+
 /*  . */
 int
 main (int argc, char **argv)
 {
 
   int opt_r;	/*   decode_options(). */
-  int retc;	/*     . */
 
   /*   . */
   program_name = argv[0];
@@ -632,27 +1161,18 @@ main (int argc, char **argv)
   /*    . */
   opt_r = decode_switches (argc, argv);
 
-  /*       ,
-   *       ,
-   * ,    
-   * ,    . */
-  if (opt_r == argc)
-  	return process(NULL);
-
-  /*   ,    . */
-  while (opt_r < argc) {
-  	retc = process(argv[opt_r]);
-	if (retc && exit_on_error) {
-		return retc;
-	}
-
-	/*    . */
-	output_name[0] = '\0';
-
-  	opt_r++;
+#ifndef __MINGW32__
+  /*       . */
+  if (serve_path[0] != '\0') {
+	load_prologs(psdir);
+#ifdef WITH_PDFWRITER
+	weightfuncs_init();
+#endif
+	return serve(serve_path, run_job);
   }
+#endif
 
-  return 0;
+  return process_files(opt_r, argc, argv);
 }
 
 /*  .
@@ -693,6 +1213,7 @@ filter_basename(char *filter_name, const char *a_filter)
 struct output_ctx {
 	FILE *output_file;
 	void *pdfctx;
+	int shared;	/*   PDF- (--combine). */
 };
 
 static void
@@ -707,7 +1228,7 @@ close_output( struct output_ctx* ctx )
 			}
 			ctx->output_file = NULL;
 		}
-		if ( ctx->pdfctx ) {
+		if ( ctx->pdfctx && !ctx->shared ) {
 			if ( pdf_close( ctx->pdfctx ) && want_verbose ) {
 				fprintf(stderr, "Failed to close the output PDF file\n");
 			}
@@ -717,21 +1238,12 @@ close_output( struct output_ctx* ctx )
 	}
 }
 
-/*      
- *    . */
-static int
-prepare_output( const char *file_name, char *output_name,
-				struct output_ctx **outctx )
+/*     #output_name  
+ *  #file_name.      ,  
+ *   . */
+static void
+set_output_name( const char *file_name, char *output_name )
 {
-  if ( outformat == TIFF_FMT ) return 0;
-	
-  /*  .
-   *  ͣ     . */
-
-  /*   .
-   *      ,  
-   *   . */
-	
    if (suffix[0] == '\0') {
 	   switch ( outformat ) {
 	   case PDF_FMT:
@@ -742,25 +1254,91 @@ prepare_output( const char *file_name, char *output_name,
 	   }
    }
    
-   if (strlen(output_name) == 0) {
+   if (combine_name[0] != '\0') {
+	   snprintf(output_name, MAXLINE, "%s", combine_name);
+   } else if (strlen(output_name) == 0) {
 	   if (file_name != NULL) {
 		   set_suffix(output_name, file_name, suffix);
 	   } else {
 		   set_suffix(output_name, "output", suffix);
 	   }
    }
+}
+
+/*    #buf  #size  ,  
+ *  ,    . 
+ *        .
+ *  0  -1,      . */
+static int
+get_cache_options( char *buf, size_t size )
+{
+  int n;
+
+  n = snprintf(buf, size,
+		   "engrave %s\n"
+		   "raw %i %lu %lu %.4f %.4f %i\n"
+		   "cmyk %i %i%i%i%i\n"
+		   "miniswhite %i density %i intensity %i\n"
+		   "format %i pdf-encoding %i preview %i\n"
+		   "filter-path %s\n"
+		   "ps-path %s\n"
+		   "filters %s\n",
+		   VERSION,
+		   is_raw, (unsigned long) width, (unsigned long) height, hres, vres,
+		   sample_bits,
+		   is_cmyk, want_c, want_m, want_y, want_k,
+		   miniswhite, want_density, want_intensity,
+		   (int) outformat, (int) pdf_encoding, want_preview,
+		   filterdir, psdir, filter);
+
+  return (n < 0 || (size_t) n >= size) ? -1 : 0;
+}
 
-   *outctx = malloc( sizeof(*outctx) );
+/*      
+ *    . */
+static int
+prepare_output( const char *file_name, char *output_name,
+				struct output_ctx **outctx )
+{
+  if ( outformat == TIFF_FMT ) return 0;
+	
+  /*  .
+   *  ͣ     . */
+  set_output_name( file_name, output_name );
+
+   *outctx = malloc( sizeof(**outctx) );
    if ( !*outctx ) return EXIT_FAILURE;
    (*outctx)->output_file = NULL;
    (*outctx)->pdfctx = NULL;
+   (*outctx)->shared = 0;
    
    switch ( outformat ) {
    case PDF_FMT:
+	   if ( combine_name[0] != '\0' ) {
+		   /*      . */
+		   if ( combine_pdfctx ) {
+			   if ( pdf_next_page( combine_pdfctx,
+							  ((double) width / (double) hres) * 72,
+							  ((double) height / (double) vres) * 72 ) )
+				   return EXIT_FAILURE;
+		   } else {
+			   combine_pdfctx =
+				   pdf_open_file( combine_name,
+								  ((double) width / (double) hres) * 72,
+								  ((double) height / (double) vres) * 72,
+								  want_verbose );
+			   if ( !combine_pdfctx )
+				   return EXIT_FAILURE;
+		   }
+		   (*outctx)->pdfctx = combine_pdfctx;
+		   (*outctx)->shared = 1;
+		   break;
+	   }
 	   (*outctx)->pdfctx =
 		   pdf_open_file( output_name,
 						  ((double) width / (double) hres) * 72,
-						  ((double) height / (double) vres) * 72 );
+						  ((double) height / (double) vres) * 72,
+						  want_verbose );
 	   if ( !(*outctx)->pdfctx )
 		   return EXIT_FAILURE;
 	   break;
@@ -771,7 +1349,7 @@ prepare_output( const char *file_name, char *output_name,
 		   if (want_preview) {
 			   strcat(output_name, "~");
 		   }
-		   (*outctx)->output_file = fopen(output_name, "w");
+		   (*outctx)->output_file = aout_fopen(output_name, "w", io_depth);
 		   if ( !(*outctx)->output_file ) {
 			   return EXIT_FAILURE;
 		   }
@@ -795,6 +1373,7 @@ open_tif_file(char *file_name, uint16 *phm, tsample_t *spp, uint16 *r_unit, uint
 {
 
   TIFF *tif;
+  uint16 bps = 8;	/* TIFF TAG *BITSPERSAMPLE* */
 
   if (!is_raw) {
   	/*      TIFF. */
@@ -813,6 +1392,14 @@ open_tif_file(char *file_name, uint16 *phm, tsample_t *spp, uint16 *r_unit, uint
 	  TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, phm);
 	  TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, spp);
 	  TIFFGetField(tif, TIFFTAG_PLANARCONFIG, tiff_planar);
+	  TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bps);
+
+	  /*  8-  16- ޣ. */
+	  if (bps != 8 && bps != 16) {
+		  fprintf(stderr, "Unsupported number of bits per sample: %u\n", bps);
+		  exit(EXIT_FAILURE);
+	  }
+	  sample_bits = bps;
 
 	  /*     
 	   *   . */
@@ -1021,7 +1608,7 @@ add_preview (char *psname, char *tiffname)
 	strncpy(resname, psname, strlen(psname) - 1);
 
 	/*      */
-	res = fopen(resname, "w+");
+	res = aout_fopen(resname, "w+", io_depth);
 	if (res == NULL) {
 		fprintf(stderr, "Can't open file %s\n", resname);
 		exit(EXIT_FAILURE);	/*    . */
@@ -1066,6 +1653,83 @@ add_preview (char *psname, char *tiffname)
 
 }
 
+/*       
+ *     .     :
+ *       (-n),  
+ *     . */
+static int
+negative_input()
+{
+  return miniswhite && want_intensity || !miniswhite && want_density;
+}
+
+/*    #f_path   
+ * (--describe):      (#consumes) 
+ *     (#produces).    ,
+ *      . 
+ *     .  1,  
+ *   (, ,  --no-output),  0. */
+static int
+describe_filter(const char *f_path, int *consumes, int *produces)
+{
+  static struct {
+	  char path[MAXLINE];
+	  int described;
+	  int consumes;
+	  int produces;
+  } known[MAX_FILTERS];
+  static int known_count = 0;
+  char cmd[MAXLINE + 32];
+  char line[256];
+  FILE *desc;
+  int described;
+  int i, val;
+
+  for (i = 0; i < known_count; i++) {
+	  if (strcmp(known[i].path, f_path) == 0) {
+		  *consumes = known[i].consumes;
+		  *produces = known[i].produces;
+		  return known[i].described;
+	  }
+  }
+
+  *consumes = 1;
+  *produces = 1;
+  described = 0;
+  snprintf(cmd, sizeof(cmd), "%s --describe 2>/dev/null", f_path);
+  desc = popen(cmd, "r");
+  if (desc != NULL) {
+	  while (fgets(line, sizeof(line), desc) != NULL) {
+		  if (sscanf(line, "consumes-input %i", &val) == 1)
+			  *consumes = val;
+		  else if (sscanf(line, "produces-output %i", &val) == 1)
+			  *produces = val;
+	  }
+	  /* ,   ,   :
+	   *     . */
+	  if (pclose(desc) != 0) {
+		  *consumes = 1;
+		  *produces = 1;
+	  } else {
+		  described = 1;
+	  }
+  }
+
+  if (want_verbose)
+	  fprintf(stderr, "Filter %s: consumes-input %i, produces-output %i\n",
+			  f_path, *consumes, *produces);
+
+  if (known_count < MAX_FILTERS) {
+	  strcpy(known[known_count].path, f_path);
+	  known[known_count].consumes = *consumes;
+	  known[known_count].produces = *produces;
+	  known[known_count].described = described;
+	  known_count++;
+  }
+
+  return described;
+}
+
 /*      . */
 void
 parse_filters(char *f_cmd, int *filter_count, pid_t pid)
@@ -1078,6 +1742,16 @@ parse_filters(char *f_cmd, int *filter_count, pid_t pid)
   char f_path[MAXLINE];
   char f_args[MAXLINE];
 
+  /*   :     . */
+  char filter_list[MAXLINE];
+
+  /*     . */
+  char f_paths[MAX_FILTERS][MAXLINE];
+  int consumes[MAX_FILTERS];
+  int produces[MAX_FILTERS];
+  int described[MAX_FILTERS];
+  int n, i;
+
   char *outformat_str = NULL;
 
   /*     
@@ -1087,9 +1761,26 @@ parse_filters(char *f_cmd, int *filter_count, pid_t pid)
 	  outformat_str = "eps";
 	  break;
   case TIFF_FMT:
-  case PDF_FMT:
 	  outformat_str = "tiff";
 	  break;
+  case PDF_FMT:
+	  /*        
+	   * PDF (JBIG2  G4  Deflate)    
+	   * ,      . */
+	  switch ( pdf_encoding ) {
+	  case PDF_ENC_G4:
+		  outformat_str = "pdf-g4";
+		  break;
+	  case PDF_ENC_GLYPHS:
+		  outformat_str = "pdf-glyphs";
+		  break;
+	  case PDF_ENC_TIFF:
+		  outformat_str = "tiff";
+		  break;
+	  default:
+		  outformat_str = "pdf";
+	  }
+	  break;
   default:
 	  fprintf( stderr, "BUG: Unexpected output format: %d\n",
 			   outformat );
@@ -1100,7 +1791,7 @@ parse_filters(char *f_cmd, int *filter_count, pid_t pid)
   /*      , 
    *    
    * . */
-  snprintf(f_args, sizeof(f_args), " -p %u -w %u -h %u -x %.2f -y %.2f -t %s", pid, width, height, hres, vres, outformat_str);
+  snprintf(f_args, sizeof(f_args), " -p %u -w %u -h %u -x %.2f -y %.2f -t %s -B %lu", pid, width, height, hres, vres, outformat_str, (unsigned long) smp_batch_rows((is_cmyk ? 4 : 1) * (sample_bits / 8), width, height, batch_rows));
   
   /*   4  . */
   if (is_cmyk)
@@ -1117,35 +1808,87 @@ parse_filters(char *f_cmd, int *filter_count, pid_t pid)
 	strcat(f_args, " -v");
   }
 
+  /*     . */
+  if (want_stats) {
+	strcat(f_args, " -S");
+  }
+
+  /*  ϣ    . */
+  if (encode_ahead > 0) {
+	snprintf(i_arg, sizeof(i_arg), " --encode-ahead=%i", encode_ahead);
+	strcat(f_args, i_arg);
+  }
+
+  /*  ϣ  . */
+  if (io_depth > 0) {
+	snprintf(i_arg, sizeof(i_arg), " --io-depth=%i", io_depth);
+	strcat(f_args, i_arg);
+  }
+
   /*   . */
-  next_filter = filter;
+  strcpy(filter_list, filter);
+  next_filter = filter_list;
+
+  /*        
+   *    . */
+  n = 0;
+  char *saveptr = NULL;
+  a_filter = strtok_r(next_filter, "\n", &saveptr);
+  while (a_filter != NULL) {
+    if (n == MAX_FILTERS) {
+      fprintf(stderr, "Too many filters: at most %i are allowed\n", MAX_FILTERS);
+      exit(EXIT_FAILURE);
+    }
+    strcpy(f_path, filterdir);
+    pathcat(f_path, a_filter);
+    strcpy(f_paths[n], f_path);
+    described[n] = describe_filter(f_path, &consumes[n], &produces[n]);
+    n++;
+
+    /*     . */
+    a_filter = strtok_r(NULL, "\n", &saveptr);
+  }
+
+  /*   ,     
+   * . */
+  feed_filters = n > 0 ? consumes[0] : 1;
 
   /*      . */
   f_cmd[0] = '\0';
 
   *filter_count = 0;
   
-  /*      . */
-  char *saveptr = NULL;
-  a_filter = strtok_r(next_filter, "\n", &saveptr);
-  while (a_filter != NULL) {
+  for (i = 0; i < n; i++) {
     /*       ,
      *       . */
     if (strlen(f_cmd) > 0)
       strcat(f_cmd, " | ");
     
     /*   . */
-    strcpy(f_path, filterdir);
-    pathcat(f_path, a_filter);
-    strcat(f_cmd, f_path);
+    strcat(f_cmd, f_paths[i]);
     strcat(f_cmd, f_args);
     
+    /*  ޣ    :
+     *    8- ޣ. */
+    if (*filter_count == 0 && sample_bits != 8) {
+      snprintf(i_arg, sizeof(i_arg), " -b %i", sample_bits);
+      strcat(f_cmd, i_arg);
+    }
+
+    /*      :   
+     * ޣ   . */
+    if (*filter_count == 0 && negative_input())
+      strcat(f_cmd, " -n");
+
+    /* ,    ,  , 
+     *        . 
+     *   ,   --describe. */
+    if (described[i] && produces[i] && (i == n - 1 || !consumes[i + 1]))
+      strcat(f_cmd, " --no-output");
+
     /*     . */
     snprintf(i_arg, sizeof(i_arg), " -i %u", (*filter_count)++);
     strcat(f_cmd, i_arg);
-
-    /*     . */
-    a_filter = strtok_r(NULL, "\n", &saveptr);
   }
 
   /* TODO:    ""  -. */
@@ -1167,6 +1910,7 @@ ps_header(const char *file_name, FILE *output_file)
   char *next_filter;
   char *a_filter;
   char filter_name[256];
+  char filter_list[MAXLINE];
 
   /*       PostScript-. */
   char ps_path[MAXLINE];
@@ -1202,7 +1946,8 @@ ps_header(const char *file_name, FILE *output_file)
   /*   PostScript    . */
   
   /*   . */
-  next_filter = filter;
+  strcpy(filter_list, filter);
+  next_filter = filter_list;
   
   /*      . */
   char *saveptr = NULL;
@@ -1235,7 +1980,7 @@ prepare_preview(char *thumbnail_name, pid_t pid, uint16 phm, int ss, uint16 tiff
    *  . */
   if (want_preview) {
   	  snprintf(thumbnail_name, MAXLINE, "%i.prv.tif", pid);
-	  *thumbnail = TIFFOpen(thumbnail_name, "w");
+	  *thumbnail = aout_tiffopen(thumbnail_name, io_depth);
 	  if (thumbnail == NULL) {
 		  fprintf(stderr, "Can't write thumbnail file %s\n", "");
 		  exit(EXIT_FAILURE);
@@ -1323,6 +2068,15 @@ use_temporary_filter_file( struct output_ctx *outctx,
 		return;
 	}
 
+	if ( want_stats && jstats.layer_count < STATS_MAX_LAYERS ) {
+		int l = jstats.layer_count++;
+		snprintf( jstats.layers[l].fsuf, sizeof(jstats.layers[l].fsuf),
+				  "%s", fsuf );
+		jstats.layers[l].fidx = fidx;
+		jstats.layers[l].color_idx = color_idx;
+		jstats.layers[l].bytes = statbuf.st_size;
+	}
+
 	switch ( outformat ) {
 	case PDF_FMT:
 		switch ( color_idx ) {
@@ -1360,6 +2114,149 @@ use_temporary_filter_file( struct output_ctx *outctx,
 	free( tmp_fn );
 }
 
+/*     . */
+static void
+stats_begin()
+{
+  memset(&jstats, 0, sizeof(jstats));
+  jstats.start = stats_now();
+  stats_rusage(0, &jstats.user0, &jstats.sys0);
+  stats_rusage(1, &jstats.cuser0, &jstats.csys0);
+  stats_timer_init(&jstats.decode, 1);
+  stats_timer_init(&jstats.transfer, 1);
+  stats_timer_init(&jstats.filter_wait, 1);
+  stats_timer_init(&jstats.preview, 1);
+  stats_timer_init(&jstats.assembly, 1);
+  stats_timer_init(&jstats.finalize, 1);
+}
+
+/*   #filter_count ,   #pid.
+ *   . */
+static void
+stats_read_filters(pid_t pid, int filter_count)
+{
+  char *fn;
+  FILE *f;
+  char key[64];
+  char val[64];
+  int i, l;
+
+  for (i = 0; i < filter_count && i < STATS_MAX_FILTERS; i++) {
+	fn = get_stats_file_name(pid, i);
+	if (fn == NULL)
+		continue;
+	f = fopen(fn, "r");
+	if (f != NULL) {
+		jstats.filters[i].valid = 1;
+		/*  layer_*     layer. */
+		l = -1;
+		while (fscanf(f, "%63s %63s", key, val) == 2) {
+			if (strcmp(key, "name") == 0)
+				snprintf(jstats.filters[i].name, sizeof(jstats.filters[i].name), "%s", val);
+			else if (strcmp(key, "wall") == 0)
+				jstats.filters[i].wall = atof(val);
+			else if (strcmp(key, "user") == 0)
+				jstats.filters[i].user = atof(val);
+			else if (strcmp(key, "sys") == 0)
+				jstats.filters[i].sys = atof(val);
+			else if (strcmp(key, "encode") == 0)
+				jstats.filters[i].encode = atof(val);
+			else if (strcmp(key, "layer") == 0) {
+				if (jstats.filters[i].layer_count < STATS_MAX_FILTER_LAYERS) {
+					l = jstats.filters[i].layer_count++;
+					snprintf(jstats.filters[i].layers[l].kind,
+							 sizeof(jstats.filters[i].layers[l].kind), "%s", val);
+					jstats.filters[i].layers[l].bytes = -1;
+				} else
+					l = -1;
+			}
+			else if (strcmp(key, "layer_encode") == 0 && l >= 0)
+				jstats.filters[i].layers[l].encode = atof(val);
+			else if (strcmp(key, "layer_bytes") == 0 && l >= 0)
+				jstats.filters[i].layers[l].bytes = atoll(val);
+		}
+		fclose(f);
+		if (!want_test_run)
+			unlink(fn);
+	}
+	free(fn);
+  }
+  jstats.filter_count = i;
+}
+
+/*    #t   #name   JSON. */
+static void
+stats_print_timer(FILE *out, const char *name, struct stats_timer *t, int last)
+{
+  fprintf(out, "\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}%s", name, t->wall, t->cpu, last ? "" : ",");
+}
+
+/*     #file_name    
+ * JSON   . */
+static void
+stats_print(const char *file_name)
+{
+  double wall, user, sys, cuser, csys;
+  FILE *out = stderr;
+  const char *p;
+  int i, l;
+
+  wall = stats_now() - jstats.start;
+  stats_rusage(0, &user, &sys);
+  stats_rusage(1, &cuser, &csys);
+
+  fprintf(out, "{\"file\":\"");
+  for (p = file_name != NULL ? file_name : "-"; *p; p++) {
+	if (*p == '"' || *p == '\\')
+		fputc('\\', out);
+	fputc(*p, out);
+  }
+  fprintf(out, "\",\"width\":%u,\"height\":%u", width, height);
+  fprintf(out, ",\"bytes_in\":%llu", jstats.bytes_in);
+  fprintf(out, ",\"wall\":%.6f,\"user\":%.6f,\"sys\":%.6f", wall, user - jstats.user0, sys - jstats.sys0);
+  fprintf(out, ",\"children_user\":%.6f,\"children_sys\":%.6f", cuser - jstats.cuser0, csys - jstats.csys0);
+  fprintf(out, ",\"rows_per_sec\":%.1f", wall > 0 ? height / wall : 0.0);
+
+  fprintf(out, ",\"stages\":{");
+  stats_print_timer(out, "decode", &jstats.decode, 0);
+  stats_print_timer(out, "transfer", &jstats.transfer, 0);
+  stats_print_timer(out, "filter_wait", &jstats.filter_wait, 0);
+  stats_print_timer(out, "preview", &jstats.preview, 0);
+  stats_print_timer(out, "assembly", &jstats.assembly, 0);
+  stats_print_timer(out, "finalize", &jstats.finalize, 1);
+  fprintf(out, "}");
+
+  fprintf(out, ",\"filters\":[");
+  for (i = 0; i < jstats.filter_count; i++) {
+	fprintf(out, "%s{\"index\":%i", i ? "," : "", i);
+	if (jstats.filters[i].valid)
+		fprintf(out, ",\"name\":\"%s\",\"wall\":%.6f,\"user\":%.6f,\"sys\":%.6f,\"encode\":%.6f",
+				jstats.filters[i].name, jstats.filters[i].wall,
+				jstats.filters[i].user, jstats.filters[i].sys,
+				jstats.filters[i].encode);
+	if (jstats.filters[i].layer_count > 0) {
+		fprintf(out, ",\"layers\":[");
+		for (l = 0; l < jstats.filters[i].layer_count; l++)
+			fprintf(out, "%s{\"index\":%i,\"kind\":\"%s\",\"encode\":%.6f,\"bytes\":%lld}",
+					l ? "," : "", l, jstats.filters[i].layers[l].kind,
+					jstats.filters[i].layers[l].encode,
+					jstats.filters[i].layers[l].bytes);
+		fprintf(out, "]");
+	}
+	fprintf(out, "}");
+  }
+  fprintf(out, "]");
+
+  fprintf(out, ",\"layers\":[");
+  for (i = 0; i < jstats.layer_count; i++) {
+	fprintf(out, "%s{\"filter\":%i,\"class\":\"%s\",\"color\":\"%s\",\"bytes\":%lld}",
+			i ? "," : "", jstats.layers[i].fidx, jstats.layers[i].fsuf,
+			get_cmyk_color_suf(jstats.layers[i].color_idx),
+			jstats.layers[i].bytes);
+  }
+  fprintf(out, "]}\n");
+}
+
 /*    . */
 int
 process (char *file_name)
@@ -1378,6 +2275,7 @@ process (char *file_name)
   /*      
    * .*/
   FILE *outpipe = NULL;		/*     . */
+  void *outpipe_buf = NULL;	/*  . */
 
   /*  . */
   char f_cmd[MAXLINE];		/*    . */
@@ -1394,7 +2292,19 @@ process (char *file_name)
   uint16 tiff_planar;	/*  TIFF PlanarConfiguration */
 
   TIFF *tif = NULL;	/*    TIFF. */
+  struct tiffin *tin = NULL;	/*  TIFF . */
+  struct input_ctx input;	/*   . */
+  struct readahead *ra = NULL;	/*  . */
+  char *ra_buf = NULL;	/*  ,  . */
+  size_t ra_rows;	/*    . */
   char *buf = NULL;     /*     . */
+  char *row;		/*      . */
+  char *batch_src;	/*     . */
+  char *raw_map = NULL;	/*    . */
+  size_t raw_map_size = 0;	/*  . */
+  size_t raw_released = 0;	/*  ģ  . */
+  size_t batch;		/*    . */
+  size_t nrows;		/*  ,   . */
   
   /*    . */
   char thumbnail_name[MAXLINE];	/*    . */
@@ -1415,6 +2325,7 @@ process (char *file_name)
   size_t ss;		/*    . */
   size_t rd;		/*   . */
   int y;		/*   . */
+  uint32 decode_height;	/*   . */
 
   /*       . */
   int hd;		/* ޣ    . */
@@ -1423,9 +2334,20 @@ process (char *file_name)
   /* ޣ */
   int i;
 
+  /*   . */
+  int use_cache = 0;		/*     . */
+  char cache_key_str[CACHE_KEY_SIZE];	/*  . */
+  char cache_name[MAXLINE];	/*   . */
+  char cache_opts[2*MAXLINE];	/*   . */
+
   /*      
    *     . */
   void cleanup() {
+	/*      . */
+	if (ra != NULL) {
+		readahead_stop(ra);
+		ra = NULL;
+	}
 	/*   . */
 	if (input_file != NULL && input_file != stdin)
 		if (fclose(input_file) && want_verbose)
@@ -1439,10 +2361,19 @@ process (char *file_name)
 	if (outpipe != NULL)
 		if (pclose(outpipe) && want_verbose)
 			fprintf(stderr, "Filter error\n");
+	if (outpipe_buf != NULL)
+		free(outpipe_buf);
 	/*   . */
 	if (buf != NULL)
 		_TIFFfree(buf);
+#ifdef HAVE_SYS_MMAN_H
+	/*     . */
+	if (raw_map != NULL)
+		munmap(raw_map, raw_map_size);
+#endif
 	/*   TIFF. */
+	if (tin != NULL)
+		tiffin_close(tin);
 	if (tif != NULL)
 		TIFFClose(tif);
 	/*    . */
@@ -1460,12 +2391,26 @@ process (char *file_name)
 		  delete_temporary_filter_file( "m", pid, i, c );
 	  }
 	}
+
+	/*    . */
+	if (want_stats && !want_test_run) {
+	  for (i = 0; i < filter_count; i++) {
+		  char *fn = get_stats_file_name( pid, i );
+		  if (fn != NULL) {
+			  unlink(fn);
+			  free(fn);
+		  }
+	  }
+	}
   }
 
   /*    . */
   init_cleanup(NULL);
   push_cleanup(cleanup);
 
+  if (want_stats)
+	  stats_begin();
+
   /*    .  .
    *     . */
 
@@ -1493,10 +2438,45 @@ process (char *file_name)
 	   *     ,    
 	   * . */
 	  input_file = fopen(file_name, "r");
+	  if (input_file == NULL) {
+		  fprintf(stderr, "Error open RAW file %s\n", file_name);
+		  exit(EXIT_FAILURE);
+	  }
   } else {
 	  input_file = stdin;
   }
 
+  /*     .    EPS
+   *  PDF,     . 
+   *    ,  
+   *     ,    .
+   *         
+   *  . */
+  if (cache_dir[0] != '\0' && file_name != NULL && strlen(file_name) > 0 &&
+	  outformat != TIFF_FMT && combine_name[0] == '\0' && !want_test_run) {
+	  set_output_name(file_name, output_name);
+	  if (strcmp(output_name, "-") != 0) {
+		  snprintf(cache_name, sizeof(cache_name), "%s", output_name);
+		  if (get_cache_options(cache_opts, sizeof(cache_opts)) == 0 &&
+			  cache_key(file_name, cache_opts, cache_key_str) == 0) {
+			  if (cache_fetch(cache_dir, cache_key_str, cache_name) == 0) {
+				  if (want_verbose)
+					  fprintf(stderr, "\nProcessing file %s\nOutput file %s is taken from the cache\n",
+							  file_name, cache_name);
+				  /*  ݣ  :  
+				   *  . */
+				  pop_cleanup();
+				  if (tif != NULL)
+					  TIFFClose(tif);
+				  if (input_file != NULL && input_file != stdin)
+					  fclose(input_file);
+				  return 0;
+			  }
+			  use_cache = 1;
+		  }
+	  }
+  }
+
   /*   . */
   if ( prepare_output( file_name, output_name, &outctx) != 0 )
   {
@@ -1548,11 +2528,58 @@ process (char *file_name)
 	  c0 = 3;	/* 3    */
 	  cN = 3;	/*   . */
   }
+  /* 16- ޣ    
+   * ,  2 . */
+  ss *= sample_bits/8;
 
   /*     . */
 
-  /*       . */
-  buf = _TIFFmalloc(ss*width);
+  /*    : 
+   *     . */
+  batch = smp_batch_rows(ss, width, height, batch_rows);
+  outpipe_buf = set_smp_transport(outpipe, batch*ss*width);
+
+  /*    TIFF .    
+   * ޣ     . */
+  if (tif != NULL) {
+	  tin = tiffin_open(tif, file_name, ss, decode_threads);
+	  if (tin == NULL) {
+		  fprintf(stderr, "Unable to read TIFF file %s\n", file_name);
+		  exit(EXIT_FAILURE);
+	  }
+  }
+  tiff_planar = PLANARCONFIG_CONTIG;
+
+  /*  ,      
+   * (. describe_filter())   .  
+   *   . */
+  decode_height = feed_filters || want_preview ? height : 0;
+
+#ifdef HAVE_SYS_MMAN_H
+  /*      : 
+   *     . */
+  if (is_raw && input_file != stdin && decode_height > 0) {
+	  raw_map = map_raw_file(input_file, (size_t) ss*width*height);
+	  if (raw_map != NULL)
+		  raw_map_size = (size_t) ss*width*height;
+  }
+#endif
+
+  /*    . */
+  input.tin = tin;
+  input.input_file = input_file;
+  input.rowsize = ss*width;
+
+  /*   . ֣    
+   *     . */
+  if (read_ahead > 0 && raw_map == NULL && decode_height > 0) {
+	  ra = readahead_start(read_input_row, &input, ss*width, height, batch, read_ahead);
+	  if (ra == NULL && want_verbose)
+		  fprintf(stderr, "Read-ahead is not available\n");
+  }
+
+  /*        . */
+  buf = _TIFFmalloc(batch*ss*width);
   /*         . */
   if (buf == NULL) {
 	  fprintf(stderr, "Scanline buffer allocation failed\n");
@@ -1563,7 +2590,7 @@ process (char *file_name)
    *  . */
   if (want_preview) {
   	  /*     . */
-	  prepare_preview(thumbnail_name, pid, phm, ss, tiff_planar, &thumbnail, &thumbnail_buf, &thumbnail_width, &thumbnail_height);
+	  prepare_preview(thumbnail_name, pid, phm, ss/(sample_bits/8), tiff_planar, &thumbnail, &thumbnail_buf, &thumbnail_width, &thumbnail_height);
 
 	  /*   .
 	   *    . */
@@ -1587,39 +2614,78 @@ process (char *file_name)
   /*  ޣ. */
   yd = 0;
   dc = 0;
-  for (y = 0; y < height; y++) {
+  nrows = 0;
+  for (y = 0; y < decode_height; y++) {
+
+	  /*        . */
+	  row = buf + nrows*ss*width;
+
+	  if (want_stats)
+		  stats_timer_start(&jstats.decode);
 	  
-	  if (is_raw) {
-	  	  /*     
-		   *  . */
-		  rd = fread(buf, ss, width, stdin);
-		  /*     . */
-		  if (rd < width) {
-			  fprintf(stderr, "Image stream suddenly closed.\n");
-			  exit(EXIT_FAILURE);
+	  if (raw_map != NULL) {
+		  /*  ֣    . */
+		  row = raw_map + (size_t) y*ss*width;
+	  } else if (ra != NULL) {
+		  /*    ,  . 
+		   *     . */
+		  if (nrows == 0) {
+			  ra_buf = readahead_next(ra, &ra_rows);
+			  if (ra_buf == NULL)
+				  exit(EXIT_FAILURE);
 		  }
-	  } else
-	  	  /*      TIFF . */
-		  TIFFReadScanline(tif, buf, y, 0);
+		  row = ra_buf + nrows*ss*width;
+	  } else if (read_input_row(&input, y, row) != 0) {
+		  exit(EXIT_FAILURE);
+	  }
+
+	  if (want_stats)
+		  stats_timer_stop(&jstats.decode);
 
 	/*         ,
 	 *   ţ      
 	 *  . */
 	  if (thumbnail != NULL && y == thumbnail_sy) {
+		  if (want_stats)
+			  stats_timer_start(&jstats.preview);
 		  thumbnail_syf += thumbnail_step;
 		  thumbnail_sy = rint(thumbnail_syf);
-		  get_thumbnail_line(buf, ss, width, thumbnail_buf, thumbnail_width);
+		  get_thumbnail_line(row, ss, sample_bits/8, width, thumbnail_buf, thumbnail_width);
 		  TIFFWriteScanline(thumbnail, thumbnail_buf, thumbnail_y++, 0);
+		  if (want_stats)
+			  stats_timer_stop(&jstats.preview);
 	  }
 
-	  /*      
-	   * .      
-	   *    ,   
-	   * . */
-	  rd = fwritesmp(buf, ss, width, outpipe, miniswhite && want_intensity || !miniswhite && want_density, NULL);
-	  if (rd < width) { /*   . */
-		  fprintf(stderr, "Failed to transfer scanline data further\n");
-		  exit(EXIT_FAILURE);
+	  /*      
+	   * ,      . 
+	   *     (.
+	   * negative_input()). */
+	  nrows++;
+	  if (nrows == batch || y == height - 1) {
+		  /*   ,     
+		   *  (. describe_filter()). */
+		  if (feed_filters) {
+			  if (raw_map != NULL)
+				  batch_src = raw_map + (size_t) (y + 1 - nrows)*ss*width;
+			  else
+				  batch_src = ra != NULL ? ra_buf : buf;
+			  if (want_stats)
+				  stats_timer_start(&jstats.transfer);
+			  rd = fwritesmp_rows(batch_src, ss, width, nrows, outpipe, 0);
+			  if (rd < nrows) { /*   . */
+				  fprintf(stderr, "Failed to transfer scanline data further\n");
+				  exit(EXIT_FAILURE);
+			  }
+			  if (want_stats) {
+				  stats_timer_stop(&jstats.transfer);
+				  jstats.bytes_in += (unsigned long long) nrows*ss*width;
+			  }
+		  }
+		  nrows = 0;
+#ifdef HAVE_SYS_MMAN_H
+		  if (raw_map != NULL)
+			  release_raw_map(raw_map, input_file, &raw_released, (size_t) (y + 1)*ss*width);
+#endif
 	  }
 	 
 	  /*   . */
@@ -1633,6 +2699,8 @@ process (char *file_name)
   }
 
   /*       . */
+  if (want_stats)
+	  stats_timer_start(&jstats.filter_wait);
   if (outpipe != NULL) {
 	  if (pclose(outpipe)) {
 		  if (want_verbose)
@@ -1642,11 +2710,22 @@ process (char *file_name)
 	  }
 	  outpipe = NULL;
   }
+  if (want_stats) {
+	  stats_timer_stop(&jstats.filter_wait);
+	  stats_read_filters(pid, filter_count);
+  }
+  if (outpipe_buf != NULL) {
+	  free(outpipe_buf);
+	  outpipe_buf = NULL;
+  }
 
   /*   100% (  ). */
   if (want_verbose)
 	  fprintf(stderr, "100%\n");
 
+  if (want_stats)
+	  stats_timer_start(&jstats.assembly);
+
   if ( outctx ) {
 	  /*  ,     . */
 	  if ( outformat == EPS_FMT ) {
@@ -1722,20 +2801,44 @@ process (char *file_name)
   
   }
 
+  if (want_stats)
+	  stats_timer_stop(&jstats.assembly);
+
   /*       . */
   int to_stdout = ( outctx && outctx->output_file == stdout);
 
   /*     . */
+  if (want_stats)
+	  stats_timer_start(&jstats.finalize);
   (*pop_cleanup())();
+  if (want_stats)
+	  stats_timer_stop(&jstats.finalize);
 
   /*    ,    
    * PostScript-      TIFF. */
   if (want_preview && !to_stdout ) {
 	  if ( outformat == EPS_FMT ) {
 		  /*     PostScript-. */
+		  if (want_stats)
+			  stats_timer_start(&jstats.preview);
 		  add_preview(output_name, thumbnail_name);
+		  if (want_stats)
+			  stats_timer_stop(&jstats.preview);
 	  }
   }
 
+  /*    . */
+  if (use_cache) {
+	  if (cache_store(cache_dir, cache_key_str, cache_name,
+					  (unsigned long long) cache_limit << 20) != 0 &&
+		  want_verbose)
+		  fprintf(stderr, "Unable to store %s in the cache %s\n",
+				  cache_name, cache_dir);
+  }
+
+  /*    . */
+  if (want_stats)
+	  stats_print(file_name);
+
   return 0;
 }
@@ -41,13 +41,25 @@
 
 #include <iostream>
 #include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
 using namespace std;
 
+extern "C" {
+#include "weightfunc.h"
+}
+
 #include <PDFWriter/PDFWriter.h>
 #include <PDFWriter/PDFPage.h>
 #include <PDFWriter/PageContentContext.h>
 #include <PDFWriter/PDFFormXObject.h>
 #include <PDFWriter/TiffUsageParameters.h>
+#include <PDFWriter/ObjectsContext.h>
+#include <PDFWriter/DictionaryContext.h>
+#include <PDFWriter/PDFStream.h>
+#include <PDFWriter/IByteWriter.h>
 using namespace PDFHummus;
 
 /**
@@ -56,7 +68,19 @@ using namespace PDFHummus;
 class ObjList {
 public:
 	string objId;
+	bool isImage;		//    ,  
+						//   ( --   TIFF).
+	bool isMask;		//  ,   color.
+	pdfcolor_t color;
+	double extentWidth;		//     :
+	double extentHeight;	// 1  ,   .
 	ObjList* next;
+
+	ObjList( const string &_objId, bool _isImage, bool _isMask,
+			 pdfcolor_t _color )
+		: objId( _objId ), isImage( _isImage ), isMask( _isMask ),
+		  color( _color ), extentWidth( 1 ), extentHeight( 1 ),
+		  next( NULL ) {}
 };
 
 /**
@@ -64,22 +88,29 @@ public:
  */
 class PDFCtx {
 public:
+	PDFWriter pdfWriter;	//    .
 	PDFPage   *pdfPage;
 	PageContentContext *pageContentContext;
 	double width;
 	double height;
 	ObjList *objlist;
+	ObjList *objtail;		//    #objlist.
+	bool verbose;
+	//  Type 3   (0 -- ݣ  ).
+	ObjectIDType glyphFonts[WEIGHTFUNCS_COUNT + 1];
+	//  Separation  (0 -- ݣ  ).
+	ObjectIDType colorSpaces[PDFCOLOR_WHITE + 1];
 };
 
-PDFWriter pdfWriter;
-
 /**
  *  PDF  #filename  .  
- *   #width  #height.
+ *   #width  #height.    #verbose, 
+ *     .
  *      #NULL   .
  */
 void *
-pdf_open_file( const char *filename, double width, double height )
+pdf_open_file( const char *filename, double width, double height,
+			   int verbose )
 {
 	EStatusCode status;
 	PDFCtx *ctx;
@@ -92,9 +123,16 @@ pdf_open_file( const char *filename, double width, double height )
 	ctx->width = width;
 	ctx->height = height;
 	ctx->objlist = NULL;
-
-	cerr << "Open PDF file: " << filename << "\n";
-	status = pdfWriter.StartPDF( filename, ePDFVersion14 );
+	ctx->objtail = NULL;
+	ctx->verbose = verbose;
+	for ( int i = 0; i <= WEIGHTFUNCS_COUNT; i++ )
+		ctx->glyphFonts[i] = 0;
+	for ( int i = 0; i <= PDFCOLOR_WHITE; i++ )
+		ctx->colorSpaces[i] = 0;
+
+	if ( ctx->verbose )
+		cerr << "Open PDF file: " << filename << "\n";
+	status = ctx->pdfWriter.StartPDF( filename, ePDFVersion14 );
 	if ( status != eSuccess ) {
 		cerr << "Error: Unable to open PDF file\n";
 		delete ctx;
@@ -105,7 +143,14 @@ pdf_open_file( const char *filename, double width, double height )
 }
 
 static CMYKRGBColor getColor( pdfcolor_t color );
+static void getCMYK( pdfcolor_t color, double cmyk[4] );
 static int addImage( PDFCtx *ctx, PDFFormXObject* image );
+static bool isImageStream( const char *file );
+static int addImageStream( PDFCtx *ctx, const char *file,
+						   pdfcolor_t color );
+static ObjList *appendLayer( PDFCtx *ctx, const string &name,
+							 bool isImage, bool isMask,
+							 pdfcolor_t color );
 
 /**
  *   PDF #ctx     #tifffile.
@@ -117,14 +162,18 @@ pdf_add_bitmap( void *_ctx, const char *tifffile, pdfcolor_t color )
 {
 	PDFCtx *ctx = (PDFCtx *) _ctx;
 
+	if ( isImageStream( tifffile ) )
+		return addImageStream( ctx, tifffile, color );
+
 	TIFFUsageParameters params;
 	params.BWTreatment.AsImageMask = 1;
 	params.BWTreatment.OneColor = getColor( color );
 
-	cerr << "Add bitmap file: " << tifffile << " (" << color << ")\n";
+	if ( ctx->verbose )
+		cerr << "Add bitmap file: " << tifffile << " (" << color << ")\n";
 	
 	PDFFormXObject* image =
-		pdfWriter.CreateFormXObjectFromTIFFFile( tifffile, params );
+		ctx->pdfWriter.CreateFormXObjectFromTIFFFile( tifffile, params );
 	if ( !image ) {
 		cerr << "Error reading the image file!\n";
 		return 1;
@@ -146,15 +195,19 @@ pdf_add_tonemap( void *_ctx, const char *tifffile, pdfcolor_t color )
 {
 	PDFCtx *ctx = (PDFCtx *) _ctx;
 
+	if ( isImageStream( tifffile ) )
+		return addImageStream( ctx, tifffile, color );
+
 	TIFFUsageParameters params;
 	params.GrayscaleTreatment.AsColorMap = true;
 	params.GrayscaleTreatment.OneColor = getColor( color );
 	params.GrayscaleTreatment.ZeroColor = getColor( PDFCOLOR_WHITE );
 
-	cerr << "Add tonemap file: " << tifffile << " (" << color << ")\n";
+	if ( ctx->verbose )
+		cerr << "Add tonemap file: " << tifffile << " (" << color << ")\n";
 	
 	PDFFormXObject* image =
-		pdfWriter.CreateFormXObjectFromTIFFFile( tifffile, params );
+		ctx->pdfWriter.CreateFormXObjectFromTIFFFile( tifffile, params );
 	if ( !image ) {
 		cerr << "Error reading the image file!\n";
 		return 1;
@@ -168,6 +221,63 @@ pdf_add_tonemap( void *_ctx, const char *tifffile, pdfcolor_t color )
 
 static int placeImages( PDFCtx *ctx );
 
+/**
+ *        ţ  .
+ *    ϣ ,   
+ *     .
+ *  0     -0 .
+ */
+static int
+finishPage( PDFCtx *ctx )
+{
+	int ret = 0;
+
+	if ( placeImages( ctx ) != 0 ) {
+		cerr << "Error placing images!\n";
+		ret = 1;
+	}
+	if ( ctx->pageContentContext ) {
+		if ( ctx->verbose )
+			cerr << "Close PDF page context\n";
+		ctx->pdfWriter.EndPageContentContext( ctx->pageContentContext );
+		ctx->pageContentContext = NULL;
+	}
+	if ( ctx->pdfPage ) {
+		if ( ctx->verbose )
+			cerr << "Close PDF page\n";
+		ctx->pdfWriter.WritePageAndRelease( ctx->pdfPage );
+		ctx->pdfPage = NULL;
+	}
+
+	while ( ctx->objlist ) {
+		ObjList *next = ctx->objlist->next;
+		delete ctx->objlist;
+		ctx->objlist = next;
+	}
+	ctx->objtail = NULL;
+
+	return ret;
+}
+
+/**
+ *       .
+ */
+int
+pdf_next_page( void *_ctx, double width, double height )
+{
+	int ret = 0;
+	PDFCtx *ctx = (PDFCtx *) _ctx;
+
+	//    .
+	if ( ctx->pdfPage )
+		ret = finishPage( ctx );
+
+	ctx->width = width;
+	ctx->height = height;
+
+	return ret;
+}
+
 /**
  *     PDF .
  */
@@ -178,21 +288,11 @@ pdf_close( void *_ctx )
 	PDFCtx *ctx = (PDFCtx *) _ctx;
 
 	if ( ctx ) {
-		if ( placeImages( ctx ) != 0 ) {
-			cerr << "Error placing images!\n";
-            ret = 1;
-		}
-		if ( ctx->pageContentContext ) {
-			cerr << "Close PDF page context\n";
-			pdfWriter.EndPageContentContext( ctx->pageContentContext );
-		}
-		if ( ctx->pdfPage ) {
-			cerr << "Close PDF page\n";
-			pdfWriter.WritePageAndRelease( ctx->pdfPage );
-		}
+		ret = finishPage( ctx );
 
-		cerr << "Close PDF\n";
-		pdfWriter.EndPDF();
+		if ( ctx->verbose )
+			cerr << "Close PDF\n";
+		ctx->pdfWriter.EndPDF();
 	}
 
 	delete ctx;
@@ -208,15 +308,17 @@ static int
 preparePage( PDFCtx *ctx )
 {
 	if ( !ctx->pdfPage ) {
-		cerr << "Add new page to the PDF\n";
+		if ( ctx->verbose )
+			cerr << "Add new page to the PDF\n";
 		ctx->pdfPage = new PDFPage();
 		if ( !ctx->pdfPage ) {
 			cerr << "Error: Unable to add the page\n";
 			return 1;
 		}
 		
-		cerr << "Set page media box to " << \
-			ctx->width << "x" << ctx->height << "\n";
+		if ( ctx->verbose )
+			cerr << "Set page media box to " <<
+				ctx->width << "x" << ctx->height << "\n";
 		ctx->pdfPage->SetMediaBox(
 		        PDFRectangle( 0, 0, ctx->width, ctx->height ) );
 	}
@@ -234,9 +336,10 @@ preparePageContext( PDFCtx *ctx )
 	if ( preparePage( ctx ) != 0 ) return 1;
 	
 	if ( !ctx->pageContentContext ) {
-		cerr << "Start new page context\n";
+		if ( ctx->verbose )
+			cerr << "Start new page context\n";
 		ctx->pageContentContext = 
-			pdfWriter.StartPageContentContext( ctx->pdfPage );
+			ctx->pdfWriter.StartPageContentContext( ctx->pdfPage );
 		if ( !ctx->pageContentContext ) {
 			cerr << "Error: Unable to start the page context\n";
 			return 1;
@@ -266,6 +369,31 @@ getColor( pdfcolor_t color )
 	}
 }
 
+/**
+ *   #cmyk   #color   0 - 1.
+ */
+static void
+getCMYK( pdfcolor_t color, double cmyk[4] )
+{
+	cmyk[0] = cmyk[1] = cmyk[2] = cmyk[3] = 0;
+	switch ( color ) {
+	case PDFCOLOR_BLACK:
+		cmyk[3] = 1;
+		break;
+	case PDFCOLOR_CYAN:
+		cmyk[0] = 1;
+		break;
+	case PDFCOLOR_MAGENTA:
+		cmyk[1] = 1;
+		break;
+	case PDFCOLOR_YELLOW:
+		cmyk[2] = 1;
+		break;
+	default:
+		break;
+	}
+}
+
 /**
  *    .
  */
@@ -278,20 +406,28 @@ addImage( PDFCtx *ctx, PDFFormXObject* image )
 		ctx->pdfPage->GetResourcesDictionary().
 		      AddFormXObjectMapping( image->GetObjectID() );
 
-	cerr << "Add the image " << imageId << " to the document\n";
-	
-	ObjList *objlist = ctx->objlist;
-	while ( objlist && objlist->next )
-		objlist = objlist->next;
-	ObjList *newObj = new ObjList();
-	newObj->objId = imageId; // TODO: constructor
-	newObj->next = NULL;
-	if ( objlist )
-		objlist->next = newObj;
+	if ( ctx->verbose )
+		cerr << "Add the image " << imageId << " to the document\n";
+	appendLayer( ctx, imageId, false, false, PDFCOLOR_BLACK );
+
+    return 0;
+}
+
+/**
+ *     ϣ  #name  .
+ */
+static ObjList *
+appendLayer( PDFCtx *ctx, const string &name, bool isImage, bool isMask,
+			 pdfcolor_t color )
+{
+	ObjList *newObj = new ObjList( name, isImage, isMask, color );
+	if ( ctx->objtail )
+		ctx->objtail->next = newObj;
 	else
 		ctx->objlist = newObj;
+	ctx->objtail = newObj;
 
-    return 0;
+	return newObj;
 }
 
 
@@ -303,20 +439,513 @@ placeImages( PDFCtx *ctx )
 {
 	if ( preparePageContext( ctx ) != 0 ) return 1;
 
-	cerr << "Place the images on the page:";
+	if ( ctx->verbose )
+		cerr << "Place the images on the page:";
 	
 	ctx->pageContentContext->q();
 	
 	ObjList *objlist = ctx->objlist;
 	while ( objlist ) {
-		cerr << " " << objlist->objId;
-		ctx->pageContentContext->Do( objlist->objId );
+		if ( ctx->verbose )
+			cerr << " " << objlist->objId;
+		if ( objlist->isImage ) {
+			//  ( )   
+			//    .
+			ctx->pageContentContext->q();
+			ctx->pageContentContext->cm(
+				ctx->width / objlist->extentWidth, 0, 0,
+				ctx->height / objlist->extentHeight, 0, 0 );
+			if ( objlist->isMask ) {
+				double cmyk[4];
+				getCMYK( objlist->color, cmyk );
+				ctx->pageContentContext->k( cmyk[0], cmyk[1],
+											cmyk[2], cmyk[3] );
+			}
+			ctx->pageContentContext->Do( objlist->objId );
+			ctx->pageContentContext->Q();
+		} else {
+			ctx->pageContentContext->Do( objlist->objId );
+		}
 		objlist = objlist->next;
 	}
 	
 	ctx->pageContentContext->Q();
 
-	cerr << "\n";
+	if ( ctx->verbose )
+		cerr << "\n";
+
+	return 0;
+}
+
+
+/*     ,  
+ *   PDF. */
+#define IMAGE_STREAM_MAGIC "pdfimage "
+
+/**
+ *       .
+ */
+struct ImageStreamInfo {
+	string kind;		// stroke, mask  tone
+	long width;
+	long height;
+	int bpc;
+	string filter;
+	int miniswhite;
+	string content;		// glyphs --    
+	long columns;		//    ( ).
+	long rows;
+};
+
+/**
+ * ,   #file  , 
+ * ,    TIFF.
+ */
+static bool
+isImageStream( const char *file )
+{
+	char magic[sizeof(IMAGE_STREAM_MAGIC) - 1];
+	bool ret = false;
+
+	FILE *f = fopen( file, "rb" );
+	if ( f ) {
+		ret = fread( magic, sizeof(magic), 1, f ) == 1 &&
+			memcmp( magic, IMAGE_STREAM_MAGIC, sizeof(magic) ) == 0;
+		fclose( f );
+	}
+
+	return ret;
+}
+
+/**
+ *      #f   "data".
+ *  0   .
+ */
+static int
+readImageStreamInfo( FILE *f, ImageStreamInfo &info )
+{
+	char line[256];
+	char key[64];
+	char value[128];
+
+	info.width = info.height = 0;
+	info.bpc = 0;
+	info.miniswhite = 0;
+	info.columns = info.rows = 0;
+
+	while ( fgets( line, sizeof(line), f ) ) {
+		if ( strcmp( line, "data\n" ) == 0 )
+			return ( info.width > 0 && info.height > 0 &&
+					 (info.bpc == 1 || info.bpc == 8) &&
+					 !info.filter.empty() ) ? 0 : 1;
+		if ( sscanf( line, "%63s %127s", key, value ) != 2 )
+			continue;
+		if ( strcmp( key, "kind" ) == 0 )
+			info.kind = value;
+		else if ( strcmp( key, "width" ) == 0 )
+			info.width = atol( value );
+		else if ( strcmp( key, "height" ) == 0 )
+			info.height = atol( value );
+		else if ( strcmp( key, "bpc" ) == 0 )
+			info.bpc = atoi( value );
+		else if ( strcmp( key, "filter" ) == 0 )
+			info.filter = value;
+		else if ( strcmp( key, "miniswhite" ) == 0 )
+			info.miniswhite = atoi( value );
+		else if ( strcmp( key, "content" ) == 0 )
+			info.content = value;
+		else if ( strcmp( key, "columns" ) == 0 )
+			info.columns = atol( value );
+		else if ( strcmp( key, "rows" ) == 0 )
+			info.rows = atol( value );
+	}
+
+	return 1;
+}
+
+/**
+ *      #color.
+ */
+static string
+getColorantName( pdfcolor_t color )
+{
+	switch ( color ) {
+	case PDFCOLOR_BLACK:
+		return "Black";
+	case PDFCOLOR_CYAN:
+		return "Cyan";
+	case PDFCOLOR_MAGENTA:
+		return "Magenta";
+	case PDFCOLOR_YELLOW:
+		return "Yellow";
+	default:
+		return "None";
+	}
+}
+
+/**
+ *     Separation  #color.
+ *       
+ *   .
+ */
+static ObjectIDType
+writeSeparation( PDFCtx *ctx, pdfcolor_t color )
+{
+	if ( ctx->colorSpaces[color] )
+		return ctx->colorSpaces[color];
+
+	double cmyk[4];
+	getCMYK( color, cmyk );
+
+	ObjectsContext &objects = ctx->pdfWriter.GetObjectsContext();
+	ObjectIDType csId = objects.StartNewIndirectObject();
+	objects.StartArray();
+	objects.WriteName( "Separation" );
+	objects.WriteName( getColorantName( color ) );
+	objects.WriteName( "DeviceCMYK" );
+	DictionaryContext *func = objects.StartDictionary();
+	func->WriteKey( "FunctionType" );
+	func->WriteIntegerValue( 2 );
+	func->WriteKey( "Domain" );
+	objects.StartArray();
+	objects.WriteInteger( 0 );
+	objects.WriteInteger( 1 );
+	objects.EndArray( eTokenSeparatorEndLine );
+	func->WriteKey( "C0" );
+	objects.StartArray();
+	for ( int i = 0; i < 4; i++ )
+		objects.WriteInteger( 0 );
+	objects.EndArray( eTokenSeparatorEndLine );
+	func->WriteKey( "C1" );
+	objects.StartArray();
+	for ( int i = 0; i < 4; i++ )
+		objects.WriteDouble( cmyk[i] );
+	objects.EndArray( eTokenSeparatorEndLine );
+	func->WriteKey( "N" );
+	func->WriteIntegerValue( 1 );
+	objects.EndDictionary( func );
+	objects.EndArray( eTokenSeparatorEndLine );
+	objects.EndIndirectObject();
+
+	ctx->colorSpaces[color] = csId;
+	return csId;
+}
+
+/**
+ *     :  #slice  
+ *    6x6   .   .
+ */
+static ObjectIDType
+writeGlyphProc( PDFCtx *ctx, const unsigned char *slice )
+{
+	ObjectsContext &objects = ctx->pdfWriter.GetObjectsContext();
+	string proc = "1 0 0 0 1 1 d1\n"
+		"BI /IM true /W 6 /H 6 /BPC 1 /D [1 0] /F /AHx ID\n";
+	char hex[4];
+
+	for ( int j = 0; j < TILEHEIGHT; j++ ) {
+		unsigned int bits = 0;
+		for ( int i = 0; i < TILEWIDTH; i++ ) {
+			if ( slice[j * TILEWIDTH + i] )
+				bits |= 0x80 >> i;
+		}
+		snprintf( hex, sizeof(hex), "%02X", bits );
+		proc += hex;
+	}
+	proc += ">\nEI\n";
+
+	ObjectIDType procId = objects.StartNewIndirectObject();
+	DictionaryContext *dict = objects.StartDictionary();
+	PDFStream *stream = objects.StartUnfilteredPDFStream( dict );
+	stream->GetWriteStream()->Write(
+		(const IOBasicTypes::Byte *) proc.data(), proc.size() );
+	objects.EndPDFStream( stream );
+	delete stream;
+
+	return procId;
+}
+
+/**
+ *     Type 3  ,   ݣ 
+ * :      ,   -- 
+ * ,  --      
+ *  (  tile32.ps  EPS).
+ */
+static void
+writeGlyphFonts( PDFCtx *ctx )
+{
+	ObjectsContext &objects = ctx->pdfWriter.GetObjectsContext();
+	unsigned char slice[WEIGHTFUNC_LEN];
+	unsigned char prev[WEIGHTFUNC_LEN];
+
+	if ( ctx->glyphFonts[1] ) return;
+
+	weightfuncs_init();
+	for ( int idx = 1; idx <= WEIGHTFUNCS_COUNT; idx++ ) {
+		vector<ObjectIDType> procs;
+		vector<string> names;
+		string codeName[256];
+		char name[16];
+
+		//    :   .
+		for ( int area = 0; area < 256; area++ ) {
+			weight_func_apply( slice, idx, area );
+			if ( area == 0 || memcmp( slice, prev, WEIGHTFUNC_LEN ) ) {
+				snprintf( name, sizeof(name), "a%d", area );
+				names.push_back( name );
+				procs.push_back( writeGlyphProc( ctx, slice ) );
+				memcpy( prev, slice, WEIGHTFUNC_LEN );
+			}
+			codeName[area] = names.back();
+		}
+
+		ctx->glyphFonts[idx] = objects.StartNewIndirectObject();
+		DictionaryContext *dict = objects.StartDictionary();
+		dict->WriteKey( "Type" );
+		dict->WriteNameValue( "Font" );
+		dict->WriteKey( "Subtype" );
+		dict->WriteNameValue( "Type3" );
+		dict->WriteKey( "FontBBox" );
+		objects.StartArray();
+		objects.WriteInteger( 0 );
+		objects.WriteInteger( 0 );
+		objects.WriteInteger( 1 );
+		objects.WriteInteger( 1 );
+		objects.EndArray( eTokenSeparatorEndLine );
+		dict->WriteKey( "FontMatrix" );
+		objects.StartArray();
+		objects.WriteInteger( 1 );
+		objects.WriteInteger( 0 );
+		objects.WriteInteger( 0 );
+		objects.WriteInteger( 1 );
+		objects.WriteInteger( 0 );
+		objects.WriteInteger( 0 );
+		objects.EndArray( eTokenSeparatorEndLine );
+		dict->WriteKey( "CharProcs" );
+		DictionaryContext *charProcs = objects.StartDictionary();
+		for ( size_t i = 0; i < procs.size(); i++ ) {
+			charProcs->WriteKey( names[i] );
+			charProcs->WriteObjectReferenceValue( procs[i] );
+		}
+		objects.EndDictionary( charProcs );
+		dict->WriteKey( "Encoding" );
+		DictionaryContext *encoding = objects.StartDictionary();
+		encoding->WriteKey( "Type" );
+		encoding->WriteNameValue( "Encoding" );
+		encoding->WriteKey( "Differences" );
+		objects.StartArray();
+		objects.WriteInteger( 0 );
+		for ( int area = 0; area < 256; area++ )
+			objects.WriteName( codeName[area] );
+		objects.EndArray( eTokenSeparatorEndLine );
+		objects.EndDictionary( encoding );
+		dict->WriteKey( "FirstChar" );
+		dict->WriteIntegerValue( 0 );
+		dict->WriteKey( "LastChar" );
+		dict->WriteIntegerValue( 255 );
+		dict->WriteKey( "Widths" );
+		objects.StartArray();
+		for ( int area = 0; area < 256; area++ )
+			objects.WriteInteger( 1 );
+		objects.EndArray( eTokenSeparatorEndLine );
+		dict->WriteKey( "Resources" );
+		objects.EndDictionary( objects.StartDictionary() );
+		objects.EndDictionary( dict );
+		objects.EndIndirectObject();
+	}
+}
+
+/**
+ *   PDF #ctx      #f: ,
+ *   (   /T1 - /T20 
+ *  )  .   
+ *        #color.
+ *  0   ,  -0   .
+ */
+static int
+addGlyphStream( PDFCtx *ctx, FILE *f, const ImageStreamInfo &info,
+				pdfcolor_t color )
+{
+	if ( info.columns <= 0 || info.rows <= 0 ) {
+		cerr << "Error: Invalid glyph stream header\n";
+		return 1;
+	}
+
+	writeGlyphFonts( ctx );
+
+	ObjectsContext &objects = ctx->pdfWriter.GetObjectsContext();
+	ObjectIDType formId = objects.StartNewIndirectObject();
+	DictionaryContext *dict = objects.StartDictionary();
+
+	dict->WriteKey( "Type" );
+	dict->WriteNameValue( "XObject" );
+	dict->WriteKey( "Subtype" );
+	dict->WriteNameValue( "Form" );
+	dict->WriteKey( "BBox" );
+	objects.StartArray();
+	objects.WriteInteger( 0 );
+	objects.WriteInteger( 0 );
+	objects.WriteInteger( info.columns );
+	objects.WriteInteger( info.rows );
+	objects.EndArray( eTokenSeparatorEndLine );
+	dict->WriteKey( "Resources" );
+	DictionaryContext *resources = objects.StartDictionary();
+	resources->WriteKey( "Font" );
+	DictionaryContext *fonts = objects.StartDictionary();
+	for ( int idx = 1; idx <= WEIGHTFUNCS_COUNT; idx++ ) {
+		char name[8];
+		snprintf( name, sizeof(name), "T%d", idx );
+		fonts->WriteKey( name );
+		fonts->WriteObjectReferenceValue( ctx->glyphFonts[idx] );
+	}
+	objects.EndDictionary( fonts );
+	objects.EndDictionary( resources );
+	dict->WriteKey( "Filter" );
+	dict->WriteNameValue( info.filter );
+
+	//        .
+	PDFStream *stream = objects.StartUnfilteredPDFStream( dict );
+	IByteWriter *writer = stream->GetWriteStream();
+	IOBasicTypes::Byte buf[65536];
+	size_t n;
+	while ( ( n = fread( buf, 1, sizeof(buf), f ) ) > 0 )
+		writer->Write( buf, n );
+	objects.EndPDFStream( stream );
+	delete stream;
+
+	if ( ferror( f ) ) {
+		cerr << "Error reading the glyph stream!\n";
+		return 1;
+	}
+
+	string formName =
+		ctx->pdfPage->GetResourcesDictionary().
+		      AddFormXObjectMapping( formId );
+
+	if ( ctx->verbose )
+		cerr << "Add the glyph layer " << formName << " to the document\n";
+	ObjList *layer = appendLayer( ctx, formName, true, true, color );
+	layer->extentWidth = info.columns;
+	layer->extentHeight = info.rows;
+
+	return 0;
+}
+
+/**
+ *   PDF #ctx   , 
+ *  (#file).      
+ *  .    ,
+ *   #color;    
+ *  Separation  #color.
+ *  0   ,  -0   .
+ */
+static int
+addImageStream( PDFCtx *ctx, const char *file, pdfcolor_t color )
+{
+	ImageStreamInfo info;
+
+	if ( ctx->verbose )
+		cerr << "Add image stream: " << file << " (" << color << ")\n";
+
+	FILE *f = fopen( file, "rb" );
+	if ( !f ) {
+		cerr << "Error reading the image file!\n";
+		return 1;
+	}
+	if ( readImageStreamInfo( f, info ) != 0 ) {
+		cerr << "Error: Invalid image stream header\n";
+		fclose( f );
+		return 1;
+	}
+
+	if ( preparePage( ctx ) != 0 ) {
+		fclose( f );
+		return 1;
+	}
+
+	if ( info.content == "glyphs" ) {
+		int ret = addGlyphStream( ctx, f, info, color );
+		fclose( f );
+		return ret;
+	}
+
+	bool isMask = ( info.bpc == 1 );
+	ObjectIDType colorSpace = isMask ? 0 : writeSeparation( ctx, color );
+	ObjectsContext &objects = ctx->pdfWriter.GetObjectsContext();
+	ObjectIDType imageId = objects.StartNewIndirectObject();
+	DictionaryContext *dict = objects.StartDictionary();
+
+	dict->WriteKey( "Type" );
+	dict->WriteNameValue( "XObject" );
+	dict->WriteKey( "Subtype" );
+	dict->WriteNameValue( "Image" );
+	dict->WriteKey( "Width" );
+	dict->WriteIntegerValue( info.width );
+	dict->WriteKey( "Height" );
+	dict->WriteIntegerValue( info.height );
+	dict->WriteKey( "BitsPerComponent" );
+	dict->WriteIntegerValue( info.bpc );
+
+	if ( isMask ) {
+		//  (ޣ)  G4  JBIG2 .
+		dict->WriteKey( "ImageMask" );
+		dict->WriteBooleanValue( true );
+		dict->WriteKey( "Decode" );
+		objects.StartArray();
+		objects.WriteInteger( 1 );
+		objects.WriteInteger( 0 );
+		objects.EndArray( eTokenSeparatorEndLine );
+	} else {
+		//  --  : 0  .
+		dict->WriteKey( "ColorSpace" );
+		dict->WriteObjectReferenceValue( colorSpace );
+		dict->WriteKey( "Decode" );
+		objects.StartArray();
+		objects.WriteInteger( info.miniswhite ? 0 : 1 );
+		objects.WriteInteger( info.miniswhite ? 1 : 0 );
+		objects.EndArray( eTokenSeparatorEndLine );
+	}
+
+	dict->WriteKey( "Filter" );
+	dict->WriteNameValue( info.filter );
+	if ( info.filter == "CCITTFaxDecode" ) {
+		dict->WriteKey( "DecodeParms" );
+		DictionaryContext *parms = objects.StartDictionary();
+		parms->WriteKey( "K" );
+		parms->WriteIntegerValue( -1 );
+		parms->WriteKey( "Columns" );
+		parms->WriteIntegerValue( info.width );
+		parms->WriteKey( "Rows" );
+		parms->WriteIntegerValue( info.height );
+		parms->WriteKey( "BlackIs1" );
+		parms->WriteBooleanValue( true );
+		objects.EndDictionary( parms );
+	}
+
+	//        .
+	PDFStream *stream = objects.StartUnfilteredPDFStream( dict );
+	IByteWriter *writer = stream->GetWriteStream();
+	IOBasicTypes::Byte buf[65536];
+	size_t n;
+	while ( ( n = fread( buf, 1, sizeof(buf), f ) ) > 0 )
+		writer->Write( buf, n );
+	objects.EndPDFStream( stream );
+	delete stream;
+
+	bool failed = ferror( f );
+	fclose( f );
+	if ( failed ) {
+		cerr << "Error reading the image file!\n";
+		return 1;
+	}
+
+	string imageName =
+		ctx->pdfPage->GetResourcesDictionary().
+		      AddImageXObjectMapping( imageId );
+
+	if ( ctx->verbose )
+		cerr << "Add the image " << imageName << " to the document\n";
+	appendLayer( ctx, imageName, true, isMask, color );
 
 	return 0;
 }
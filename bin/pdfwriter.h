@@ -58,13 +58,19 @@ typedef enum {
 
 /**
  *  PDF  #filename  .  
- *   #width  #height.
+ *   #width  #height.    #verbose, 
+ *     .
+ *   ,     
+ *  .
  *      #NULL   .
  */
-void * pdf_open_file( const char *filename, double width, double height );
+void * pdf_open_file( const char *filename, double width, double height,
+					  int verbose );
 
 /**
  *   PDF #ctx     #tifffile.
+ *     TIFF   ,
+ *     PDF.
  *  #color   .
  *  0   ,  -0   .
  */
@@ -72,11 +78,22 @@ int pdf_add_bitmap( void *ctx, const char *tifffile, pdfcolor_t color );
 
 /**
  *   PDF #ctx     #tifffile.
+ *     TIFF   ,
+ *     PDF.
  *  #color   .
  *  0   ,  -0   .
  */
 int pdf_add_tonemap( void *ctx, const char *tifffile, pdfcolor_t color );
 
+/**
+ *    PDF #ctx:    
+ *    ţ  .     
+ *   #width x #height. ,   
+ * ( ,  ),   .
+ *  0   ,  -0   .
+ */
+int pdf_next_page( void *ctx, double width, double height );
+
 /**
  *     PDF .
  */
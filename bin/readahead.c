@@ -0,0 +1,266 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*     . */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "readahead.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+
+/**
+ *  :     .
+ */
+struct readahead_slot {
+	char *data;		/*  . */
+	size_t rows;	/*   (0 ---   ). */
+	int full;		/*   . */
+};
+
+/**
+ *   .
+ */
+struct readahead {
+	readahead_row_f read_row;
+	void *arg;
+	size_t rowsize;			/*    . */
+	unsigned long height;	/*   . */
+	size_t batch;			/*    . */
+
+	struct readahead_slot *slots;	/*  . */
+	int depth;				/*  . */
+	unsigned long head;		/*  ,  . */
+	unsigned long tail;		/*  ,  . */
+	int taken;				/*    . */
+	int stop;				/*   . */
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/**
+ *   .
+ */
+static void *
+readahead_main( void *arg )
+{
+	struct readahead *ra = arg;
+	struct readahead_slot *slot;
+	unsigned long y = 0;
+	size_t i, rows;
+	int err = 0;
+
+	pthread_mutex_lock( &ra->lock );
+	while ( !ra->stop ) {
+		/*   . */
+		slot = &ra->slots[ra->head % ra->depth];
+		while ( !ra->stop && slot->full )
+			pthread_cond_wait( &ra->cond, &ra->lock );
+		if ( ra->stop ) break;
+		pthread_mutex_unlock( &ra->lock );
+
+		rows = 0;
+		if ( !err ) {
+			for ( i = 0; i < ra->batch && y < ra->height; i++, y++ ) {
+				if ( ra->read_row( ra->arg, y, slot->data + i*ra->rowsize )
+					 != 0 )
+				{
+					err = 1;
+					break;
+				}
+				rows++;
+			}
+			if ( err ) rows = 0;
+		}
+
+		pthread_mutex_lock( &ra->lock );
+		slot->rows = rows;
+		slot->full = 1;
+		ra->head++;
+		pthread_cond_broadcast( &ra->cond );
+
+		/*        . */
+		if ( rows == 0 ) break;
+	}
+	pthread_mutex_unlock( &ra->lock );
+
+	return NULL;
+}
+
+/**
+ *    #height   #rowsize  
+ * #read_row   #batch     #depth
+ * .      NULL,  
+ *    .
+ */
+struct readahead *
+readahead_start( readahead_row_f read_row, void *arg, size_t rowsize,
+				 unsigned long height, size_t batch, int depth )
+{
+	struct readahead *ra;
+	int i;
+
+	ra = calloc( 1, sizeof(struct readahead) );
+	if ( ra == NULL ) return NULL;
+
+	ra->read_row = read_row;
+	ra->arg = arg;
+	ra->rowsize = rowsize;
+	ra->height = height;
+	ra->batch = batch;
+	/*     . */
+	ra->depth = depth + 1;
+
+	ra->slots = calloc( ra->depth, sizeof(struct readahead_slot) );
+	if ( ra->slots == NULL ) {
+		free( ra );
+		return NULL;
+	}
+	for ( i = 0; i < ra->depth; i++ ) {
+		ra->slots[i].data = malloc( batch * rowsize );
+		if ( ra->slots[i].data == NULL ) {
+			while ( --i >= 0 )
+				free( ra->slots[i].data );
+			free( ra->slots );
+			free( ra );
+			return NULL;
+		}
+	}
+
+	pthread_mutex_init( &ra->lock, NULL );
+	pthread_cond_init( &ra->cond, NULL );
+
+	if ( pthread_create( &ra->thread, NULL, readahead_main, ra ) != 0 ) {
+		pthread_mutex_destroy( &ra->lock );
+		pthread_cond_destroy( &ra->cond );
+		for ( i = 0; i < ra->depth; i++ )
+			free( ra->slots[i].data );
+		free( ra->slots );
+		free( ra );
+		return NULL;
+	}
+
+	return ra;
+}
+
+/**
+ *         
+ *   #rows.        .
+ *          NULL.
+ */
+char *
+readahead_next( struct readahead *ra, size_t *rows )
+{
+	struct readahead_slot *slot;
+
+	pthread_mutex_lock( &ra->lock );
+
+	/*     . */
+	if ( ra->taken ) {
+		ra->slots[ra->tail % ra->depth].full = 0;
+		ra->tail++;
+		ra->taken = 0;
+		pthread_cond_broadcast( &ra->cond );
+	}
+
+	slot = &ra->slots[ra->tail % ra->depth];
+	while ( !slot->full )
+		pthread_cond_wait( &ra->cond, &ra->lock );
+
+	*rows = slot->rows;
+	if ( slot->rows > 0 )
+		ra->taken = 1;
+
+	pthread_mutex_unlock( &ra->lock );
+
+	return slot->rows > 0 ? slot->data : NULL;
+}
+
+/**
+ *      .
+ */
+void
+readahead_stop( struct readahead *ra )
+{
+	int i;
+
+	if ( ra == NULL ) return;
+
+	pthread_mutex_lock( &ra->lock );
+	ra->stop = 1;
+	pthread_cond_broadcast( &ra->cond );
+	pthread_mutex_unlock( &ra->lock );
+
+	pthread_join( ra->thread, NULL );
+	pthread_mutex_destroy( &ra->lock );
+	pthread_cond_destroy( &ra->cond );
+
+	for ( i = 0; i < ra->depth; i++ )
+		free( ra->slots[i].data );
+	free( ra->slots );
+	free( ra );
+}
+
+#else /* HAVE_PTHREAD_H */
+
+/*       . */
+
+struct readahead *
+readahead_start( readahead_row_f read_row, void *arg, size_t rowsize,
+				 unsigned long height, size_t batch, int depth )
+{
+	return NULL;
+}
+
+char *
+readahead_next( struct readahead *ra, size_t *rows )
+{
+	*rows = 0;
+	return NULL;
+}
+
+void
+readahead_stop( struct readahead *ra )
+{
+}
+
+#endif /* HAVE_PTHREAD_H */
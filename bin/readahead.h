@@ -0,0 +1,81 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __READAHEAD_H
+#define __READAHEAD_H
+
+/*     .
+ *
+ *         
+ *        ,  
+ *     .  
+ *  ߣ   .
+ */
+
+/**
+ *     #y    #dst. 
+ *  #arg   .  0   .
+ */
+typedef int (*readahead_row_f)( void *arg, unsigned long y, char *dst );
+
+/*   . */
+struct readahead;
+
+/**
+ *    #height   #rowsize  
+ * #read_row   #batch     #depth
+ * .      NULL,  
+ *    .
+ */
+struct readahead *readahead_start( readahead_row_f read_row, void *arg,
+								   size_t rowsize, unsigned long height,
+								   size_t batch, int depth );
+
+/**
+ *         
+ *   #rows.        .
+ *          NULL.
+ */
+char *readahead_next( struct readahead *ra, size_t *rows );
+
+/**
+ *      .
+ */
+void readahead_stop( struct readahead *ra );
+
+#endif /* __READAHEAD_H */
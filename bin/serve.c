@@ -0,0 +1,351 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*  : ɣ     Unix-. */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "serve.h"
+
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+
+/*  ,    . */
+extern char *program_name;
+
+/*     . */
+#define MAXREQUEST 65536
+
+/*    . */
+#define MAXARGS 1024
+
+/*     . */
+#define MAXFDS 3
+
+/**
+ *  ,   .
+ */
+struct serve_request {
+	char data[MAXREQUEST];
+	size_t len;
+	int fds[MAXFDS];
+	int nfds;
+};
+
+/**
+ *     .
+ */
+static double
+serve_now()
+{
+	struct timeval tv;
+
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ *   ,    #req.
+ */
+static void
+close_request_fds( struct serve_request *req )
+{
+	int i;
+
+	for ( i = 0; i < req->nfds; i++ )
+		close( req->fds[i] );
+	req->nfds = 0;
+}
+
+/**
+ *     #fd   #req.
+ *        
+ * ;      #MAXFDS, 
+ * .  0     -0   .
+ */
+static int
+read_request( int fd, struct serve_request *req )
+{
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char cbuf[CMSG_SPACE( MAXFDS * sizeof(int) )];
+	int rfds[sizeof(cbuf) / sizeof(int)];
+	int i, n;
+	int extra = 0;
+	ssize_t rd;
+
+	req->len = 0;
+	req->nfds = 0;
+
+	while ( req->len < sizeof(req->data) ) {
+		memset( &msg, 0, sizeof(msg) );
+		iov.iov_base = req->data + req->len;
+		iov.iov_len = sizeof(req->data) - req->len;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cbuf;
+		msg.msg_controllen = sizeof(cbuf);
+
+		rd = recvmsg( fd, &msg, 0 );
+		if ( rd < 0 && errno == EINTR ) continue;
+		if ( rd <= 0 ) {
+			close_request_fds( req );
+			return 1;
+		}
+
+		for ( cmsg = CMSG_FIRSTHDR( &msg ); cmsg != NULL;
+			  cmsg = CMSG_NXTHDR( &msg, cmsg ) )
+		{
+			if ( cmsg->cmsg_level != SOL_SOCKET ||
+				 cmsg->cmsg_type != SCM_RIGHTS )
+				continue;
+
+			n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			if ( n > (int) (sizeof(rfds) / sizeof(int)) )
+				n = sizeof(rfds) / sizeof(int);
+			memcpy( rfds, CMSG_DATA( cmsg ), n * sizeof(int) );
+			for ( i = 0; i < n; i++ ) {
+				if ( req->nfds < MAXFDS ) {
+					req->fds[req->nfds++] = rfds[i];
+				} else {
+					close( rfds[i] );
+					extra = 1;
+				}
+			}
+		}
+
+		/*   #MAXFDS,     
+		 *     :  . */
+		if ( extra || (msg.msg_flags & MSG_CTRUNC) ) {
+			fprintf( stderr, "%s: Too many descriptors passed with "
+					 "the job\n", program_name );
+			close_request_fds( req );
+			return 1;
+		}
+
+		req->len += rd;
+
+		/*    . */
+		if ( req->len == 1 && req->data[0] == '\0' )
+			return 0;
+		if ( req->len > 1 && req->data[req->len - 1] == '\0' &&
+			 req->data[req->len - 2] == '\0' )
+			return 0;
+	}
+
+	close_request_fds( req );
+	return 1;
+}
+
+/**
+ *   #req    #argv,  
+ * #argv[1].     ޣ #argv[0].
+ */
+static int
+parse_request( struct serve_request *req, char **argv )
+{
+	int argc = 1;
+	char *p = req->data;
+	char *end = req->data + req->len;
+
+	while ( p < end && *p != '\0' && argc < MAXARGS - 1 ) {
+		argv[argc++] = p;
+		p += strlen( p ) + 1;
+	}
+	argv[argc] = NULL;
+
+	return argc;
+}
+
+/**
+ *  ,    #fd,  
+ *        .
+ */
+static void
+serve_connection( int fd, serve_job_f job )
+{
+	static struct serve_request req;
+	char *argv[MAXARGS];
+	int argc;
+	pid_t pid;
+	int status = 0;
+	int i, n;
+	struct rusage ru;
+	double start;
+	char reply[256];
+
+	if ( read_request( fd, &req ) != 0 ) {
+		fprintf( stderr, "%s: Unable to read the job request\n",
+				 program_name );
+		return;
+	}
+
+	argv[0] = program_name;
+	argc = parse_request( &req, argv );
+
+	start = serve_now();
+	pid = fork();
+	if ( pid < 0 ) {
+		fprintf( stderr, "%s: Unable to start the job\n", program_name );
+		return;
+	}
+
+	if ( pid == 0 ) {
+		/*  :   
+		 *  .    
+		 * ,  dup2()   ݣ  ӣ
+		 * ,     . */
+		signal( SIGPIPE, SIG_DFL );
+		close( fd );
+		for ( i = 0; i < req.nfds; i++ ) {
+			if ( req.fds[i] > 2 ) continue;
+			n = fcntl( req.fds[i], F_DUPFD, 3 );
+			if ( n < 0 ) _exit( EXIT_FAILURE );
+			close( req.fds[i] );
+			req.fds[i] = n;
+		}
+		for ( i = 0; i < req.nfds; i++ ) {
+			if ( dup2( req.fds[i], i ) < 0 ) _exit( EXIT_FAILURE );
+			close( req.fds[i] );
+		}
+		exit( job( argc, argv ) );
+	}
+
+	for ( i = 0; i < req.nfds; i++ )
+		close( req.fds[i] );
+
+	memset( &ru, 0, sizeof(ru) );
+	while ( wait4( pid, &status, 0, &ru ) < 0 && errno == EINTR );
+
+	snprintf( reply, sizeof(reply),
+			  "{\"status\":%d,\"wall\":%.3f,\"user\":%.3f,\"sys\":%.3f,"
+			  "\"maxrss\":%ld}\n",
+			  WIFEXITED( status ) ? WEXITSTATUS( status ) : -1,
+			  serve_now() - start,
+			  ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6,
+			  ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6,
+			  ru.ru_maxrss );
+	if ( write( fd, reply, strlen( reply ) ) < 0 ) {
+		fprintf( stderr, "%s: Unable to send the job status\n",
+				 program_name );
+	}
+}
+
+/**
+ *    Unix- #sockpath.  
+ *   #job   , ģ 
+ *  .      .
+ */
+int
+serve( const char *sockpath, serve_job_f job )
+{
+	int sfd, fd;
+	struct sockaddr_un addr;
+	pid_t pid;
+
+	/*  ,    , 
+	 *  /dev/null,        
+	 *       . */
+	while ( (fd = open( "/dev/null", O_RDWR )) >= 0 && fd <= 2 );
+	if ( fd > 2 )
+		close( fd );
+
+	if ( strlen( sockpath ) >= sizeof(addr.sun_path) ) {
+		fprintf( stderr, "%s: Socket path is too long: %s\n",
+				 program_name, sockpath );
+		return EXIT_FAILURE;
+	}
+
+	sfd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( sfd < 0 ) {
+		fprintf( stderr, "%s: Unable to create socket\n", program_name );
+		return EXIT_FAILURE;
+	}
+
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	strcpy( addr.sun_path, sockpath );
+	unlink( sockpath );
+
+	if ( bind( sfd, (struct sockaddr *) &addr, sizeof(addr) ) != 0 ||
+		 listen( sfd, 16 ) != 0 )
+	{
+		fprintf( stderr, "%s: Unable to listen on %s\n", program_name,
+				 sockpath );
+		close( sfd );
+		return EXIT_FAILURE;
+	}
+
+	/* ۣ    . */
+	signal( SIGCHLD, SIG_IGN );
+	signal( SIGPIPE, SIG_IGN );
+
+	for (;;) {
+		fd = accept( sfd, NULL, NULL );
+		if ( fd < 0 ) {
+			if ( errno == EINTR ) continue;
+			fprintf( stderr, "%s: Unable to accept a connection\n",
+					 program_name );
+			close( sfd );
+			return EXIT_FAILURE;
+		}
+
+		pid = fork();
+		if ( pid == 0 ) {
+			/*     
+			 * . */
+			signal( SIGCHLD, SIG_DFL );
+			close( sfd );
+			serve_connection( fd, job );
+			close( fd );
+			_exit( 0 );
+		} else if ( pid < 0 ) {
+			fprintf( stderr, "%s: Unable to handle a connection\n",
+					 program_name );
+		}
+
+		close( fd );
+	}
+}
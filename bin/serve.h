@@ -0,0 +1,81 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __SERVE_H
+#define __SERVE_H
+
+/*  : ɣ     Unix-.
+ *
+ *          
+ *    (  ),   
+ *   '\0'.    
+ * .       
+ * (SCM_RIGHTS)  ң  ,  
+ *  ,     .  ,
+ *         
+ *   /dev/stdin,     --- '--output=-'.
+ *
+ *          
+ * JSON       :
+ *
+ *   {"status":0,"wall":0.125,"user":0.090,"sys":0.012,"maxrss":10240}
+ *
+ *     , ģ  :
+ *    ,   
+ *  (      
+ * PDF).  ,     PDF
+ *     .
+ */
+
+/**
+ *     .  
+ *   (#argv[0] ---  )  
+ *  .
+ */
+typedef int (*serve_job_f)( int argc, char **argv );
+
+/**
+ *    Unix- #sockpath.  
+ *   #job   , ģ 
+ *  ,      
+ * (,   )  .
+ *      ,   .
+ */
+int serve( const char *sockpath, serve_job_f job );
+
+#endif /* __SERVE_H */
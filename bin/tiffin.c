@@ -0,0 +1,487 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*    TIFF . */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "tiffin.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/*       . */
+#define TIFFIN_DEPTH_PER_THREAD 2
+
+/*   . */
+enum { BAND_FREE, BAND_BUSY, BAND_READY, BAND_ERROR };
+
+/**
+ *   .
+ */
+struct tiffin_band {
+	unsigned char *data;	/*  . */
+	uint32 y;		/*   . */
+	uint32 rows;	/*  . */
+	uint32 index;	/*    . */
+	int state;		/*  . */
+};
+
+/**
+ *   .
+ */
+struct tiffin_worker {
+	struct tiffin *in;
+	TIFF *tif;			/*   . */
+	unsigned char *raw;	/*     . */
+#ifdef HAVE_PTHREAD_H
+	pthread_t thread;
+#endif
+};
+
+/**
+ *    .
+ */
+struct tiffin {
+	TIFF *tif;			/*  . */
+	uint32 width;		/*  . */
+	uint32 height;		/*  . */
+	size_t ss;			/*    . */
+	size_t smp;			/*    ޣ (1  2). */
+	uint16 planar;		/*  PlanarConfiguration. */
+	int tiled;			/*  ,   . */
+	uint32 tile_width;	/*  . */
+	uint32 band_height;	/*   (   TIFF). */
+	tmsize_t raw_size;	/*     . */
+	uint32 nbands;		/*    . */
+
+	/*   .     
+	 *  . */
+	struct tiffin_band *bands;
+	int depth;			/*   . */
+	struct tiffin_band *cur;	/*  . */
+
+	/*  . */
+	struct tiffin_worker *workers;
+	int nworkers;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32 next_band;	/*     . */
+	uint32 read_band;	/*  ,  . */
+	int stop;			/*    . */
+#endif
+};
+
+/**
+ *  #rows   #cols    
+ * #src    #src_width     #dst,
+ *    #x.  #sample < 0,    
+ * ޣ ,  ---  ޣ   .
+ */
+static void
+copy_raw( struct tiffin *in, unsigned char *band, const unsigned char *src,
+		  uint32 src_width, uint32 x, uint32 cols, uint32 rows, int sample )
+{
+	uint32 r, i;
+	unsigned char *dst;
+
+	for ( r = 0; r < rows; r++ ) {
+		dst = band + ((size_t) r * in->width + x) * in->ss;
+		if ( sample < 0 ) {
+			memcpy( dst, src + (size_t) r * src_width * in->ss,
+					cols * in->ss );
+		} else {
+			const unsigned char *s = src + (size_t) r * src_width * in->smp;
+			dst += sample * in->smp;
+			for ( i = 0; i < cols; i++ ) {
+				memcpy( dst, s + i * in->smp, in->smp );
+				dst += in->ss;
+			}
+		}
+	}
+}
+
+/**
+ *   #b   #tif   #band, 
+ * #raw   .  0   .
+ */
+static int
+decode_band( struct tiffin *in, TIFF *tif, unsigned char *raw,
+			 struct tiffin_band *band, uint32 b )
+{
+	uint32 y0 = b * in->band_height;
+	uint32 rows = in->band_height;
+	uint32 x, cols;
+	int s, nplanes;
+
+	if ( y0 + rows > in->height )
+		rows = in->height - y0;
+
+	nplanes = in->planar == PLANARCONFIG_SEPARATE ? in->ss / in->smp : 1;
+
+	if ( !in->tiled ) {
+		if ( nplanes == 1 ) {
+			if ( TIFFReadEncodedStrip( tif, TIFFComputeStrip( tif, y0, 0 ),
+									   band->data,
+									   (tmsize_t) rows * in->width * in->ss )
+				 < 0 )
+				return 1;
+		} else {
+			for ( s = 0; s < nplanes; s++ ) {
+				if ( TIFFReadEncodedStrip( tif,
+										   TIFFComputeStrip( tif, y0, s ),
+										   raw,
+										   (tmsize_t) rows * in->width *
+										   in->smp )
+					 < 0 )
+					return 1;
+				copy_raw( in, band->data, raw, in->width, 0, in->width,
+						  rows, s );
+			}
+		}
+	} else {
+		for ( x = 0; x < in->width; x += in->tile_width ) {
+			cols = in->tile_width;
+			if ( x + cols > in->width )
+				cols = in->width - x;
+			for ( s = 0; s < nplanes; s++ ) {
+				if ( TIFFReadEncodedTile( tif,
+										  TIFFComputeTile( tif, x, y0, 0, s ),
+										  raw, (tmsize_t) -1 ) < 0 )
+					return 1;
+				copy_raw( in, band->data, raw, in->tile_width, x, cols, rows,
+						  nplanes == 1 ? -1 : s );
+			}
+		}
+	}
+
+	band->y = y0;
+	band->rows = rows;
+	band->index = b;
+
+	return 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+/**
+ *   :   ,   ţ
+ *   ,   ţ.
+ */
+static void *
+worker_main( void *arg )
+{
+	struct tiffin_worker *w = arg;
+	struct tiffin *in = w->in;
+	struct tiffin_band *band;
+	uint32 b;
+	int ret;
+
+	pthread_mutex_lock( &in->lock );
+	for (;;) {
+		/*  ,    . */
+		while ( !in->stop && in->next_band < in->nbands &&
+				in->next_band >= in->read_band + in->depth )
+			pthread_cond_wait( &in->cond, &in->lock );
+		if ( in->stop || in->next_band >= in->nbands )
+			break;
+
+		b = in->next_band++;
+		band = &in->bands[b % in->depth];
+		band->state = BAND_BUSY;
+		pthread_mutex_unlock( &in->lock );
+
+		ret = decode_band( in, w->tif, w->raw, band, b );
+
+		pthread_mutex_lock( &in->lock );
+		band->index = b;
+		band->state = ret == 0 ? BAND_READY : BAND_ERROR;
+		pthread_cond_broadcast( &in->cond );
+	}
+	pthread_mutex_unlock( &in->lock );
+
+	return NULL;
+}
+
+/**
+ *  #n  ,    
+ *  #file_name.  0   ;    
+ *  ,   .
+ */
+static int
+start_workers( struct tiffin *in, const char *file_name, int n )
+{
+	int i;
+
+	in->workers = calloc( n, sizeof(struct tiffin_worker) );
+	if ( in->workers == NULL ) return 1;
+
+	pthread_mutex_init( &in->lock, NULL );
+	pthread_cond_init( &in->cond, NULL );
+
+	for ( i = 0; i < n; i++ ) {
+		struct tiffin_worker *w = &in->workers[i];
+
+		w->in = in;
+		w->tif = TIFFOpen( file_name, "r" );
+		w->raw = _TIFFmalloc( in->raw_size );
+		if ( w->tif == NULL || w->raw == NULL ||
+			 pthread_create( &w->thread, NULL, worker_main, w ) != 0 )
+		{
+			if ( w->tif != NULL ) TIFFClose( w->tif );
+			if ( w->raw != NULL ) _TIFFfree( w->raw );
+			w->tif = NULL;
+			w->raw = NULL;
+			break;
+		}
+		in->nworkers++;
+	}
+
+	if ( in->nworkers == 0 ) {
+		pthread_mutex_destroy( &in->lock );
+		pthread_cond_destroy( &in->cond );
+		free( in->workers );
+		in->workers = NULL;
+		return 1;
+	}
+
+	return 0;
+}
+#endif
+
+/**
+ *    #tif . 
+ *  #ss    (8-  16- ޣ
+ *   , 16- --    ).  #threads > 1, 
+ *     #threads ,   
+ *   #file_name ;     
+ *   .      NULL
+ *   .
+ */
+struct tiffin *
+tiffin_open( TIFF *tif, const char *file_name, size_t ss, int threads )
+{
+	struct tiffin *in;
+	uint16 bps = 8;
+	uint32 tile_height;
+	int i;
+
+	TIFFGetFieldDefaulted( tif, TIFFTAG_BITSPERSAMPLE, &bps );
+	if ( bps != 8 && bps != 16 ) {
+		fprintf( stderr, "Unsupported number of bits per sample: %u\n",
+				 bps );
+		return NULL;
+	}
+
+	in = calloc( 1, sizeof(struct tiffin) );
+	if ( in == NULL ) return NULL;
+
+	in->tif = tif;
+	in->ss = ss;
+	in->smp = bps / 8;
+	TIFFGetField( tif, TIFFTAG_IMAGEWIDTH, &in->width );
+	TIFFGetField( tif, TIFFTAG_IMAGELENGTH, &in->height );
+	in->planar = PLANARCONFIG_CONTIG;
+	TIFFGetFieldDefaulted( tif, TIFFTAG_PLANARCONFIG, &in->planar );
+	in->tiled = TIFFIsTiled( tif );
+
+	if ( in->tiled ) {
+		TIFFGetField( tif, TIFFTAG_TILEWIDTH, &in->tile_width );
+		TIFFGetField( tif, TIFFTAG_TILELENGTH, &tile_height );
+		in->band_height = tile_height;
+		in->raw_size = TIFFTileSize( tif );
+	} else {
+		in->band_height = in->height;
+		TIFFGetFieldDefaulted( tif, TIFFTAG_ROWSPERSTRIP,
+							   &in->band_height );
+		if ( in->band_height > in->height )
+			in->band_height = in->height;
+		in->raw_size = TIFFStripSize( tif );
+	}
+	in->nbands = (in->height + in->band_height - 1) / in->band_height;
+
+	/*    ,    . */
+#ifdef HAVE_PTHREAD_H
+	if ( threads > (int) in->nbands )
+		threads = in->nbands;
+#else
+	threads = 1;
+#endif
+	in->depth = threads > 1 ? threads * TIFFIN_DEPTH_PER_THREAD : 1;
+
+	in->bands = calloc( in->depth, sizeof(struct tiffin_band) );
+	if ( in->bands == NULL ) {
+		tiffin_close( in );
+		return NULL;
+	}
+	for ( i = 0; i < in->depth; i++ ) {
+		in->bands[i].data =
+			_TIFFmalloc( (tmsize_t) in->band_height * in->width * ss );
+		if ( in->bands[i].data == NULL ) {
+			tiffin_close( in );
+			return NULL;
+		}
+	}
+
+#ifdef HAVE_PTHREAD_H
+	if ( threads > 1 ) {
+		/*     ,  
+		 *   . */
+		if ( start_workers( in, file_name, threads ) == 0 )
+			return in;
+		fprintf( stderr, "Unable to start TIFF decoding threads, "
+				 "decoding serially\n" );
+	}
+#endif
+
+	/*       . 
+	 *   ޣ    
+	 *   . */
+	in->workers = calloc( 1, sizeof(struct tiffin_worker) );
+	if ( in->workers == NULL ) {
+		tiffin_close( in );
+		return NULL;
+	}
+	in->workers[0].in = in;
+	in->workers[0].tif = tif;
+	if ( in->tiled || in->planar == PLANARCONFIG_SEPARATE ) {
+		in->workers[0].raw = _TIFFmalloc( in->raw_size );
+		if ( in->workers[0].raw == NULL ) {
+			tiffin_close( in );
+			return NULL;
+		}
+	}
+
+	return in;
+}
+
+/**
+ *     #y    .
+ *     .   
+ *   NULL.
+ */
+unsigned char *
+tiffin_read_row( struct tiffin *in, uint32 y )
+{
+	struct tiffin_band *band = in->cur;
+	uint32 b;
+
+	if ( y >= in->height )
+		return NULL;
+
+	if ( band == NULL || y < band->y || y >= band->y + band->rows ) {
+		b = y / in->band_height;
+#ifdef HAVE_PTHREAD_H
+		if ( in->nworkers > 0 ) {
+			/*     
+			 *   . */
+			pthread_mutex_lock( &in->lock );
+			if ( b < in->read_band ) {
+				pthread_mutex_unlock( &in->lock );
+				fprintf( stderr, "BUG: TIFF rows are read out of order\n" );
+				return NULL;
+			}
+			in->read_band = b;
+			pthread_cond_broadcast( &in->cond );
+			band = &in->bands[b % in->depth];
+			while ( !(band->index == b && (band->state == BAND_READY ||
+										   band->state == BAND_ERROR)) )
+				pthread_cond_wait( &in->cond, &in->lock );
+			pthread_mutex_unlock( &in->lock );
+			if ( band->state == BAND_ERROR ) {
+				in->cur = NULL;
+				return NULL;
+			}
+			in->cur = band;
+			return band->data + (size_t) (y - band->y) * in->width * in->ss;
+		}
+#endif
+		band = &in->bands[0];
+		if ( decode_band( in, in->tif, in->workers[0].raw, band, b ) != 0 ) {
+			in->cur = NULL;
+			return NULL;
+		}
+		in->cur = band;
+	}
+
+	return band->data + (size_t) (y - band->y) * in->width * in->ss;
+}
+
+/**
+ *   .    .
+ */
+void
+tiffin_close( struct tiffin *in )
+{
+	int i;
+
+	if ( in == NULL ) return;
+
+#ifdef HAVE_PTHREAD_H
+	if ( in->nworkers > 0 ) {
+		pthread_mutex_lock( &in->lock );
+		in->stop = 1;
+		pthread_cond_broadcast( &in->cond );
+		pthread_mutex_unlock( &in->lock );
+		for ( i = 0; i < in->nworkers; i++ ) {
+			pthread_join( in->workers[i].thread, NULL );
+			TIFFClose( in->workers[i].tif );
+			_TIFFfree( in->workers[i].raw );
+		}
+		pthread_mutex_destroy( &in->lock );
+		pthread_cond_destroy( &in->cond );
+	}
+#endif
+
+	/*     . */
+	if ( in->workers != NULL ) {
+		if ( in->nworkers == 0 && in->workers[0].raw != NULL )
+			_TIFFfree( in->workers[0].raw );
+		free( in->workers );
+	}
+
+	if ( in->bands != NULL ) {
+		for ( i = 0; i < in->depth; i++ )
+			if ( in->bands[i].data != NULL )
+				_TIFFfree( in->bands[i].data );
+		free( in->bands );
+	}
+	free( in );
+}
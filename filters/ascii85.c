@@ -44,8 +44,10 @@ ASCII-85. */
 #include "system.h"
 #include "ascii85.h"
 
-void * ascii85_open_tilemap( const char *outfile, int mask );
-void * ascii85_open_tonemap( const char *outfile );
+void * ascii85_open_tilemap( const struct filter_params *params,
+							 FILE *out, int mask );
+void * ascii85_open_tonemap( const struct filter_params *params,
+							 FILE *out );
 void ascii85_write_tile_lines( void *ctx, unsigned int zl );
 void ascii85_write_spaces( void *ctx, unsigned int z );
 void ascii85_write_tile( void *ctx, unsigned char tile_index,
@@ -78,26 +80,30 @@ struct ascii85 {
 	char tuple[6];
 	int is_tilemap;
 	FILE *file;
+	struct filter_params params;
 };
 
 /*     . */
 #define LINEWIDTH 75
 
-static struct ascii85 *new_ascii85( const char *outfile );
-static void write_tilemap_header( FILE *stream, int mask );
+static struct ascii85 *new_ascii85( const struct filter_params *params,
+									FILE *out );
+static void write_tilemap_header( struct ascii85 *a, int mask );
 
 /**
  *   ASCII-85    
- *   #outfile.   #mask 
- *  ().    .
+ *    #params   #out. 
+ *  #mask   (). 
+ *   .
  */
 struct ascii85 *
-_ascii85_open_tilemap( const char *outfile, int mask )
+_ascii85_open_tilemap( const struct filter_params *params,
+					   FILE *out, int mask )
 {
-	struct ascii85 * ctx = new_ascii85( outfile );
+	struct ascii85 * ctx = new_ascii85( params, out );
 	if ( ctx ) {
 		ctx->is_tilemap = 1;
-		write_tilemap_header( ctx->file, mask );
+		write_tilemap_header( ctx, mask );
 	}
 	
 	return ctx;
@@ -105,44 +111,48 @@ _ascii85_open_tilemap( const char *outfile, int mask )
 
 /**
  *   ASCII-85    
- *   #outfile.   #mask 
+ *   #out.   #mask 
  *  ().  £ 
  * _ascii85_open_tilemap().    ,
  *      .
  */
 void *
-ascii85_open_tilemap( const char *outfile, int mask )
+ascii85_open_tilemap( const struct filter_params *params,
+					  FILE *out, int mask )
 {
-	return (void *) _ascii85_open_tilemap( outfile, mask );
+	return (void *) _ascii85_open_tilemap( params, out, mask );
 }
 
 
-static void write_tonemap_header( FILE *stream );
+static void write_tonemap_header( struct ascii85 *a );
 
 /**
  *   ASCII-85   
- *    #outfile.    .
+ *    #params   #out. 
+ *   .
  */
 struct ascii85 *
-_ascii85_open_tonemap( const char *outfile )
+_ascii85_open_tonemap( const struct filter_params *params,
+					   FILE *out )
 {
-	struct ascii85 * ctx = new_ascii85( outfile );
+	struct ascii85 * ctx = new_ascii85( params, out );
 	if ( ctx )
-		write_tonemap_header( ctx->file );
+		write_tonemap_header( ctx );
 	
 	return ctx;
 }
 
 /**
  *   ASCII-85   
- *    #outfile.  £ 
+ *    #out.  £ 
  * _ascii85_open_tonemap().    ,
  *      .
  */
 void *
-ascii85_open_tonemap( const char *outfile )
+ascii85_open_tonemap( const struct filter_params *params,
+					  FILE *out )
 {
-	return (void *) _ascii85_open_tonemap( outfile );
+	return (void *) _ascii85_open_tonemap( params, out );
 }
 
 
@@ -290,8 +300,8 @@ _ascii85_close( struct ascii85 *ascii85_p )
 	/*   . */
 	write_footer( ascii85_p->file );
 
-	/*  . */
-	fclose( ascii85_p->file );
+	/*   ;    . */
+	fflush( ascii85_p->file );
 
 	/*   */
 	destroy_ascii85( ascii85_p );
@@ -312,23 +322,23 @@ ascii85_close( void *ctx )
 
 /*    ,    
  *        .
- *       .
+ *       .
  */
 static struct ascii85 *
-new_ascii85( const char *outfile ) {
+new_ascii85( const struct filter_params *params, FILE *out ) {
 
 	struct ascii85 *a;
 
 	a = (struct ascii85 *) malloc(sizeof(struct ascii85));
 	if (a != NULL) {
+		a->params = *params;
 		a->line_break = LINEWIDTH;
 		a->offset = 0;
 		a->buffer[a->offset] = '\0';
 		a->is_tilemap = 0;
-		a->file = fopen( outfile, "w" );
+		a->file = out;
 		if ( a->file == NULL) {
-			fprintf( stderr, "Can't create temp file %s\n",
-					 outfile );
+			fprintf( stderr, "No output stream for the ASCII-85 layer\n" );
 			free( a );
 			a = NULL;
 		}
@@ -441,11 +451,12 @@ ascii85_flush(struct ascii85 *a) {
 
 /**
  *   PostScript-   
- *   #stream.   #mask  
- * ().
+ *    #a.   #mask 
+ *  ().
  */
 static void
-write_tilemap_header(FILE *stream, int mask) {
+write_tilemap_header(struct ascii85 *a, int mask) {
+	FILE *stream = a->file;
 	if (stream != NULL) {
 		fprintf(stream, "%% Filter: tile32 filter from "PACKAGE" "VERSION"\n"
 				"%%%%LanguageLevel 2\n"
@@ -459,20 +470,20 @@ write_tilemap_header(FILE *stream, int mask) {
 				"drawtiles\n",
 				mask ? "0.0" : "1.0",
 				mask ? "negative" : "positive",
-				(float) height/hres * 72,
-				(float) 72/hres,
-				(float) 72/vres);
+				(float) a->params.height/a->params.hres * 72,
+				(float) 72/a->params.hres,
+				(float) 72/a->params.vres);
 	}
 }
 
 /**
- *    #outfile   PostScript-
- *   .
+ *     #a  
+ * PostScript-   .
  */
 static void
-write_tonemap_header( FILE *stream )
+write_tonemap_header( struct ascii85 *a )
 {
-	fprintf(stream, "%% Filter: ct filter from "PACKAGE" "VERSION"\n"
+	fprintf(a->file, "%% Filter: ct filter from "PACKAGE" "VERSION"\n"
 			"%%%%LanguageLevel 2\n"
 			"gsave\t%% Save graphics state\n"
 			"1.0 setcolor\n"
@@ -489,11 +500,11 @@ write_tonemap_header( FILE *stream )
 			">>\n"
 			"%%%%BeginData\n"
 			"image\n",
-			(float) width/hres * 72,
-			(float) height/vres * 72,
-			width, height,
-			miniswhite ? "[0 1]" : "[1 0]",
-			width, height, height);
+			(float) a->params.width/a->params.hres * 72,
+			(float) a->params.height/a->params.vres * 72,
+			a->params.width, a->params.height,
+			a->params.miniswhite ? "[0 1]" : "[1 0]",
+			a->params.width, a->params.height, a->params.height);
 
 }
 
@@ -43,7 +43,7 @@
 /*        ,  
 ASCII-85. */
 
-#include "filter.h"
+#include "libengrave.h"
 
 /**
  *     ASCII-85.
@@ -0,0 +1,481 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*    . */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "asyncwriter.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+
+/*    . */
+#define ASYNC_BLOCK_EVENTS 8192
+
+/* ߣ  ,     . */
+#define ASYNC_BLOCK_BYTES (256 * 1024)
+
+/*  . */
+enum {
+	ASYNC_TILE_LINES,
+	ASYNC_SPACES,
+	ASYNC_TILE,
+	ASYNC_TONELINE
+};
+
+/**
+ * :    .    #a
+ *   ޣ, #n --- 
+ * ޣ,   ޣ    .
+ */
+struct async_event {
+	unsigned char op;
+	unsigned char a;
+	unsigned char b;
+	unsigned int n;
+};
+
+/**
+ *  ,   .
+ */
+struct async_block {
+	size_t nevents;			/*  . */
+	size_t nbytes;			/* ߣ   . */
+	char *data;				/*   . */
+	size_t data_size;		/*   . */
+	struct async_event events[ASYNC_BLOCK_EVENTS];
+};
+
+/**
+ *     .
+ *
+ *     ()   
+ *  ():  #head  #tail  
+ *  ,     .
+ *  ,      
+ * .
+ */
+struct async_writer {
+	void *ctx;				/*   . */
+	int threaded;			/*   . */
+
+	struct async_block **blocks;	/*  . */
+	unsigned long depth;	/*  . */
+	struct async_block *cur;	/*  . */
+	unsigned long head;		/*   . */
+	unsigned long tail;		/*   . */
+	int done;				/*   . */
+	int prod_waiting;		/*    . */
+	int cons_waiting;		/*    . */
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/*  . */
+static struct filter_writer *async_base_writer;
+
+/*    . */
+static unsigned int async_depth;
+
+/**
+ *   ,   #waiting .
+ */
+static void
+async_wake( struct async_writer *w, int *waiting )
+{
+	if ( __atomic_load_n( waiting, __ATOMIC_SEQ_CST ) ) {
+		pthread_mutex_lock( &w->lock );
+		pthread_cond_broadcast( &w->cond );
+		pthread_mutex_unlock( &w->lock );
+	}
+}
+
+/**
+ *    #b  .
+ */
+static void
+async_replay( struct async_writer *w, struct async_block *b )
+{
+	struct async_event *ev;
+	const char *data = b->data;
+	size_t i;
+
+	for ( i = 0; i < b->nevents; i++ ) {
+		ev = &b->events[i];
+		switch ( ev->op ) {
+		case ASYNC_TILE_LINES:
+			async_base_writer->write_tile_lines( w->ctx, ev->n );
+			break;
+		case ASYNC_SPACES:
+			async_base_writer->write_spaces( w->ctx, ev->n );
+			break;
+		case ASYNC_TILE:
+			async_base_writer->write_tile( w->ctx, ev->a, ev->b );
+			break;
+		case ASYNC_TONELINE:
+			async_base_writer->write_toneline( w->ctx, data, ev->a, ev->n );
+			data += ((size_t) ev->n - 1) * ev->a + 1;
+			break;
+		}
+	}
+}
+
+/**
+ *   .
+ */
+static void *
+async_main( void *arg )
+{
+	struct async_writer *w = arg;
+	unsigned long t = w->tail;
+
+	for (;;) {
+		/*   .   
+		 *     . */
+		if ( __atomic_load_n( &w->head, __ATOMIC_ACQUIRE ) == t ) {
+			pthread_mutex_lock( &w->lock );
+			__atomic_store_n( &w->cons_waiting, 1, __ATOMIC_SEQ_CST );
+			while ( __atomic_load_n( &w->head, __ATOMIC_SEQ_CST ) == t &&
+					!__atomic_load_n( &w->done, __ATOMIC_SEQ_CST ) )
+				pthread_cond_wait( &w->cond, &w->lock );
+			__atomic_store_n( &w->cons_waiting, 0, __ATOMIC_SEQ_CST );
+			pthread_mutex_unlock( &w->lock );
+			if ( __atomic_load_n( &w->head, __ATOMIC_ACQUIRE ) == t )
+				break;
+		}
+
+		async_replay( w, w->blocks[t % w->depth] );
+
+		/*  . */
+		__atomic_store_n( &w->tail, ++t, __ATOMIC_SEQ_CST );
+		async_wake( w, &w->prod_waiting );
+	}
+
+	return NULL;
+}
+
+/**
+ *     ,   ,
+ *   .
+ */
+static struct async_block *
+async_block( struct async_writer *w )
+{
+	struct async_block *b;
+
+	if ( w->cur != NULL )
+		return w->cur;
+
+	if ( w->head - __atomic_load_n( &w->tail, __ATOMIC_ACQUIRE ) >= w->depth ) {
+		pthread_mutex_lock( &w->lock );
+		__atomic_store_n( &w->prod_waiting, 1, __ATOMIC_SEQ_CST );
+		while ( w->head - __atomic_load_n( &w->tail, __ATOMIC_SEQ_CST )
+				>= w->depth )
+			pthread_cond_wait( &w->cond, &w->lock );
+		__atomic_store_n( &w->prod_waiting, 0, __ATOMIC_SEQ_CST );
+		pthread_mutex_unlock( &w->lock );
+	}
+
+	b = w->blocks[w->head % w->depth];
+	b->nevents = 0;
+	b->nbytes = 0;
+	w->cur = b;
+
+	return b;
+}
+
+/**
+ *     .
+ */
+static void
+async_publish( struct async_writer *w )
+{
+	if ( w->cur == NULL || w->cur->nevents == 0 )
+		return;
+
+	w->cur = NULL;
+	__atomic_store_n( &w->head, w->head + 1, __ATOMIC_SEQ_CST );
+	async_wake( w, &w->cons_waiting );
+}
+
+/**
+ *   #op   #a, #b  #n   .
+ *  .
+ */
+static struct async_block *
+async_push( struct async_writer *w, unsigned char op,
+			unsigned char a, unsigned char b, unsigned int n )
+{
+	struct async_block *blk = async_block( w );
+	struct async_event *ev = &blk->events[blk->nevents++];
+
+	ev->op = op;
+	ev->a = a;
+	ev->b = b;
+	ev->n = n;
+
+	return blk;
+}
+
+/**
+ *    ,   .
+ */
+static void
+async_check_full( struct async_writer *w, struct async_block *b )
+{
+	if ( b->nevents == ASYNC_BLOCK_EVENTS || b->nbytes >= ASYNC_BLOCK_BYTES )
+		async_publish( w );
+}
+
+/**
+ *   #w (   ).
+ */
+static void
+destroy_async_writer( struct async_writer *w )
+{
+	unsigned long i;
+
+	if ( w->blocks != NULL ) {
+		for ( i = 0; i < w->depth; i++ ) {
+			if ( w->blocks[i] != NULL )
+				free( w->blocks[i]->data );
+			free( w->blocks[i] );
+		}
+		free( w->blocks );
+	}
+	free( w );
+}
+
+/**
+ *     #ctx   
+ *   .    , 
+ *  .
+ */
+static void *
+async_wrap( void *ctx )
+{
+	struct async_writer *w;
+	unsigned long i;
+
+	if ( ctx == NULL )
+		return NULL;
+
+	w = calloc( 1, sizeof(*w) );
+	if ( w == NULL ) {
+		async_base_writer->close( ctx );
+		return NULL;
+	}
+	w->ctx = ctx;
+	w->depth = async_depth;
+
+	w->blocks = calloc( w->depth, sizeof(*w->blocks) );
+	if ( w->blocks == NULL )
+		return w;
+	for ( i = 0; i < w->depth; i++ ) {
+		w->blocks[i] = malloc( sizeof(struct async_block) );
+		if ( w->blocks[i] == NULL )
+			return w;
+		w->blocks[i]->data = NULL;
+		w->blocks[i]->data_size = 0;
+	}
+
+	pthread_mutex_init( &w->lock, NULL );
+	pthread_cond_init( &w->cond, NULL );
+	if ( pthread_create( &w->thread, NULL, async_main, w ) != 0 ) {
+		pthread_mutex_destroy( &w->lock );
+		pthread_cond_destroy( &w->cond );
+		return w;
+	}
+	w->threaded = 1;
+
+	return w;
+}
+
+/**
+ *  ,     .
+ */
+static void *
+async_open_tilemap( const struct filter_params *params,
+					FILE *out, int mask )
+{
+	return async_wrap( async_base_writer->open_tilemap( params, out,
+														mask ) );
+}
+
+static void *
+async_open_tonemap( const struct filter_params *params,
+					FILE *out )
+{
+	return async_wrap( async_base_writer->open_tonemap( params, out ) );
+}
+
+static void
+async_write_tile_lines( void *ctx, unsigned int zl )
+{
+	struct async_writer *w = ctx;
+
+	if ( !w->threaded ) {
+		async_base_writer->write_tile_lines( w->ctx, zl );
+		return;
+	}
+	async_check_full( w, async_push( w, ASYNC_TILE_LINES, 0, 0, zl ) );
+}
+
+static void
+async_write_spaces( void *ctx, unsigned int z )
+{
+	struct async_writer *w = ctx;
+
+	if ( !w->threaded ) {
+		async_base_writer->write_spaces( w->ctx, z );
+		return;
+	}
+	async_check_full( w, async_push( w, ASYNC_SPACES, 0, 0, z ) );
+}
+
+static void
+async_write_tile( void *ctx, unsigned char tile_index,
+				  unsigned char tile_area )
+{
+	struct async_writer *w = ctx;
+
+	if ( !w->threaded ) {
+		async_base_writer->write_tile( w->ctx, tile_index, tile_area );
+		return;
+	}
+	async_check_full( w, async_push( w, ASYNC_TILE, tile_index,
+									 tile_area, 0 ) );
+}
+
+static void
+async_write_toneline( void *ctx, const char *buf, size_t ss, size_t count )
+{
+	struct async_writer *w = ctx;
+	struct async_block *b;
+	size_t len;
+	char *data;
+
+	if ( !w->threaded || count == 0 ) {
+		async_base_writer->write_toneline( w->ctx, buf, ss, count );
+		return;
+	}
+
+	/*        #ss: 
+	 *   ,   . */
+	len = (count - 1) * ss + 1;
+
+	b = async_block( w );
+	if ( b->data_size < b->nbytes + len ) {
+		data = realloc( b->data, b->nbytes + len );
+		if ( data == NULL ) {
+			fprintf( stderr, "%s: Tone line buffer allocation failed\n",
+					 program_name );
+			exit(EXIT_FAILURE);
+		}
+		b->data = data;
+		b->data_size = b->nbytes + len;
+	}
+	memcpy( b->data + b->nbytes, buf, len );
+	b->nbytes += len;
+	async_check_full( w, async_push( w, ASYNC_TONELINE, ss, 0, count ) );
+}
+
+static void
+async_close( void *ctx )
+{
+	struct async_writer *w = ctx;
+
+	if ( w->threaded ) {
+		/*       . */
+		async_publish( w );
+		pthread_mutex_lock( &w->lock );
+		__atomic_store_n( &w->done, 1, __ATOMIC_SEQ_CST );
+		pthread_cond_broadcast( &w->cond );
+		pthread_mutex_unlock( &w->lock );
+		pthread_join( w->thread, NULL );
+		pthread_mutex_destroy( &w->lock );
+		pthread_cond_destroy( &w->cond );
+	}
+
+	async_base_writer->close( w->ctx );
+	destroy_async_writer( w );
+}
+
+static struct filter_writer async_filter_writer = {
+	.open_tilemap      = async_open_tilemap,
+	.open_tonemap      = async_open_tonemap,
+	.write_tile_lines  = async_write_tile_lines,
+	.write_spaces      = async_write_spaces,
+	.write_tile        = async_write_tile,
+	.write_toneline    = async_write_toneline,
+	.close             = async_close
+};
+
+/**
+ *  ,    #writer 
+ *      #depth   
+ * .     . 
+ *   ,  #writer.
+ */
+struct filter_writer *
+get_async_filter_writer( struct filter_writer *writer, unsigned int depth )
+{
+	if ( depth == 0 )
+		return writer;
+
+	async_base_writer = writer;
+	async_depth = depth;
+
+	return &async_filter_writer;
+}
+
+#else /* HAVE_PTHREAD_H */
+
+/*      . */
+
+struct filter_writer *
+get_async_filter_writer( struct filter_writer *writer, unsigned int depth )
+{
+	return writer;
+}
+
+#endif /* HAVE_PTHREAD_H */
@@ -0,0 +1,533 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*     . */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "system.h"
+#include "misc.h"
+#include "sha256.h"
+#include "bandstore.h"
+
+/*     ,   . */
+#define BANDSTORE_KEY_SIZE (2*SHA256_SIZE+1)
+
+/*   . */
+#define BANDSTORE_MAGIC "EGB1"
+
+/*   :  (4 ),    
+ *     . */
+#define BANDSTORE_TILE_SIZE 6
+
+/*   . */
+enum { BAND_NONE, BAND_REPLAY, BAND_RECORD };
+
+/**
+ *  .
+ */
+struct bandstore {
+	char dir[MAXLINE];				/*  . */
+	unsigned char params[SHA256_SIZE];	/*  SHA-256 . */
+	unsigned long width, height;	/*  . */
+	size_t ss;						/*  ޣ  . */
+	int c0, cN;						/*    . */
+	unsigned long band_rows;		/*    . */
+
+	/*  ,    . */
+	char (*keys)[BANDSTORE_KEY_SIZE];
+	unsigned long nbands;
+
+	/*  . */
+	int state;						/*  (BAND_*). */
+	unsigned long y0, y1;			/*     
+									 *  . */
+	unsigned long next_y;			/*   . */
+	unsigned char *data;			/*  . */
+	size_t size, alloc;				/*    . */
+	size_t pos;						/*  . */
+
+	/*     . */
+	struct engrave_tile *tiles[4];
+
+	unsigned long reused, analysed;	/* ޣ . */
+	int failed;						/*    . */
+};
+
+/*    32-      . */
+static void
+put_u32( unsigned char *p, unsigned long v )
+{
+	p[0] = (unsigned char) v;
+	p[1] = (unsigned char) (v >> 8);
+	p[2] = (unsigned char) (v >> 16);
+	p[3] = (unsigned char) (v >> 24);
+}
+
+static unsigned long
+get_u32( const unsigned char *p )
+{
+	return (unsigned long) p[0] | (unsigned long) p[1] << 8 |
+		(unsigned long) p[2] << 16 | (unsigned long) p[3] << 24;
+}
+
+/*  #n   #p    . */
+static int
+append( struct bandstore *bs, const void *p, size_t n )
+{
+	unsigned char *data;
+	size_t alloc;
+
+	if ( bs->size + n > bs->alloc ) {
+		alloc = bs->alloc ? bs->alloc : 65536;
+		while ( alloc < bs->size + n ) alloc *= 2;
+		data = realloc( bs->data, alloc );
+		if ( !data ) return 1;
+		bs->data = data;
+		bs->alloc = alloc;
+	}
+	memcpy( bs->data + bs->size, p, n );
+	bs->size += n;
+
+	return 0;
+}
+
+/*      #key   #path 
+ * MAXLINE.  0  1,      . */
+static int
+band_path( const struct bandstore *bs, const char *key, char *path )
+{
+	int n = snprintf( path, MAXLINE, "%s/%s", bs->dir, key );
+
+	return n < 0 || n >= MAXLINE;
+}
+
+/*      #key,   
+ *   .  0  1,   
+ *    #path  MAXLINE. */
+static int
+band_tmp_path( const struct bandstore *bs, const char *key, char *path )
+{
+	int n = snprintf( path, MAXLINE, "%s/.%s.%lu", bs->dir, key,
+					  (unsigned long) getpid() );
+
+	return n < 0 || n >= MAXLINE;
+}
+
+/*   : #rows ,     
+ *  .  0,   . */
+static int
+check_band( const struct bandstore *bs, unsigned long rows )
+{
+	size_t pos = 0;
+	unsigned long y, count, i, x, prev;
+	const unsigned char *t;
+	int c;
+
+	for ( y = 0; y < rows; y++ ) {
+		pos += bs->ss * bs->width;
+		for ( c = bs->c0; c <= bs->cN; c++ ) {
+			if ( pos + 4 > bs->size ) return 1;
+			count = get_u32( bs->data + pos );
+			pos += 4;
+			if ( count > bs->width ||
+				 pos + count * BANDSTORE_TILE_SIZE > bs->size )
+				return 1;
+			for ( i = 0, prev = 0; i < count; i++ ) {
+				t = bs->data + pos + i * BANDSTORE_TILE_SIZE;
+				x = get_u32( t );
+				if ( x >= bs->width || (i > 0 && x <= prev) ||
+					 (t[4] & 0x7f) == 0 || (t[4] & 0x7f) > TILE_COUNT )
+					return 1;
+				prev = x;
+			}
+			pos += count * BANDSTORE_TILE_SIZE;
+		}
+	}
+
+	return pos != bs->size;
+}
+
+/*    #key.  0   . */
+static int
+load_band( struct bandstore *bs, const char *key )
+{
+	char path[MAXLINE];
+	unsigned char hdr[8];
+	unsigned char *zdata;
+	struct stat st;
+	uLongf rawlen;
+	size_t zlen;
+	FILE *f;
+	int ret = 1;
+
+	if ( band_path( bs, key, path ) ) return 1;
+	f = fopen( path, "rb" );
+	if ( !f ) return 1;
+
+	if ( fstat( fileno( f ), &st ) != 0 || st.st_size < sizeof(hdr) ||
+		 fread( hdr, sizeof(hdr), 1, f ) != 1 ||
+		 memcmp( hdr, BANDSTORE_MAGIC, 4 ) != 0 ) {
+		fclose( f );
+		return 1;
+	}
+
+	zlen = st.st_size - sizeof(hdr);
+	rawlen = get_u32( hdr + 4 );
+	zdata = malloc( zlen );
+	bs->size = 0;
+	if ( zdata && fread( zdata, 1, zlen, f ) == zlen ) {
+		if ( rawlen > bs->alloc ) {
+			unsigned char *data = realloc( bs->data, rawlen );
+			if ( data ) {
+				bs->data = data;
+				bs->alloc = rawlen;
+			}
+		}
+		if ( rawlen <= bs->alloc &&
+			 uncompress( bs->data, &rawlen, zdata, zlen ) == Z_OK &&
+			 rawlen == get_u32( hdr + 4 ) ) {
+			bs->size = rawlen;
+			ret = check_band( bs, bs->y1 - bs->y0 );
+		}
+	}
+
+	free( zdata );
+	fclose( f );
+
+	if ( ret ) bs->size = 0;
+	return ret;
+}
+
+/*         #key.  
+ *       .
+ *  0   . */
+static int
+store_band( struct bandstore *bs, const char *key )
+{
+	char path[MAXLINE];
+	char tmp[MAXLINE];
+	unsigned char hdr[8];
+	unsigned char *zdata;
+	uLongf zlen;
+	FILE *f;
+	int ret = 1;
+
+	if ( bs->size > 0xffffffffUL ) return 1;
+
+	zlen = compressBound( bs->size );
+	zdata = malloc( zlen );
+	if ( !zdata ) return 1;
+
+	if ( compress2( zdata, &zlen, bs->data, bs->size, 1 ) == Z_OK &&
+		 !band_path( bs, key, path ) && !band_tmp_path( bs, key, tmp ) ) {
+		memcpy( hdr, BANDSTORE_MAGIC, 4 );
+		put_u32( hdr + 4, bs->size );
+		f = fopen( tmp, "wb" );
+		if ( f ) {
+			ret = fwrite( hdr, sizeof(hdr), 1, f ) != 1 ||
+				fwrite( zdata, 1, zlen, f ) != zlen;
+			if ( fclose( f ) ) ret = 1;
+			if ( !ret && rename( tmp, path ) != 0 ) ret = 1;
+			if ( ret ) unlink( tmp );
+		}
+	}
+
+	free( zdata );
+	return ret;
+}
+
+struct bandstore *
+bandstore_open( const char *dir, const char *params_key,
+				unsigned long width, unsigned long height,
+				size_t ss, int c0, int cN, unsigned long band_rows )
+{
+	struct bandstore *bs;
+	struct sha256 s;
+	char geom[256];
+	int c;
+
+	if ( !band_rows || !width || !height ) return NULL;
+
+	/*    (. band_tmp_path())  
+	 *  MAXLINE. */
+	if ( strlen( dir ) + BANDSTORE_KEY_SIZE + 24 > MAXLINE ) return NULL;
+
+#ifdef __MINGW32__
+	if ( mkdir( dir ) != 0 && errno != EEXIST ) return NULL;
+#else
+	if ( mkdir( dir, 0777 ) != 0 && errno != EEXIST ) return NULL;
+#endif
+
+	bs = calloc( 1, sizeof(*bs) );
+	if ( !bs ) return NULL;
+
+	snprintf( bs->dir, sizeof(bs->dir), "%s", dir );
+	bs->width = width;
+	bs->height = height;
+	bs->ss = ss;
+	bs->c0 = c0;
+	bs->cN = cN;
+	bs->band_rows = band_rows;
+	bs->nbands = (height + band_rows - 1) / band_rows;
+	bs->state = BAND_NONE;
+
+	/*        
+	 *  . */
+	snprintf( geom, sizeof(geom), "\nwidth %lu height %lu ss %lu "
+			  "channels %i-%i band %lu\n", width, height,
+			  (unsigned long) ss, c0, cN, band_rows );
+	sha256_init( &s );
+	sha256_update( &s, params_key, strlen( params_key ) );
+	sha256_update( &s, geom, strlen( geom ) );
+	sha256_final( &s, bs->params );
+
+	bs->keys = calloc( bs->nbands, BANDSTORE_KEY_SIZE );
+	if ( !bs->keys ) {
+		free( bs );
+		return NULL;
+	}
+	for ( c = c0; c <= cN; c++ ) {
+		bs->tiles[c] = calloc( width, sizeof(struct engrave_tile) );
+		if ( !bs->tiles[c] ) {
+			bandstore_close( bs, 0, NULL, NULL );
+			return NULL;
+		}
+	}
+
+	return bs;
+}
+
+void
+bandstore_hash_band( struct bandstore *bs, unsigned long band,
+					 const unsigned char *rows, unsigned long nrows )
+{
+	struct sha256 s;
+	unsigned char digest[SHA256_SIZE];
+	unsigned char idx[4];
+
+	if ( band >= bs->nbands ) return;
+
+	sha256_init( &s );
+	sha256_update( &s, bs->params, sizeof(bs->params) );
+	put_u32( idx, band );
+	sha256_update( &s, idx, sizeof(idx) );
+	sha256_update( &s, rows, nrows * bs->ss * bs->width );
+	sha256_final( &s, digest );
+	sha256_hex( digest, bs->keys[band] );
+}
+
+/*   #band:  ţ    , 
+ *   ,   . */
+static void
+start_band( struct bandstore *bs, unsigned long band )
+{
+	/*      . */
+	if ( bs->state == BAND_RECORD ) bs->failed = 1;
+
+	bs->y0 = band * bs->band_rows;
+	bs->y1 = bs->y0 + bs->band_rows;
+	if ( bs->y1 > bs->height ) bs->y1 = bs->height;
+	bs->next_y = bs->y0;
+	bs->pos = 0;
+	bs->size = 0;
+
+	if ( bs->keys[band][0] == '\0' ) {
+		/*    . */
+		bs->state = BAND_NONE;
+		bs->failed = 1;
+	} else if ( load_band( bs, bs->keys[band] ) == 0 ) {
+		bs->state = BAND_REPLAY;
+		bs->reused++;
+	} else {
+		bs->state = BAND_RECORD;
+		bs->analysed++;
+	}
+}
+
+void
+bandstore_record_row( void *arg, unsigned long y,
+					  const struct engrave_row *row )
+{
+	struct bandstore *bs = arg;
+	unsigned char t[BANDSTORE_TILE_SIZE];
+	unsigned char cnt[4];
+	const struct engrave_tile *tile;
+	size_t i;
+	int c, err;
+
+	if ( bs->state != BAND_RECORD || y != bs->next_y ) return;
+
+	err = append( bs, row->toneline, bs->ss * bs->width );
+	for ( c = bs->c0; c <= bs->cN && !err; c++ ) {
+		put_u32( cnt, row->count[c] );
+		err = append( bs, cnt, sizeof(cnt) );
+		for ( i = 0; i < row->count[c] && !err; i++ ) {
+			tile = &row->tiles[c][i];
+			put_u32( t, tile->x );
+			t[4] = tile->index | (tile->neg ? 0x80 : 0);
+			t[5] = tile->area;
+			err = append( bs, t, sizeof(t) );
+		}
+	}
+
+	if ( err ) {
+		bs->failed = 1;
+		bs->state = BAND_NONE;
+		return;
+	}
+
+	/*   . */
+	if ( ++bs->next_y == bs->y1 ) {
+		if ( store_band( bs, bs->keys[bs->y0 / bs->band_rows] ) != 0 )
+			bs->failed = 1;
+		bs->state = BAND_NONE;
+	}
+}
+
+int
+bandstore_replay_row( void *arg, unsigned long y, struct engrave_row *row )
+{
+	struct bandstore *bs = arg;
+	const unsigned char *t;
+	struct engrave_tile *tile;
+	unsigned long count, i;
+	int c;
+
+	if ( y < bs->height && y % bs->band_rows == 0 )
+		start_band( bs, y / bs->band_rows );
+
+	if ( bs->state != BAND_REPLAY || y != bs->next_y ) return 0;
+
+	memset( row, 0, sizeof(*row) );
+	row->toneline = bs->data + bs->pos;
+	bs->pos += bs->ss * bs->width;
+	for ( c = bs->c0; c <= bs->cN; c++ ) {
+		count = get_u32( bs->data + bs->pos );
+		bs->pos += 4;
+		for ( i = 0; i < count; i++ ) {
+			t = bs->data + bs->pos;
+			tile = &bs->tiles[c][i];
+			tile->x = get_u32( t );
+			tile->index = t[4] & 0x7f;
+			tile->neg = (t[4] & 0x80) != 0;
+			tile->area = t[5];
+			bs->pos += BANDSTORE_TILE_SIZE;
+		}
+		row->tiles[c] = bs->tiles[c];
+		row->count[c] = count;
+	}
+
+	if ( ++bs->next_y == bs->y1 )
+		bs->state = BAND_NONE;
+
+	return 1;
+}
+
+/*   . */
+static int
+cmp_key( const void *a, const void *b )
+{
+	return strcmp( a, b );
+}
+
+/* ,    #name  . */
+static int
+is_key( const char *name )
+{
+	int i;
+
+	for ( i = 0; i < BANDSTORE_KEY_SIZE - 1; i++ ) {
+		if ( !((name[i] >= '0' && name[i] <= '9') ||
+			   (name[i] >= 'a' && name[i] <= 'f')) )
+			return 0;
+	}
+
+	return name[i] == '\0';
+}
+
+int
+bandstore_close( struct bandstore *bs, int commit,
+				 unsigned long *reused, unsigned long *analysed )
+{
+	char path[MAXLINE];
+	struct dirent *de;
+	DIR *d;
+	int c, ret;
+
+	/*      . */
+	if ( bs->state == BAND_RECORD ) bs->failed = 1;
+	ret = bs->failed;
+
+	/*    ,   
+	 *  . */
+	if ( commit && !bs->failed ) {
+		qsort( bs->keys, bs->nbands, BANDSTORE_KEY_SIZE, cmp_key );
+		d = opendir( bs->dir );
+		if ( d ) {
+			while ( (de = readdir( d )) != NULL ) {
+				if ( !is_key( de->d_name ) ||
+					 bsearch( de->d_name, bs->keys, bs->nbands,
+							  BANDSTORE_KEY_SIZE, cmp_key ) )
+					continue;
+				if ( !band_path( bs, de->d_name, path ) )
+					unlink( path );
+			}
+			closedir( d );
+		}
+	}
+
+	if ( reused ) *reused = bs->reused;
+	if ( analysed ) *analysed = bs->analysed;
+
+	for ( c = 0; c < 4; c++ )
+		free( bs->tiles[c] );
+	free( bs->keys );
+	free( bs->data );
+	free( bs );
+
+	return ret;
+}
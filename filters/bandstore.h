@@ -0,0 +1,107 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __BANDSTORE_H
+#define __BANDSTORE_H
+
+/*       
+ * () .
+ *
+ *       .  
+ *   (    )   
+ *           ţ, 
+ *    SHA-256   , 
+ *    .    
+ *     ,   
+ *  .    Σ 
+ *      :  
+ *    (. #engrave_output).
+ */
+
+#include "libengrave.h"
+
+/**
+ *  .
+ */
+struct bandstore;
+
+/**
+ *     #dir ( ţ 
+ * )   #width x #height ޣ  #ss
+ *     #c0  #cN, ̣   
+ * #band_rows .  #params_key   .
+ *      #NULL   .
+ */
+struct bandstore *bandstore_open( const char *dir, const char *params_key,
+								  unsigned long width, unsigned long height,
+								  size_t ss, int c0, int cN,
+								  unsigned long band_rows );
+
+/**
+ *    #band. #rows -- #nrows  , 
+ *     :     
+ *     ţ (  ).   
+ *      .
+ */
+void bandstore_hash_band( struct bandstore *bs, unsigned long band,
+						  const unsigned char *rows, unsigned long nrows );
+
+/**
+ *     (#engrave_output) 
+ *     .    
+ *  #bandstore_replay_row   ţ   :
+ *   ,   ,   
+ *   #bandstore_record_row.
+ */
+void bandstore_record_row( void *arg, unsigned long y,
+						   const struct engrave_row *row );
+int bandstore_replay_row( void *arg, unsigned long y,
+						  struct engrave_row *row );
+
+/**
+ *  .    #commit (
+ *  ),    , 
+ *    .  #reused  #analysed
+ *   ģ  
+ * .  0     -0,   
+ *  - .
+ */
+int bandstore_close( struct bandstore *bs, int commit,
+					 unsigned long *reused, unsigned long *analysed );
+
+#endif /* __BANDSTORE_H */
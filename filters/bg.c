@@ -46,6 +46,7 @@
 #include "system.h"
 #include "filter.h"
 #include "misc.h"
+#include "aout.h"
 
 /*  ,    . */
 #define EXIT_FAILURE 1
@@ -121,9 +122,6 @@ main (int argc, char **argv)
   /*     . */
   int opt_r;
 
-  /*  ޣ  . */
-  size_t ss;
-  
   /*        4 
    * .
    */
@@ -137,18 +135,9 @@ main (int argc, char **argv)
   /*   4    ͣ  . */
   const char *filenames[4] = { NULL, NULL, NULL, NULL };
   
-  /*      . */
-  char *buf = NULL;
-
   /* ޣ  . */
   int c0, c, cN;
 
-  /*  ޣ -. */
-  size_t rd;
-
-  /*   . */
-  int y;
-
   /*     . */
   int OK = 0;
 
@@ -171,8 +160,6 @@ main (int argc, char **argv)
 			  filenames[i] = NULL;
 		  }
 	  }
-	  if (buf != NULL)
-		  free(buf);
   }
 
   /*   .     */
@@ -184,6 +171,10 @@ main (int argc, char **argv)
   init_cleanup(program_name);
   push_cleanup(cleanup);
 
+  /*      (. --describe):
+   *     . */
+  filter_consumes_input = 0;
+
   /*    . */
   opt_r = decode_switches (argc, argv, EXIT_FAILURE, long_options, option_vars, &usage_header, &usage_params);
 
@@ -194,27 +185,17 @@ main (int argc, char **argv)
 	  exit(EXIT_FAILURE);
   }
   
-  /*  ޣ     ޣ   
+  /*  ޣ     
    *   .
    */
   if (is_cmyk) {
-	  ss = 4;	/* 4   CMYK */
 	  c0 = 0;	/* 4 ,  0 */
 	  cN = 3;	/*  3 */
   } else {
-	  ss = 1;	/* 1   Grayscale */
 	  c0 = 3;	/* 1   0 */
 	  cN = 3;	/*  0 */
   }
 
-  /*      . */
-  buf = calloc(ss, width);
-  if (buf == NULL) {
-	  fprintf(stderr, "%s: Scanline buffer allocation failed\n", program_name);
-	  /*    ,     . */
-	  exit(EXIT_FAILURE);
-  }
-
   /*   PostScript-. */
   for (c = c0; c <= cN; c++) {
 	 /*    ,    . */
@@ -222,7 +203,7 @@ main (int argc, char **argv)
 		 fprintf( stderr, "%s: Can't get temp file name\n", program_name );
 		 exit(EXIT_FAILURE);
 	 }
-	 if ((outfile[c] = fopen( filenames[c], "w" )) == (FILE *) NULL) {
+	 if ((outfile[c] = aout_fopen( filenames[c], "w", io_depth )) == (FILE *) NULL) {
 		 fprintf( stderr, "%s: Can't create file %s\n", program_name,
 				  filenames[c] );
 		 /*    ,     . */
@@ -232,17 +213,6 @@ main (int argc, char **argv)
 	 write_header(outfile[c]);
   }
 
-  /*       .
-   */
-  for (y = 0; y < height; y++) {
-	  /*   . */
-	  rd = fread(buf, ss, width, stdin);
-	  /*    ޣ. */
-	  if (rd < width) {
-	    break;
-	  }
-  }
-
   /*    PostScript-. */
   for (c = c0; c <= cN; c++) {
 	  write_footer(outfile[c]);
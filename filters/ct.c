@@ -46,6 +46,7 @@
 #include <sys/types.h>
 #include "system.h"
 #include "filter.h"
+#include "libengrave.h"
 #include "misc.h"
 
 /*  ,    . */
@@ -55,12 +56,24 @@
 enum {DUMMY_CODE=129
 };
 
-/*      . */
+/*    . */
 struct option const long_options[] =
 {
+	{"ct-downsample", required_argument, NULL, 0},
+	{"ct-resolution", required_argument, NULL, 0},
 	{NULL, 0, NULL, 0}
 };
 
+/*     . */
+char *downsample_str;
+char *resolution_str;
+
+/*   ,    . */
+char **option_vars[] =
+{
+	&downsample_str, &resolution_str
+};
+
 /*    . */
 void
 usage_header(FILE *out)
@@ -70,6 +83,59 @@ Image filter for 'engrave' package. Produces PostScript code for each image colo
 
 }
 
+/*      . */
+void
+usage_params(FILE *out)
+{
+
+  fprintf(out, _("\
+  --ct-downsample=N		average each NxN block of samples into\n\
+                                one sample of the tone layer\n\
+  --ct-resolution=DPI		reduce the tone layer resolution down\n\
+                                to (no less than) DPI\n\
+"));
+
+}
+
+/**
+ *       
+ *  --ct-downsample  --ct-resolution.  1, 
+ *   .
+ */
+static unsigned long
+get_downsample()
+{
+  char *endptr;
+  unsigned long n = 1;
+  double dpi, res;
+
+  if (downsample_str != NULL && resolution_str != NULL) {
+	  fprintf(stderr, "%s: --ct-downsample and --ct-resolution are mutually exclusive options\n", program_name);
+	  exit(EXIT_FAILURE);
+  }
+  if (downsample_str != NULL) {
+	  n = strtoul(downsample_str, &endptr, 0);
+	  if (endptr == downsample_str || *endptr != '\0' || n == 0) {
+		  fprintf(stderr, "%s: Downsample factor should be a positive integer number.\n", program_name);
+		  exit(EXIT_FAILURE);
+	  }
+  }
+  if (resolution_str != NULL) {
+	  dpi = strtod(resolution_str, &endptr);
+	  if (endptr == resolution_str || *endptr != '\0' || dpi <= 0) {
+		  fprintf(stderr, "%s: Tone layer resolution should be a positive number.\n", program_name);
+		  exit(EXIT_FAILURE);
+	  }
+	  /*         
+	   *   . */
+	  res = hres < vres ? hres : vres;
+	  if (res > dpi)
+		  n = (unsigned long) (res / dpi);
+  }
+
+  return n;
+}
+
 /*  . */
 int
 main (int argc, char **argv)
@@ -84,18 +150,21 @@ main (int argc, char **argv)
   /*   4    ͣ  . */
   const char *filenames[4] = { NULL, NULL, NULL, NULL };
 
+  /*   ϣ. */
+  FILE *files[4] = { NULL, NULL, NULL, NULL };
+
   /*    . */
   struct filter_writer *filter_writer_p = NULL;
-  
-  /*   4       
-   *    .
-   */
-  void *filter_writer_ctx[] = {
-	  NULL,
-	  NULL,
-	  NULL,
-	  NULL
-  };
+
+  /*     . */
+  struct engrave_ct_params params;
+  struct filter_params layer;
+
+  /*   . */
+  struct engrave_ct_output output;
+
+  /*    . */
+  struct engrave_ct_ctx *ectx = NULL;
 
   /*      . */
   char *buf = NULL;
@@ -109,6 +178,9 @@ main (int argc, char **argv)
   /*   . */
   int y;
 
+  /*         . */
+  size_t batch, rows;
+
   /*     . */
   int OK = 0;
 
@@ -118,10 +190,18 @@ main (int argc, char **argv)
 
 	  if (!OK)
 		  fprintf(stderr, "%s: Finished with error.\n", program_name);
+	  if (ectx != NULL) {
+		  engrave_ct_close(ectx);
+		  ectx = NULL;
+	  }
 	  for (i = 0; i < 4; i++) {
-		  if (filter_writer_ctx[i] != NULL) {
-			  filter_writer_p->close( filter_writer_ctx[i] );
-			  filter_writer_ctx[i] = NULL;
+		  if (output.tone_writer[i] != NULL) {
+			  filter_writer_p->close( output.tone_writer[i] );
+			  output.tone_writer[i] = NULL;
+		  }
+		  if (files[i] != NULL) {
+			  fclose( files[i] );
+			  files[i] = NULL;
 		  }
 		  if (!OK && filenames[i] != NULL) {
 			  fprintf( stderr, "%s: Delete temporary file: %s\n", program_name,
@@ -141,14 +221,16 @@ main (int argc, char **argv)
   program_name = argv[0];
 
   /*    . */
+  memset(&output, 0, sizeof(output));
   init_cleanup(program_name);
   push_cleanup(cleanup);
 
   /*    . */
-  opt_r = decode_switches (argc, argv, EXIT_FAILURE, long_options, NULL, &usage_header, NULL);
+  opt_r = decode_switches (argc, argv, EXIT_FAILURE, long_options, option_vars, &usage_header, &usage_params);
 
   /*  . */
   filter_writer_p = get_selected_filter_writer();
+  get_filter_params(&params.image);
 
   /*    . */
   if (!width || !height || !hres || !vres) {
@@ -156,6 +238,10 @@ main (int argc, char **argv)
 	  /*    ,      . */
 	  exit(EXIT_FAILURE);
   }
+
+  /*   . */
+  params.downsample = get_downsample();
+  engrave_ct_layer_params(&params, &layer);
   
   /*  ޣ     ޣ   
    *   .
@@ -169,9 +255,12 @@ main (int argc, char **argv)
 	  c0 = 3;	/* 1   0 */
 	  cN = 3;	/*  0 */
   }
+  /* 16- ޣ  . */
+  ss *= sample_bits / 8;
 
-  /*      . */
-  buf = calloc(ss, width);
+  /*       . */
+  batch = smp_batch_rows(ss, width, height, batch_rows);
+  buf = calloc(batch, ss * width);
   if (buf == NULL) {
 	  fprintf(stderr, "%s: Scanline buffer allocation failed\n", program_name);
 	  /*    ,     . */
@@ -181,6 +270,7 @@ main (int argc, char **argv)
   /*   PostScript-   
    *      .
    */
+  output.writer = filter_writer_p;
   for (c = c0; c <= cN; c++) {
 	 /*    . */
 	 if ((filenames[c] = get_tmp_filter_file_name( "ct", c )) == NULL) {
@@ -188,9 +278,15 @@ main (int argc, char **argv)
 		fprintf( stderr, "%s: Can't get temp file name\n", program_name );
 		exit(EXIT_FAILURE);
 	 }
+	 if ((files[c] = open_tmp_filter_file( filenames[c] )) == NULL) {
+		fprintf( stderr, "%s: Can't create temp file %s\n", program_name,
+				 filenames[c] );
+		exit(EXIT_FAILURE);
+	 }
 	 /*      . */
-	 filter_writer_ctx[c] = filter_writer_p->open_tonemap( filenames[c] );
-	 if ( filter_writer_ctx[c] == NULL ) {
+	 output.tone_writer[c] = filter_writer_p->open_tonemap( &layer,
+															 files[c] );
+	 if ( output.tone_writer[c] == NULL ) {
 		 fprintf(stderr,
 				 "%s: Failed to initialize the writer.\n",
 				 program_name);
@@ -201,38 +297,47 @@ main (int argc, char **argv)
 	 }
   }
 
-  /*       ,
-   *        
-   *       PostScript-.
+  /*    . */
+  ectx = engrave_ct_open(&params, &output);
+  if (ectx == NULL) {
+	  fprintf(stderr, "%s: Failed to initialize the tone layer.\n", program_name);
+	  exit(EXIT_FAILURE);
+  }
+
+  /*       
+   *    ,     
+   *      
+   *  PostScript-.
    */
-  for (y = 0; y < height; y++) {
-	  /*   . */
-	  rd = fread(buf, ss, width, stdin);
-	  /*    ޣ. */
-	  if (rd < width) {
-		  fprintf(stderr, "%s: Line %i. Image stream suddenly closed\n", program_name, y);
+  for (y = 0; y < height; y += rows) {
+	  /*    . */
+	  rows = height - y < batch ? height - y : batch;
+	  rd = freadsmp_rows(buf, ss, width, rows, stdin, 0);
+	  /*    . */
+	  if (rd < rows) {
+		  fprintf(stderr, "%s: Line %i. Image stream suddenly closed\n", program_name, (int) (y + rd));
 		  /*    ,    
-		   * ޣ,   .
+		   * ,   .
 		   */
 		  exit(EXIT_FAILURE);
 	  }
-
-	  /*   . */
-	  for (c = c0; c <= cN; c++)
-		  /*     .  
-		   *      
-		   *  ,      
-		   *  PostScript-. 
-		   */
-		  filter_writer_p->write_toneline( filter_writer_ctx[c],
-										   buf + c - c0, ss,
-										   width );
+	  engrave_ct_push_lines(ectx, buf, rows);
   }
 
-  /*    PostScript-. */
+  engrave_ct_close(ectx);
+  ectx = NULL;
+
+  /*    PostScript-   . */
   for (c = c0; c <= cN; c++) {
-	  filter_writer_p->close( filter_writer_ctx[c] );
-	  filter_writer_ctx[c] = NULL;
+	  filter_writer_p->close( output.tone_writer[c] );
+	  output.tone_writer[c] = NULL;
+	  if (fclose( files[c] ) != 0) {
+		  files[c] = NULL;
+		  fprintf( stderr, "%s: Unable to write temporary file %s\n",
+				   program_name, filenames[c] );
+		  exit(EXIT_FAILURE);
+	  }
+	  files[c] = NULL;
   }
 
   /*    . */
@@ -245,4 +350,3 @@ main (int argc, char **argv)
   exit (0);
 
 }
-
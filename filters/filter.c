@@ -43,9 +43,10 @@
 #include "system.h"
 #include "filter.h"
 #include "misc.h"
+#include "stats.h"
 
-#include "ascii85.h"
-#include "tiffout.h"
+#include "aout.h"
+#include "asyncwriter.h"
 
 /*   . */
 char *program_name;
@@ -67,11 +68,53 @@ int unsigned long height;	/* 
 float hres;             	/*   ; */
 float vres;			/*   ; */
 int is_cmyk;			/*  4- ; */
-int miniswhite;			/*   . */
+int miniswhite;			/*   ; */
+int sample_bits;		/*   ޣ; */
+int negative_input;		/*    . */
 
 /*   */
 filter_outformat_t filter_outformat = FILTER_EPS_FMT;
 
+/*   ,    . */
+unsigned long batch_rows;
+
+/*      . */
+unsigned int encode_ahead;
+
+/*      . */
+int io_depth;
+
+/*  :     
+ *      . */
+int filter_consumes_input = 1;
+int filter_produces_output = 0;
+
+/*    . */
+int want_output;
+
+/*  ,    . */
+enum { DESCRIBE_KEY = 256, NO_OUTPUT_KEY, ENCODE_AHEAD_KEY, IO_DEPTH_KEY };
+
+/*   . */
+int want_stats;
+
+/*   . */
+static double stats_start_time;
+
+/*   ϣ,   ģ . */
+#define STATS_MAX_LAYERS 16
+
+/*   . */
+struct layer_stats {
+	const char *kind;		/*   (tilemap, mask, tonemap); */
+	struct stats_timer timer;	/*   ; */
+	long long bytes;		/*    (-1 --- ). */
+};
+
+/*  ϣ    . */
+static struct layer_stats layer_stats[STATS_MAX_LAYERS];
+static int layer_stats_count;
+
 /*        . */
 static struct option const base_long_options[] =
 {
@@ -88,6 +131,14 @@ static struct option const base_long_options[] =
 	{"intensity", no_argument, NULL, 'I'},
 	{"verbose", no_argument, NULL, 'v'},
 	{"format", required_argument, NULL, 't'},
+	{"batch-rows", required_argument, NULL, 'B'},
+	{"bits", required_argument, NULL, 'b'},
+	{"negative-input", no_argument, NULL, 'n'},
+	{"describe", no_argument, NULL, DESCRIBE_KEY},
+	{"no-output", no_argument, NULL, NO_OUTPUT_KEY},
+	{"encode-ahead", required_argument, NULL, ENCODE_AHEAD_KEY},
+	{"io-depth", required_argument, NULL, IO_DEPTH_KEY},
+	{"stats", no_argument, NULL, 'S'},
 	{NULL, 0, NULL, 0}
 };
 
@@ -111,6 +162,17 @@ get_tmp_filter_file_name( const char *fsuf, int color_idx )
 	return get_tmp_file_name( fsuf, pid, fidx, color_idx );
 }
 
+/**
+ *     #fname   .
+ *     :  TIFF  
+ *  .
+ */
+FILE *
+open_tmp_filter_file( const char *fname )
+{
+	return aout_fopen( fname, "w+b", io_depth );
+}
+
 /*          . */
 void
 usage (int status, usage_header_f usage_header, usage_params_f usage_params)
@@ -143,6 +205,19 @@ Options:\n\
                                 values\n\
   -I, --intensity		intput and output data is INTENSITY\n\
                                 values\n\
+  -B ROWS, --batch-rows=ROWS	transfer ROWS scanlines at once\n\
+  -b BITS, --bits=BITS		input samples are BITS wide (8 or 16),\n\
+                                default is 8\n\
+  -n, --negative-input		input samples have the polarity opposite\n\
+                                to the DENSITY/INTENSITY one\n\
+  --describe			print whether the filter consumes image\n\
+                                data and passes rows further, and exit\n\
+  --no-output			do not pass rows further\n\
+  --encode-ahead=N		encode layers in separate threads,\n\
+                                queueing up to N blocks of operations\n\
+  --io-depth=N			write output files through N large\n\
+                                buffers in flight (io_uring or pwrite)\n\
+  -S, --stats			write run statistics to a file\n\
   -H, --help			display this help and exit\n\
   -V, --version			output version information and exit\n\
 "));
@@ -173,6 +248,46 @@ options_count(struct option const *opts)
 
 }
 
+/*      ,  ţ  
+ * .     . */
+static void
+write_stats()
+{
+	char *fn;
+	const char *name;
+	FILE *f;
+	double user, sys, encode;
+	int i;
+
+	fn = get_stats_file_name( pid, fidx );
+	if ( fn == NULL ) return;
+
+	f = fopen( fn, "w" );
+	if ( f != NULL ) {
+		stats_rusage( 0, &user, &sys );
+		name = strrchr( program_name, '/' );
+		fprintf( f, "name %s\n", name != NULL ? name + 1 : program_name );
+		fprintf( f, "wall %.6f\n", stats_now() - stats_start_time );
+		fprintf( f, "user %.6f\n", user );
+		fprintf( f, "sys %.6f\n", sys );
+		encode = 0;
+		for ( i = 0; i < layer_stats_count; i++ )
+			encode += layer_stats[i].timer.wall;
+		fprintf( f, "encode %.6f\n", encode );
+		for ( i = 0; i < layer_stats_count; i++ ) {
+			fprintf( f, "layer %s\n", layer_stats[i].kind );
+			fprintf( f, "layer_encode %.6f\n", layer_stats[i].timer.wall );
+			fprintf( f, "layer_bytes %lld\n", layer_stats[i].bytes );
+		}
+		fclose( f );
+	} else if ( want_verbose ) {
+		fprintf( stderr, "%s: Unable to write statistics to %s\n",
+				 program_name, fn );
+	}
+
+	free( fn );
+}
+
 /*        .
  *       ͣ.
  */
@@ -203,6 +318,9 @@ decode_switches (int argc, char **argv, int error_code,
   /*    .  */
   is_cmyk = 0;
   miniswhite = 0;
+  sample_bits = 8;
+  negative_input = 0;
+  want_output = 1;
   width = 0;
   height = 0;
   vres = 0;
@@ -211,6 +329,10 @@ decode_switches (int argc, char **argv, int error_code,
   fidx = 0;
   want_verbose = 0;
   filter_outformat = FILTER_EPS_FMT;
+  batch_rows = 0;
+  encode_ahead = 0;
+  io_depth = 0;
+  want_stats = 0;
 
   /* ޣ   . */
   base_options_count = options_count(base_long_options);
@@ -250,7 +372,11 @@ decode_switches (int argc, char **argv, int error_code,
 		"H"	/*   ; */
 		"v"	/*   ; */
 		"V"	/*    . */
-	    "t:", /* output format */
+	    "t:" /* output format */
+		"B:" /*    ; */
+		"b:" /*   ޣ; */
+		"n"  /*    ; */
+		"S", /*  . */
 		all_options, &option_index)) >= 0)
     {
       /*    . */
@@ -361,6 +487,74 @@ decode_switches (int argc, char **argv, int error_code,
 		}
 		break;
 
+	/*     .  
+	 *   . ,    .
+	 */
+	case 'B':
+		batch_rows = strtoul(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || strchr(optarg, '-') != NULL) {
+			fprintf(stderr, "%s: Batch rows value is invalid.\n", program_name);
+			exit(error_code);
+		}
+		break;
+
+	/*  ϣ      
+	 * N . */
+	case ENCODE_AHEAD_KEY:
+		encode_ahead = strtoul(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0') {
+			fprintf(stderr, "%s: Encode-ahead value is invalid.\n", program_name);
+			exit(error_code);
+		}
+		break;
+
+	/*        N. */
+	case IO_DEPTH_KEY:
+		io_depth = strtol(optarg, &endptr, 0);
+		if (errno == ERANGE || *endptr != '\0' || io_depth < 0) {
+			fprintf(stderr, "%s: I/O depth value is invalid.\n", program_name);
+			exit(error_code);
+		}
+		break;
+
+	/*   ޣ.   8- 
+	 * 16- ޣ. */
+	case 'b':
+		sample_bits = strtoul(optarg, &endptr, 0);
+		if (*endptr != '\0' || (sample_bits != 8 && sample_bits != 16)) {
+			fprintf(stderr, "%s: Sample bits value should be 8 or 16.\n", program_name);
+			exit(error_code);
+		}
+		break;
+
+	/*  ޣ  ,   
+	 * -D/-I.    :  ţ  
+	 *    ,    
+	 *     . */
+	case 'n':
+		negative_input = 1;
+		break;
+
+	/*      
+	 *  :     
+	 *    . */
+	case DESCRIBE_KEY:
+		printf("consumes-input %i\n"
+			   "produces-output %i\n",
+			   filter_consumes_input, filter_produces_output);
+		exit(0);
+
+	/*    :    
+	 * . */
+	case NO_OUTPUT_KEY:
+		want_output = 0;
+		break;
+
+	/*   . */
+	case 'S':
+		want_stats = 1;
+		break;
+
 	/*    . */
 	case 'v':
 		want_verbose = 1;
@@ -394,6 +588,24 @@ decode_switches (int argc, char **argv, int error_code,
 	  		filter_outformat = FILTER_TIFF_FMT;
 			break;
 	  	}
+	  if ( 0 == strcmp( optarg, "pdf" ) ||
+	  	   0 == strcmp( optarg, "PDF" ) )
+	  	{
+	  		filter_outformat = FILTER_PDF_FMT;
+			break;
+	  	}
+	  if ( 0 == strcmp( optarg, "pdf-g4" ) ||
+	  	   0 == strcmp( optarg, "PDF-G4" ) )
+	  	{
+	  		filter_outformat = FILTER_PDF_G4_FMT;
+			break;
+	  	}
+	  if ( 0 == strcmp( optarg, "pdf-glyphs" ) ||
+	  	   0 == strcmp( optarg, "PDF-GLYPHS" ) )
+	  	{
+	  		filter_outformat = FILTER_PDF_GLYPHS_FMT;
+			break;
+	  	}
 
 	/*      ,   
 	 *        .
@@ -406,6 +618,23 @@ decode_switches (int argc, char **argv, int error_code,
    /*   . */
    (*pop_cleanup())();
 
+  /*     . */
+  if (want_stats && pid) {
+	  stats_start_time = stats_now();
+	  atexit(write_stats);
+  }
+
+  /*        
+   *  .     
+   *  . */
+  if (width > 0) {
+	  size_t ss = (is_cmyk ? 4 : 1) * (sample_bits / 8);
+	  size_t rows = smp_batch_rows(ss, width, height, batch_rows);
+	  set_smp_transport(stdin, rows * ss * width);
+	  /*   8- ޣ. */
+	  set_smp_transport(stdout, rows * (is_cmyk ? 4 : 1) * width);
+  }
+
   /*      . */
   return optind;
 }
@@ -417,10 +646,22 @@ decode_switches (int argc, char **argv, int error_code,
 void
 write_outbuf(char *outbuf, size_t ss, size_t len) {
 
+	write_outbuf_rows(outbuf, ss, len, 1);
+
+}
+
+/*    #rows  ,   #len ޣ
+ *  #ss ,         .
+ *    ,   -D/-I, 
+ * .
+ */
+void
+write_outbuf_rows(char *outbuf, size_t ss, size_t len, size_t rows) {
+
 	size_t wt;
 
-	wt = fwritesmp(outbuf, ss, len, stdout, miniswhite, NULL);
-	if (wt < len) {
+	wt = fwritesmp_rows(outbuf, ss, len, rows, stdout, 0);
+	if (wt < rows) {
 		fprintf(stderr, "%s: Failed to transfer scanline data further\n", program_name);
 		/*    ,     
 		 *  .
@@ -429,6 +670,234 @@ write_outbuf(char *outbuf, size_t ss, size_t len) {
 	}
 
 }
+
+/* ,    . */
+static struct filter_writer *timed_writer;
+
+/*  ϣ  #STATS_MAX_LAYERS ( ). */
+static struct layer_stats extra_layer_stats;
+
+/*   ,     . */
+enum { TIMED_SPACES, TIMED_TILE };
+
+struct timed_op {
+	unsigned char op;
+	unsigned char tile_index;
+	unsigned char tile_area;
+	unsigned int z;
+};
+
+/**
+ *  ,    .  
+ *        ,
+ *        ,     .
+ */
+struct timed_ctx {
+	void *ctx;			/*  ; */
+	FILE *out;			/*  ; */
+	struct layer_stats *stats;	/*  ; */
+	struct timed_op *ops;		/*  ; */
+	size_t count;
+	size_t size;
+};
+
+/**
+ *    #op  #t.
+ */
+static inline void
+timed_replay( struct timed_ctx *t, const struct timed_op *op )
+{
+	if ( op->op == TIMED_SPACES )
+		timed_writer->write_spaces( t->ctx, op->z );
+	else
+		timed_writer->write_tile( t->ctx, op->tile_index, op->tile_area );
+}
+
+/**
+ *   ,    #t.
+ */
+static void
+timed_flush( struct timed_ctx *t )
+{
+	size_t i;
+
+	for ( i = 0; i < t->count; i++ )
+		timed_replay( t, &t->ops[i] );
+	t->count = 0;
+}
+
+/**
+ *   #op   #t.     
+ *   ,    #op 
+ *  .
+ */
+static void
+timed_push( struct timed_ctx *t, const struct timed_op *op )
+{
+	struct timed_op *ops;
+	size_t size;
+
+	if ( t->count == t->size ) {
+		size = t->size ? 2 * t->size : 256;
+		ops = realloc( t->ops, size * sizeof(*ops) );
+		if ( ops == NULL ) {
+			stats_timer_start( &t->stats->timer );
+			timed_flush( t );
+			timed_replay( t, op );
+			stats_timer_stop( &t->stats->timer );
+			return;
+		}
+		t->ops = ops;
+		t->size = size;
+	}
+	t->ops[t->count++] = *op;
+}
+
+/**
+ *   #ctx    #kind, 
+ *   #out.  ,    #open0,  
+ *  .
+ */
+static void *
+timed_wrap( void *ctx, FILE *out, const char *kind, double open0 )
+{
+	struct timed_ctx *t;
+	struct layer_stats *stats;
+
+	if ( ctx == NULL )
+		return NULL;
+
+	t = calloc( 1, sizeof(*t) );
+	if ( t == NULL ) {
+		timed_writer->close( ctx );
+		return NULL;
+	}
+
+	if ( layer_stats_count < STATS_MAX_LAYERS )
+		stats = &layer_stats[layer_stats_count++];
+	else
+		stats = &extra_layer_stats;
+	stats->kind = kind;
+	stats_timer_init( &stats->timer, 0 );
+	stats->timer.wall = stats_now() - open0;
+	stats->bytes = -1;
+
+	t->ctx = ctx;
+	t->out = out;
+	t->stats = stats;
+
+	return t;
+}
+
+/**
+ *  ,     
+ *    .
+ */
+static void *
+timed_open_tilemap( const struct filter_params *params,
+					FILE *out, int mask )
+{
+	double open0 = stats_now();
+
+	return timed_wrap( timed_writer->open_tilemap( params, out, mask ),
+					   out, mask ? "mask" : "tilemap", open0 );
+}
+
+static void *
+timed_open_tonemap( const struct filter_params *params,
+					FILE *out )
+{
+	double open0 = stats_now();
+
+	return timed_wrap( timed_writer->open_tonemap( params, out ),
+					   out, "tonemap", open0 );
+}
+
+static void
+timed_write_tile_lines( void *ctx, unsigned int zl )
+{
+	struct timed_ctx *t = ctx;
+
+	stats_timer_start( &t->stats->timer );
+	timed_flush( t );
+	timed_writer->write_tile_lines( t->ctx, zl );
+	stats_timer_stop( &t->stats->timer );
+}
+
+static void
+timed_write_spaces( void *ctx, unsigned int z )
+{
+	struct timed_op op = { .op = TIMED_SPACES, .z = z };
+
+	timed_push( ctx, &op );
+}
+
+static void
+timed_write_tile( void *ctx, unsigned char tile_index,
+				  unsigned char tile_area )
+{
+	struct timed_op op = { .op = TIMED_TILE, .tile_index = tile_index,
+						   .tile_area = tile_area };
+
+	timed_push( ctx, &op );
+}
+
+static void
+timed_write_toneline( void *ctx, const char *buf, size_t ss, size_t count )
+{
+	struct timed_ctx *t = ctx;
+
+	stats_timer_start( &t->stats->timer );
+	timed_writer->write_toneline( t->ctx, buf, ss, count );
+	stats_timer_stop( &t->stats->timer );
+}
+
+/*         
+ * (    ). */
+static void
+timed_close( void *ctx )
+{
+	struct timed_ctx *t = ctx;
+
+	stats_timer_start( &t->stats->timer );
+	timed_flush( t );
+	timed_writer->close( t->ctx );
+	stats_timer_stop( &t->stats->timer );
+
+	if ( fflush( t->out ) == 0 && fseeko( t->out, 0, SEEK_END ) == 0 )
+		t->stats->bytes = ftello( t->out );
+
+	free( t->ops );
+	free( t );
+}
+
+static struct filter_writer timed_filter_writer = {
+	.open_tilemap      = timed_open_tilemap,
+	.open_tonemap      = timed_open_tonemap,
+	.write_tile_lines  = timed_write_tile_lines,
+	.write_spaces      = timed_write_spaces,
+	.write_tile        = timed_write_tile,
+	.write_toneline    = timed_write_toneline,
+	.close             = timed_close
+};
+
+/**
+ *  #params     ,
+ *     .
+ */
+void
+get_filter_params( struct filter_params *params )
+{
+	params->width = width;
+	params->height = height;
+	params->hres = hres;
+	params->vres = vres;
+	params->is_cmyk = is_cmyk;
+	params->miniswhite = miniswhite;
+	params->bits = sample_bits;
+	params->negative_input = negative_input;
+	params->outformat = filter_outformat;
+}
 
 /**
  *     .
@@ -437,16 +906,23 @@ write_outbuf(char *outbuf, size_t ss, size_t len) {
 struct filter_writer *
 get_selected_filter_writer ()
 {
-	switch ( filter_outformat ) {
-	case FILTER_EPS_FMT:
-		return &ascii85_filter_writer;
-		break;
-	case FILTER_TIFF_FMT:
-		return &tiffout_filter_writer;
-	  break;
-	default:
+	struct filter_writer *writer;
+
+	writer = get_filter_writer( filter_outformat );
+	if ( !writer ) {
 		fprintf( stderr, "BUG: Unexpected filter format: %d\n",
 				 filter_outformat );
 		exit(EXIT_FAILURE);
 	}
+
+	/*       
+	 *   (     --- 
+	 *  ). */
+	if ( want_stats ) {
+		timed_writer = writer;
+		writer = &timed_filter_writer;
+	}
+
+	/*    . */
+	return get_async_filter_writer( writer, encode_ahead );
 }
@@ -44,6 +44,7 @@
  */
 
 #include <getopt.h>
+#include "libengrave.h"
 
 /*   . */
 extern char *program_name;
@@ -64,11 +65,35 @@ extern int unsigned long height;        /* 
 extern float hres;                      /*   ; */
 extern float vres;			/*   ; */
 extern int is_cmyk;			/*  4- ; */
-extern int miniswhite;			/*   . */
+extern int miniswhite;			/*   ; */
+extern int sample_bits;			/*   ޣ; */
+extern int negative_input;		/*    . */
 
-typedef enum { FILTER_EPS_FMT, FILTER_TIFF_FMT } filter_outformat_t;
 extern filter_outformat_t filter_outformat;
 
+/*   ,    . */
+extern unsigned long batch_rows;
+
+/*       (0 --- 
+ *   ). */
+extern unsigned int encode_ahead;
+
+/*       (0 --- 
+ *   stdio). */
+extern int io_depth;
+
+/*  ,   --describe.  
+ *      decode_switches(). */
+extern int filter_consumes_input;	/*   ; */
+extern int filter_produces_output;	/*   . */
+
+/*    ;   --no-output, 
+ *        . */
+extern int want_output;
+
+/*   . */
+extern int want_stats;
+
 /*  ,    . */
 typedef void(*usage_header_f)(FILE *out);
 
@@ -80,55 +105,11 @@ typedef void(*usage_params_f)(FILE *out);
 const char *get_tmp_filter_file_name( const char *fsuf, int color_idx );
 
 /**
- *     .
+ *     #fname    (
+ *   ,     --io-depth). 
+ * #NULL   .
  */
-struct filter_writer {
-	/**
-	 *      
-	 *     #outfile.   #mask 
-	 *  ().    ,
-	 *      .
-	 */
-	void * (*open_tilemap)      ( const char *outfile, int mask );
-	
-	/**
-	 *      
-	 *     #outfile.    ,
-	 *      .
-	 */
-	void * (*open_tonemap)      ( const char *outfile );
-
-	/**
-	 *  #zl  .  #zl > 1,  
-     *   .
-	 */
-	void   (*write_tile_lines) ( void *ctx, unsigned int zl );
-
-	/**
-	 *  #z .
-	 */
-	void   (*write_spaces)      ( void *ctx, unsigned int z );
-
-	/**
-	 *     #tile_index  
-	 *  #tile_area.
-	 */
-	void   (*write_tile)        ( void *ctx,
-								  unsigned char tile_index,
-								  unsigned char tile_area );
-
-	/**
-	 *    .   #count ޣ
-	 *  #ss     #buf.
-	 */
-	void  (*write_toneline)     ( void *ctx, const char *buf,
-								  size_t ss, size_t count );
-
-	/**
-	 *     .
-	 */
-	void   (*close)             ( void *ctx );
-};
+FILE *open_tmp_filter_file( const char *fname );
 
 char *get_filter_option(int i, char *dst_fopt, char *fopts);
 
@@ -138,6 +119,13 @@ int decode_switches (int argc, char **argv, int error_code, \
 		     usage_params_f usage_params);
 
 void write_outbuf(char *outbuf, size_t ss, size_t len);
+void write_outbuf_rows(char *outbuf, size_t ss, size_t len, size_t rows);
+
+/**
+ *  #params     ,
+ *     .
+ */
+void get_filter_params( struct filter_params *params );
 
 /**
  *     .
@@ -0,0 +1,353 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*      ITU-T T.6
+ * (CCITT Group 4). */
+
+#include "system.h"
+#include "g4enc.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/**
+ *  :  ()   
+ * .
+ */
+struct g4enc {
+	FILE *out;
+	unsigned long width;
+	size_t linesize;
+	unsigned char *ref;
+	unsigned long bits;		/*   ( #nbits). */
+	int nbits;
+};
+
+/* :     . */
+struct g4code {
+	unsigned char len;
+	unsigned short code;
+};
+
+/*   . */
+static const char *pass_str = "0001";
+static const char *horiz_str = "001";
+static const char *vert_str[7] = {
+	"0000011", "000011", "011", "1", "010", "000010", "0000010"
+};
+
+/*     0 - 63. */
+static const char *white_term_str[64] = {
+	"00110101", "000111", "0111", "1000", "1011", "1100", "1110", "1111",
+	"10011", "10100", "00111", "01000", "001000", "000011", "110100",
+	"110101", "101010", "101011", "0100111", "0001100", "0001000",
+	"0010111", "0000011", "0000100", "0101000", "0101011", "0010011",
+	"0100100", "0011000", "00000010", "00000011", "00011010",
+	"00011011", "00010010", "00010011", "00010100", "00010101",
+	"00010110", "00010111", "00101000", "00101001", "00101010",
+	"00101011", "00101100", "00101101", "00000100", "00000101",
+	"00001010", "00001011", "01010010", "01010011", "01010100",
+	"01010101", "00100100", "00100101", "01011000", "01011001",
+	"01011010", "01011011", "01001010", "01001011", "00110010",
+	"00110011", "00110100"
+};
+
+static const char *black_term_str[64] = {
+	"0000110111", "010", "11", "10", "011", "0011", "0010", "00011",
+	"000101", "000100", "0000100", "0000101", "0000111", "00000100",
+	"00000111", "000011000", "0000010111", "0000011000", "0000001000",
+	"00001100111", "00001101000", "00001101100", "00000110111",
+	"00000101000", "00000010111", "00000011000", "000011001010",
+	"000011001011", "000011001100", "000011001101", "000001101000",
+	"000001101001", "000001101010", "000001101011", "000011010010",
+	"000011010011", "000011010100", "000011010101", "000011010110",
+	"000011010111", "000001101100", "000001101101", "000011011010",
+	"000011011011", "000001010100", "000001010101", "000001010110",
+	"000001010111", "000001100100", "000001100101", "000001010010",
+	"000001010011", "000000100100", "000000110111", "000000111000",
+	"000000100111", "000000101000", "000001011000", "000001011001",
+	"000000101011", "000000101100", "000001011010", "000001100110",
+	"000001100111"
+};
+
+/*     64 - 1728   64. */
+static const char *white_makeup_str[27] = {
+	"11011", "10010", "010111", "0110111", "00110110", "00110111",
+	"01100100", "01100101", "01101000", "01100111", "011001100",
+	"011001101", "011010010", "011010011", "011010100", "011010101",
+	"011010110", "011010111", "011011000", "011011001", "011011010",
+	"011011011", "010011000", "010011001", "010011010", "011000",
+	"010011011"
+};
+
+static const char *black_makeup_str[27] = {
+	"0000001111", "000011001000", "000011001001", "000001011011",
+	"000000110011", "000000110100", "000000110101", "0000001101100",
+	"0000001101101", "0000001001010", "0000001001011", "0000001001100",
+	"0000001001101", "0000001110010", "0000001110011", "0000001110100",
+	"0000001110101", "0000001110110", "0000001110111", "0000001010010",
+	"0000001010011", "0000001010100", "0000001010101", "0000001011010",
+	"0000001011011", "0000001100100", "0000001100101"
+};
+
+/*        1792 - 2560. */
+static const char *ext_makeup_str[13] = {
+	"00000001000", "00000001100", "00000001101", "000000010010",
+	"000000010011", "000000010100", "000000010101", "000000010110",
+	"000000010111", "000000011100", "000000011101", "000000011110",
+	"000000011111"
+};
+
+/*  : 0 - 63 , 64 + k -  
+ *  64 * (k + 1). */
+#define RUN_CODES (64 + 40)
+static struct g4code white_codes[RUN_CODES];
+static struct g4code black_codes[RUN_CODES];
+static struct g4code pass_code, horiz_code, vert_codes[7];
+
+/*    . */
+static struct g4code
+make_code( const char *s )
+{
+	struct g4code c = { 0, 0 };
+
+	for ( ; *s; s++ ) {
+		c.code = (c.code << 1) | (*s == '1');
+		c.len++;
+	}
+	return c;
+}
+
+/*   . */
+static void
+fill_codes()
+{
+	int i;
+
+	for ( i = 0; i < 64; i++ ) {
+		white_codes[i] = make_code( white_term_str[i] );
+		black_codes[i] = make_code( black_term_str[i] );
+	}
+	for ( i = 0; i < 27; i++ ) {
+		white_codes[64 + i] = make_code( white_makeup_str[i] );
+		black_codes[64 + i] = make_code( black_makeup_str[i] );
+	}
+	for ( i = 0; i < 13; i++ ) {
+		white_codes[64 + 27 + i] = make_code( ext_makeup_str[i] );
+		black_codes[64 + 27 + i] = make_code( ext_makeup_str[i] );
+	}
+	pass_code = make_code( pass_str );
+	horiz_code = make_code( horiz_str );
+	for ( i = 0; i < 7; i++ ) {
+		vert_codes[i] = make_code( vert_str[i] );
+	}
+}
+
+/*      ,  ,  
+ *       . */
+static void
+init_codes()
+{
+#ifdef HAVE_PTHREAD_H
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once( &once, fill_codes );
+#else
+	static int initialized = 0;
+
+	if ( initialized ) return;
+	fill_codes();
+	initialized = 1;
+#endif
+}
+
+/*    . */
+static inline void
+put_code( struct g4enc *e, struct g4code c )
+{
+	e->bits = (e->bits << c.len) | c.code;
+	e->nbits += c.len;
+	while ( e->nbits >= 8 ) {
+		e->nbits -= 8;
+		putc( (e->bits >> e->nbits) & 0xFF, e->out );
+	}
+}
+
+/*    #span   #tab. */
+static void
+put_span( struct g4enc *e, unsigned long span, const struct g4code *tab )
+{
+	while ( span >= 2624 ) {
+		put_code( e, tab[64 + 39] );
+		span -= 2560;
+	}
+	if ( span >= 64 ) {
+		put_code( e, tab[64 + (span >> 6) - 1] );
+		span &= 63;
+	}
+	put_code( e, tab[span] );
+}
+
+/*   #x  #p. */
+#define PIXEL(p, x) (((p)[(x) >> 3] >> (7 - ((x) & 7))) & 1)
+
+/**
+ *    ,   #color, 
+ *  #x,  #width,   .
+ */
+static unsigned long
+find_diff( const unsigned char *p, unsigned long x, unsigned long width,
+		   int color )
+{
+	unsigned char fill = color ? 0xFF : 0x00;
+
+	/*   . */
+	while ( x < width && (x & 7) ) {
+		if ( PIXEL( p, x ) != color ) return x;
+		x++;
+	}
+	/*    . */
+	while ( x + 8 <= width && p[x >> 3] == fill ) {
+		x += 8;
+	}
+	while ( x < width && PIXEL( p, x ) == color ) {
+		x++;
+	}
+
+	return x < width ? x : width;
+}
+
+struct g4enc *
+g4enc_open( FILE *out, unsigned long width )
+{
+	struct g4enc *e;
+
+	init_codes();
+
+	e = malloc( sizeof(*e) );
+	if ( e == NULL ) return NULL;
+
+	e->out = out;
+	e->width = width;
+	e->linesize = (width + 7) / 8;
+	e->bits = 0;
+	e->nbits = 0;
+	/*     -- . */
+	e->ref = calloc( e->linesize, 1 );
+	if ( e->ref == NULL ) {
+		free( e );
+		return NULL;
+	}
+
+	return e;
+}
+
+void
+g4enc_encode_row( struct g4enc *e, const unsigned char *row )
+{
+	const unsigned char *ref = e->ref;
+	unsigned long width = e->width;
+	unsigned long a0, a1, a2, b1, b2;
+	long d;
+	int color;
+
+	/*     
+	 * (T.6, 2.2).   a0    
+	 *  . */
+	a0 = 0;
+	a1 = PIXEL( row, 0 ) ? 0 : find_diff( row, 0, width, 0 );
+	b1 = PIXEL( ref, 0 ) ? 0 : find_diff( ref, 0, width, 0 );
+
+	for ( ;; ) {
+		b2 = b1 < width ? find_diff( ref, b1, width, PIXEL( ref, b1 ) )
+			: width;
+		if ( b2 < a1 ) {
+			/*  . */
+			put_code( e, pass_code );
+			a0 = b2;
+		} else {
+			d = (long) b1 - (long) a1;
+			if ( d >= -3 && d <= 3 ) {
+				/*  . */
+				put_code( e, vert_codes[d + 3] );
+				a0 = a1;
+			} else {
+				/*  :   . */
+				a2 = a1 < width
+					? find_diff( row, a1, width, PIXEL( row, a1 ) ) : width;
+				put_code( e, horiz_code );
+				if ( a0 + a1 == 0 || PIXEL( row, a0 ) == 0 ) {
+					put_span( e, a1 - a0, white_codes );
+					put_span( e, a2 - a1, black_codes );
+				} else {
+					put_span( e, a1 - a0, black_codes );
+					put_span( e, a2 - a1, white_codes );
+				}
+				a0 = a2;
+			}
+		}
+		if ( a0 >= width ) break;
+
+		color = PIXEL( row, a0 );
+		a1 = find_diff( row, a0, width, color );
+		b1 = find_diff( ref, a0, width, !color );
+		b1 = find_diff( ref, b1, width, color );
+	}
+
+	memcpy( e->ref, row, e->linesize );
+}
+
+int
+g4enc_close( struct g4enc *e )
+{
+	int ret;
+
+	/* EOFB:   EOL. */
+	put_code( e, make_code( "000000000001" ) );
+	put_code( e, make_code( "000000000001" ) );
+	if ( e->nbits > 0 ) {
+		putc( (e->bits << (8 - e->nbits)) & 0xFF, e->out );
+	}
+	ret = ferror( e->out ) ? -1 : 0;
+
+	free( e->ref );
+	free( e );
+
+	return ret;
+}
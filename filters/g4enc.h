@@ -0,0 +1,72 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __G4ENC_H
+#define __G4ENC_H
+
+/*      ITU-T T.6
+ * (CCITT Group 4). */
+
+#include <stdio.h>
+
+/**
+ *  .
+ */
+struct g4enc;
+
+/**
+ *     #width , 
+ *    #out.      #NULL 
+ *  .
+ */
+struct g4enc *g4enc_open( FILE *out, unsigned long width );
+
+/**
+ *   #row:    8  ,  
+ *  ; 1  ޣ  (BlackIs1).
+ */
+void g4enc_encode_row( struct g4enc *e, const unsigned char *row );
+
+/**
+ *     (EOFB),   
+ *     .   .
+ *  0   .
+ */
+int g4enc_close( struct g4enc *e );
+
+#endif /* __G4ENC_H */
@@ -0,0 +1,698 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+
+
+/*      ITU-T T.88
+ * (JBIG2).
+ *
+ *    :   ,
+ *        .
+ *          
+ * ;        0.
+ *         
+ *  Y (SBSTRIPS = 1),   --  . */
+
+#include "system.h"
+#include "jbig2enc.h"
+#include <stdint.h>
+
+/*  . */
+#define SEG_SYMBOL_DICT   0
+#define SEG_TEXT_REGION   7	/* ,  . */
+#define SEG_PAGE_INFO     48
+
+/*  . */
+#define SEGNO_PAGE_INFO   0
+#define SEGNO_SYMBOL_DICT 1
+#define SEGNO_TEXT_REGION 2
+
+/*   : REFCORNER = TOPLEFT. */
+#define TEXT_REGION_FLAGS 0x0010
+
+/*       
+ *  0 ݣ . */
+#define IA_CONTEXTS 512
+#define GB_CONTEXTS 65536
+
+/*    MQ- (T.88, . E.1). */
+struct qe_entry {
+	uint16_t qe;
+	unsigned char nmps;
+	unsigned char nlps;
+	unsigned char sw;
+};
+
+static const struct qe_entry qe_table[47] = {
+	{ 0x5601,  1,  1, 1 }, { 0x3401,  2,  6, 0 }, { 0x1801,  3,  9, 0 },
+	{ 0x0AC1,  4, 12, 0 }, { 0x0521,  5, 29, 0 }, { 0x0221, 38, 33, 0 },
+	{ 0x5601,  7,  6, 1 }, { 0x5401,  8, 14, 0 }, { 0x4801,  9, 14, 0 },
+	{ 0x3801, 10, 14, 0 }, { 0x3001, 11, 17, 0 }, { 0x2401, 12, 18, 0 },
+	{ 0x1C01, 13, 20, 0 }, { 0x1601, 29, 21, 0 }, { 0x5601, 15, 14, 1 },
+	{ 0x5401, 16, 14, 0 }, { 0x5101, 17, 15, 0 }, { 0x4801, 18, 16, 0 },
+	{ 0x3801, 19, 17, 0 }, { 0x3401, 20, 18, 0 }, { 0x3001, 21, 19, 0 },
+	{ 0x2801, 22, 19, 0 }, { 0x2401, 23, 20, 0 }, { 0x2201, 24, 21, 0 },
+	{ 0x1C01, 25, 22, 0 }, { 0x1801, 26, 23, 0 }, { 0x1601, 27, 24, 0 },
+	{ 0x1401, 28, 25, 0 }, { 0x1201, 29, 26, 0 }, { 0x1101, 30, 27, 0 },
+	{ 0x0AC1, 31, 28, 0 }, { 0x09C1, 32, 29, 0 }, { 0x08A1, 33, 30, 0 },
+	{ 0x0521, 34, 31, 0 }, { 0x0441, 35, 32, 0 }, { 0x02A1, 36, 33, 0 },
+	{ 0x0221, 37, 34, 0 }, { 0x0141, 38, 35, 0 }, { 0x0111, 39, 36, 0 },
+	{ 0x0085, 40, 37, 0 }, { 0x0049, 41, 38, 0 }, { 0x0025, 42, 39, 0 },
+	{ 0x0015, 43, 40, 0 }, { 0x0009, 44, 41, 0 }, { 0x0005, 45, 42, 0 },
+	{ 0x0001, 45, 43, 0 }, { 0x5601, 46, 46, 0 }
+};
+
+/*       (T.88, . A.1):
+ *  ,     . */
+struct int_range {
+	unsigned long lo;
+	unsigned int prefix;
+	int prefixlen;
+	int bits;
+};
+
+static const struct int_range int_ranges[] = {
+	{    0, 0x00, 1,  2 },
+	{    4, 0x02, 2,  4 },
+	{   20, 0x06, 3,  6 },
+	{   84, 0x0E, 4,  8 },
+	{  340, 0x1E, 5, 12 },
+	{ 4436, 0x1F, 5, 32 }
+};
+
+#define INT_RANGES (sizeof(int_ranges) / sizeof(int_ranges[0]))
+
+/**
+ *   :     
+ *  .
+ */
+struct mqctx {
+	unsigned char index;
+	unsigned char mps;
+};
+
+/**
+ *  MQ-.
+ */
+struct mqenc {
+	FILE *out;
+	uint32_t a;
+	uint32_t c;
+	int ct;
+	unsigned int b;			/* ݣ   . */
+	int started;			/*     #b. */
+};
+
+/*    . */
+enum { IADH, IADW, IAEX, IADT, IAFS, IADS, IA_COUNT };
+
+/**
+ *  .
+ */
+struct jbig2enc {
+	FILE *out;
+	unsigned long width;
+	unsigned long height;
+	unsigned int nsyms;
+	unsigned int symw;
+	int codelen;			/* SBSYMCODELEN */
+	struct mqenc mq;
+	struct mqctx ia[IA_COUNT][IA_CONTEXTS];
+	struct mqctx *iaid;
+	long length_pos;		/*     . */
+	long data_pos;			/*    . */
+	unsigned long ninstances;
+	int in_strip;
+	long stript;
+	long firsts;
+	long curs;
+};
+
+static void mq_init( struct mqenc *m, FILE *out );
+static void mq_encode( struct mqenc *m, struct mqctx *cx, int d );
+static void mq_flush( struct mqenc *m );
+static void encode_int( struct mqenc *m, struct mqctx *cx, long v );
+static void encode_oob( struct mqenc *m, struct mqctx *cx );
+static void encode_id( struct jbig2enc *e, unsigned int id );
+static void encode_generic( struct mqenc *m, struct mqctx *gb,
+							const unsigned char *bitmap,
+							int w, int h );
+static void put_u16( FILE *out, unsigned int v );
+static void put_u32( FILE *out, unsigned long v );
+static long put_segment_header( FILE *out, unsigned long number,
+								int type, int refer,
+								unsigned long length );
+static int patch_u32( FILE *out, long pos, unsigned long v );
+static int write_page_info( struct jbig2enc *e );
+static int write_symbol_dict( struct jbig2enc *e,
+							  const unsigned char *syms,
+							  unsigned int symh );
+
+/**
+ *       , 
+ *     .
+ */
+struct jbig2enc *
+jbig2enc_open( FILE *out, unsigned long width, unsigned long height,
+			   const unsigned char *syms, unsigned int nsyms,
+			   unsigned int symw, unsigned int symh )
+{
+	struct jbig2enc *e;
+
+	if ( nsyms == 0 || symw == 0 || symh == 0 ) {
+		fprintf( stderr, "JBIG2: empty symbol dictionary\n" );
+		return NULL;
+	}
+
+	e = (struct jbig2enc *) calloc( 1, sizeof(struct jbig2enc) );
+	if ( !e ) {
+		fprintf( stderr, "Unable to allocate memory\n" );
+		return NULL;
+	}
+	e->out = out;
+	e->width = width;
+	e->height = height;
+	e->nsyms = nsyms;
+	e->symw = symw;
+	while ( (1UL << e->codelen) < nsyms ) {
+		e->codelen++;
+	}
+	e->iaid = (struct mqctx *) calloc( 1UL << (e->codelen + 1),
+									   sizeof(struct mqctx) );
+	if ( !e->iaid ) {
+		fprintf( stderr, "Unable to allocate memory\n" );
+		free( e );
+		return NULL;
+	}
+
+	if ( write_page_info( e ) || write_symbol_dict( e, syms, symh ) ) {
+		free( e->iaid );
+		free( e );
+		return NULL;
+	}
+
+	/*   ;    
+	 *   . */
+	e->length_pos = put_segment_header( out, SEGNO_TEXT_REGION,
+										SEG_TEXT_REGION,
+										SEGNO_SYMBOL_DICT, 0 );
+	e->data_pos = ftell( out );
+	put_u32( out, width );
+	put_u32( out, height );
+	put_u32( out, 0 );
+	put_u32( out, 0 );
+	putc( 0, out );
+	put_u16( out, TEXT_REGION_FLAGS );
+	put_u32( out, 0 );
+	if ( e->length_pos < 0 || e->data_pos < 0 || ferror( out ) ) {
+		fprintf( stderr, "JBIG2: unable to write the text region\n" );
+		free( e->iaid );
+		free( e );
+		return NULL;
+	}
+
+	mq_init( &e->mq, out );
+	memset( e->ia, 0, sizeof(e->ia) );
+	/*   STRIPT. */
+	encode_int( &e->mq, e->ia[IADT], 0 );
+
+	return e;
+}
+
+/**
+ *    #id   (#x, #y).
+ */
+void
+jbig2enc_put_symbol( struct jbig2enc *e, unsigned long x,
+					 unsigned long y, unsigned int id )
+{
+	if ( id >= e->nsyms || x >= e->width || y >= e->height ) {
+		fprintf( stderr, "JBIG2: symbol %u at %lu,%lu is out of range\n",
+				 id, x, y );
+		return;
+	}
+
+	if ( e->in_strip && (long) y != e->stript ) {
+		if ( (long) y < e->stript ) {
+			fprintf( stderr, "JBIG2: symbol %u at %lu,%lu is out of "
+					 "order\n", id, x, y );
+			return;
+		}
+		encode_oob( &e->mq, e->ia[IADS] );
+		e->in_strip = 0;
+	}
+
+	if ( !e->in_strip ) {
+		/*  :  T  S  . */
+		encode_int( &e->mq, e->ia[IADT], (long) y - e->stript );
+		e->stript = y;
+		encode_int( &e->mq, e->ia[IAFS], (long) x - e->firsts );
+		e->firsts = x;
+		e->in_strip = 1;
+	} else {
+		if ( (long) x <= e->curs ) {
+			fprintf( stderr, "JBIG2: symbol %u at %lu,%lu is out of "
+					 "order\n", id, x, y );
+			return;
+		}
+		encode_int( &e->mq, e->ia[IADS], (long) x - e->curs );
+	}
+
+	encode_id( e, id );
+	e->curs = x + e->symw - 1;
+	e->ninstances++;
+}
+
+/**
+ *      .
+ */
+int
+jbig2enc_close( struct jbig2enc *e )
+{
+	long end;
+	int ret = 0;
+
+	if ( e->in_strip ) {
+		encode_oob( &e->mq, e->ia[IADS] );
+	}
+	mq_flush( &e->mq );
+
+	end = ftell( e->out );
+	if ( end < 0 ||
+		 patch_u32( e->out, e->length_pos, end - e->data_pos ) ||
+		 patch_u32( e->out, e->data_pos + 19, e->ninstances ) ||
+		 fseek( e->out, end, SEEK_SET ) ||
+		 ferror( e->out ) )
+	{
+		fprintf( stderr, "JBIG2: unable to finish the text region\n" );
+		ret = 1;
+	}
+
+	free( e->iaid );
+	free( e );
+
+	return ret;
+}
+
+
+/* . */
+
+/**
+ *     .
+ */
+static int
+write_page_info( struct jbig2enc *e )
+{
+	if ( put_segment_header( e->out, SEGNO_PAGE_INFO, SEG_PAGE_INFO,
+							 -1, 19 ) < 0 )
+		return 1;
+
+	put_u32( e->out, e->width );
+	put_u32( e->out, e->height );
+	put_u32( e->out, 0 );		/*   . */
+	put_u32( e->out, 0 );
+	putc( 0x01, e->out );		/*   . */
+	put_u16( e->out, 0 );		/*  . */
+
+	return ferror( e->out ) ? 1 : 0;
+}
+
+/**
+ *    #e->nsyms  #syms  #symh.
+ */
+static int
+write_symbol_dict( struct jbig2enc *e, const unsigned char *syms,
+				   unsigned int symh )
+{
+	static const signed char at[8] = { 3, -1, -3, -1, 2, -2, -2, -2 };
+	struct mqctx *gb;
+	long pos, start, end;
+	unsigned int i;
+
+	gb = (struct mqctx *) calloc( GB_CONTEXTS, sizeof(struct mqctx) );
+	if ( !gb ) {
+		fprintf( stderr, "Unable to allocate memory\n" );
+		return 1;
+	}
+
+	pos = put_segment_header( e->out, SEGNO_SYMBOL_DICT,
+							  SEG_SYMBOL_DICT, -1, 0 );
+	start = ftell( e->out );
+	if ( pos < 0 || start < 0 ) {
+		free( gb );
+		return 1;
+	}
+
+	/*  ,  0  
+	 *  . */
+	put_u16( e->out, 0 );
+	for ( i = 0; i < sizeof(at); i++ ) {
+		putc( (unsigned char) at[i], e->out );
+	}
+	put_u32( e->out, e->nsyms );
+	put_u32( e->out, e->nsyms );
+
+	mq_init( &e->mq, e->out );
+	memset( e->ia, 0, sizeof(e->ia) );
+
+	encode_int( &e->mq, e->ia[IADH], symh );
+	for ( i = 0; i < e->nsyms; i++ ) {
+		encode_int( &e->mq, e->ia[IADW], i == 0 ? e->symw : 0 );
+		encode_generic( &e->mq, gb, syms + (size_t) i * e->symw * symh,
+						e->symw, symh );
+	}
+	encode_oob( &e->mq, e->ia[IADW] );
+
+	/*   . */
+	encode_int( &e->mq, e->ia[IAEX], 0 );
+	encode_int( &e->mq, e->ia[IAEX], e->nsyms );
+	mq_flush( &e->mq );
+	free( gb );
+
+	end = ftell( e->out );
+	if ( end < 0 || patch_u32( e->out, pos, end - start ) ||
+		 fseek( e->out, end, SEEK_SET ) || ferror( e->out ) )
+	{
+		fprintf( stderr, "JBIG2: unable to write the symbol "
+				 "dictionary\n" );
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ *    #number  #type,  
+ *  #refer (   ,  #refer < 0),  
+ *  ,    #length.   
+ *   -1   .
+ */
+static long
+put_segment_header( FILE *out, unsigned long number, int type, int refer,
+					unsigned long length )
+{
+	long pos;
+
+	put_u32( out, number );
+	putc( type, out );
+	if ( refer < 0 ) {
+		putc( 0x00, out );
+	} else {
+		putc( 0x20, out );
+		putc( refer, out );
+	}
+	putc( 1, out );
+
+	pos = ftell( out );
+	put_u32( out, length );
+
+	return ferror( out ) ? -1 : pos;
+}
+
+/**
+ *  #v   #pos  #out.
+ */
+static int
+patch_u32( FILE *out, long pos, unsigned long v )
+{
+	if ( fseek( out, pos, SEEK_SET ) ) return 1;
+	put_u32( out, v );
+	return ferror( out ) ? 1 : 0;
+}
+
+static void
+put_u16( FILE *out, unsigned int v )
+{
+	putc( (v >> 8) & 0xff, out );
+	putc( v & 0xff, out );
+}
+
+static void
+put_u32( FILE *out, unsigned long v )
+{
+	putc( (v >> 24) & 0xff, out );
+	putc( (v >> 16) & 0xff, out );
+	putc( (v >> 8) & 0xff, out );
+	putc( v & 0xff, out );
+}
+
+
+/*  . */
+
+/**
+ *     (INITENC).
+ */
+static void
+mq_init( struct mqenc *m, FILE *out )
+{
+	m->out = out;
+	m->a = 0x8000;
+	m->c = 0;
+	m->ct = 12;
+	m->b = 0;
+	m->started = 0;
+}
+
+/**
+ *    (BYTEOUT)  ޣ   
+ *    0xFF.
+ */
+static void
+mq_byteout( struct mqenc *m )
+{
+	int stuff = 0;
+
+	if ( m->b == 0xff ) {
+		stuff = 1;
+	} else if ( m->c >= 0x8000000 ) {
+		m->b++;
+		if ( m->b == 0xff ) {
+			m->c &= 0x7ffffff;
+			stuff = 1;
+		}
+	}
+
+	if ( m->started ) {
+		putc( m->b, m->out );
+	}
+	m->started = 1;
+
+	if ( stuff ) {
+		m->b = m->c >> 20;
+		m->c &= 0xfffff;
+		m->ct = 7;
+	} else {
+		m->b = m->c >> 19;
+		m->c &= 0x7ffff;
+		m->ct = 8;
+	}
+}
+
+/**
+ *   #d   #cx (ENCODE).
+ */
+static void
+mq_encode( struct mqenc *m, struct mqctx *cx, int d )
+{
+	const struct qe_entry *q = &qe_table[cx->index];
+
+	m->a -= q->qe;
+	if ( d == cx->mps ) {
+		if ( m->a & 0x8000 ) {
+			m->c += q->qe;
+			return;
+		}
+		if ( m->a < q->qe ) {
+			m->a = q->qe;
+		} else {
+			m->c += q->qe;
+		}
+		cx->index = q->nmps;
+	} else {
+		if ( m->a < q->qe ) {
+			m->c += q->qe;
+		} else {
+			m->a = q->qe;
+		}
+		if ( q->sw ) {
+			cx->mps = !cx->mps;
+		}
+		cx->index = q->nlps;
+	}
+
+	do {
+		m->a <<= 1;
+		m->c <<= 1;
+		if ( --m->ct == 0 ) {
+			mq_byteout( m );
+		}
+	} while ( !(m->a & 0x8000) );
+}
+
+/**
+ *     (FLUSH) 
+ * 0xFF 0xAC.
+ */
+static void
+mq_flush( struct mqenc *m )
+{
+	uint32_t tempc = m->c + m->a;
+
+	m->c |= 0xffff;
+	if ( m->c >= tempc ) {
+		m->c -= 0x8000;
+	}
+	m->c <<= m->ct;
+	mq_byteout( m );
+	m->c <<= m->ct;
+	mq_byteout( m );
+
+	putc( m->b, m->out );
+	if ( m->b != 0xff ) {
+		putc( 0xff, m->out );
+	}
+	putc( 0xac, m->out );
+}
+
+/**
+ *   #d      #prev.
+ */
+static void
+encode_int_bit( struct mqenc *m, struct mqctx *cx, unsigned int *prev,
+				int d )
+{
+	mq_encode( m, &cx[*prev], d );
+	if ( *prev < 256 ) {
+		*prev = (*prev << 1) | d;
+	} else {
+		*prev = (((*prev << 1) | d) & 511) | 256;
+	}
+}
+
+/**
+ *    #v (T.88, A.2).
+ */
+static void
+encode_int( struct mqenc *m, struct mqctx *cx, long v )
+{
+	const struct int_range *r;
+	unsigned long mag = v < 0 ? -v : v;
+	unsigned int prev = 1;
+	size_t i;
+	int j;
+
+	for ( i = 1; i < INT_RANGES && mag >= int_ranges[i].lo; i++ )
+		;
+	r = &int_ranges[i - 1];
+	mag -= r->lo;
+
+	encode_int_bit( m, cx, &prev, v < 0 );
+	for ( j = r->prefixlen - 1; j >= 0; j-- ) {
+		encode_int_bit( m, cx, &prev, (r->prefix >> j) & 1 );
+	}
+	for ( j = r->bits - 1; j >= 0; j-- ) {
+		encode_int_bit( m, cx, &prev, (mag >> j) & 1 );
+	}
+}
+
+/**
+ *   OOB ("-0").
+ */
+static void
+encode_oob( struct mqenc *m, struct mqctx *cx )
+{
+	unsigned int prev = 1;
+	int j;
+
+	encode_int_bit( m, cx, &prev, 1 );
+	for ( j = 0; j < 3; j++ ) {
+		encode_int_bit( m, cx, &prev, 0 );
+	}
+}
+
+/**
+ *    #id (T.88, A.3).
+ */
+static void
+encode_id( struct jbig2enc *e, unsigned int id )
+{
+	unsigned int prev = 1;
+	int j, d;
+
+	for ( j = e->codelen - 1; j >= 0; j-- ) {
+		d = (id >> j) & 1;
+		mq_encode( &e->mq, &e->iaid[prev], d );
+		prev = (prev << 1) | d;
+	}
+}
+
+/**
+ *   (#x, #y)  #bitmap  #w x #h;
+ *    -- 0.
+ */
+static inline int
+pixel( const unsigned char *bitmap, int w, int h, int x, int y )
+{
+	return x >= 0 && x < w && y >= 0 && y < h && bitmap[y * w + x];
+}
+
+/**
+ *   #bitmap  #w x #h   0 
+ *  #gb (T.88, 6.2.5.3).
+ */
+static void
+encode_generic( struct mqenc *m, struct mqctx *gb,
+				const unsigned char *bitmap, int w, int h )
+{
+	unsigned int cx;
+	int x, y;
+
+#define P(dx, dy) pixel( bitmap, w, h, x + (dx), y + (dy) )
+	for ( y = 0; y < h; y++ ) {
+		for ( x = 0; x < w; x++ ) {
+			cx = P(-1, 0) | P(-2, 0) << 1 | P(-3, 0) << 2 |
+				P(-4, 0) << 3 | P(3, -1) << 4 | P(2, -1) << 5 |
+				P(1, -1) << 6 | P(0, -1) << 7 | P(-1, -1) << 8 |
+				P(-2, -1) << 9 | P(-3, -1) << 10 | P(2, -2) << 11 |
+				P(1, -2) << 12 | P(0, -2) << 13 | P(-1, -2) << 14 |
+				P(-2, -2) << 15;
+			mq_encode( m, &gb[cx], P(0, 0) );
+		}
+	}
+#undef P
+}
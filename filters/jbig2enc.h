@@ -0,0 +1,88 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+
+
+#ifndef __JBIG2ENC_H
+#define __JBIG2ENC_H
+
+/*      ITU-T T.88
+ * (JBIG2):       ,
+ *  .    ,
+ *    JBIG2Decode  PDF:  
+ *     . */
+
+#include <stdio.h>
+
+/**
+ *  .
+ */
+struct jbig2enc;
+
+/**
+ *     #width x #height ,
+ *     #out.   #nsyms
+ *   #symw x #symh,   #syms   
+ *   (  -- ޣ).  
+ * .    :  
+ *       .
+ *      #NULL   .
+ */
+struct jbig2enc *jbig2enc_open( FILE *out, unsigned long width,
+								unsigned long height,
+								const unsigned char *syms,
+								unsigned int nsyms,
+								unsigned int symw, unsigned int symh );
+
+/**
+ *     #id   (#x, #y) ( 
+ * ).      ף: 
+ *  #y,    --   #x 
+ * .
+ */
+void jbig2enc_put_symbol( struct jbig2enc *e, unsigned long x,
+						  unsigned long y, unsigned int id );
+
+/**
+ *   ,    
+ *  .   .  0  
+ * .
+ */
+int jbig2enc_close( struct jbig2enc *e );
+
+#endif /* __JBIG2ENC_H */
@@ -0,0 +1,957 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*   :   
+ *   ()    , 
+ *  . */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <string.h>
+
+#include "system.h"
+#include "smp.h"
+#include "libengrave.h"
+#include "tile32f.h"
+#include "ascii85.h"
+#include "tiffout.h"
+#include "pdfout.h"
+
+/**
+ *  .
+ */
+struct engrave_ctx {
+	struct engrave_params params;	/*  . */
+	struct engrave_output output;	/*  . */
+	struct engrave_stats stats;		/*   . */
+
+	size_t ss;				/*  ޣ  . */
+	size_t smp;				/*  ޣ   : 1  2
+							 *  16- . */
+	int c0, cN;				/*     . */
+
+	/*     5  ,  
+	 *   . */
+	unsigned char *buf[5];
+
+	/*      . */
+	unsigned char *outbuf;
+
+	/* ޣ      . */
+	struct maketiles_info mi[4];
+
+	/*      . */
+	struct tile32_params *sweep;
+	struct engrave_stats *sweep_stats;
+
+	/*     :   
+	 *  ,     
+	 *     . */
+	int *sweep_index;
+
+	unsigned long y;		/*   . */
+	unsigned long y_out;	/*   . */
+
+	/*       
+	 * (  ģ , . #engrave_output). */
+	struct engrave_tile *rec_tiles[4];
+	size_t rec_count[4];
+};
+
+/**
+ *   ޣ      
+ *  ޣ    .  #sums  #NULL, 
+ *      .
+ */
+static void
+sweep_window( struct engrave_ctx *ctx, t_window window,
+			  const struct tile32_sums *sums )
+{
+	struct engrave_stats *stats;
+	int neg, *tile_index;
+	unsigned char tile_area, bg_value;
+	unsigned short bg_value16;
+	size_t i;
+
+	for ( i = 0; i < ctx->params.sweep_count; i++ ) {
+		stats = &ctx->sweep_stats[i];
+		tile_index = &ctx->sweep_index[i];
+		if ( sums == NULL ) {
+			*tile_index = 0;
+			stats->zerotile++;
+			continue;
+		}
+		if ( ctx->smp == 2 )
+			get_tile_sums16( &ctx->sweep[i], window, sums, &neg,
+							 tile_index, &tile_area, &bg_value16 );
+		else
+			get_tile_sums( &ctx->sweep[i], window, sums, &neg,
+						   tile_index, &tile_area, &bg_value );
+		if ( !*tile_index )
+			stats->zerotile++;
+		else if ( neg )
+			stats->nhist[*tile_index-1]++;
+		else
+			stats->phist[*tile_index-1]++;
+	}
+}
+
+/**
+ *   #tile_index   #tile_area   #neg
+ *    #c.    
+ *     ,    
+ * ޣ #mi,   ޣ .
+ */
+static inline void
+put_tile( struct engrave_ctx *ctx, int c, struct maketiles_info *mi,
+		  int tile_index, unsigned char tile_area, int neg )
+{
+	struct filter_writer *filter_writer_p = ctx->output.writer;
+
+	/*   ޣ      . */
+	unsigned int z;
+	unsigned int zl;
+
+	/*  . */
+	void *filter_writer_ctx;
+
+	/*      
+	 *    .
+	 */
+	if (neg) {
+		/*     
+		 * .
+		 */
+		ctx->stats.nhist[tile_index-1]++;
+		/*    
+		 *    . */
+		filter_writer_ctx = ctx->output.neg_writer[c];
+		z = mi->nz;
+		zl = mi->nzl;
+	} else {
+		/*     
+		 * .
+		 */
+		ctx->stats.phist[tile_index-1]++;
+		/*    
+		 *    . */
+		filter_writer_ctx = ctx->output.pos_writer[c];
+		z = mi->pz;
+		zl = mi->pzl;
+	}
+
+
+	/*      , 
+	 *      ,
+	 *     ޣ.
+	 */
+	if ( zl ) {
+		filter_writer_p->write_tile_lines( filter_writer_ctx, zl );
+	}
+	if ( z ) {
+		filter_writer_p->write_spaces( filter_writer_ctx, z );
+	}
+
+	/*     . */
+	filter_writer_p->write_tile( filter_writer_ctx,
+								 (unsigned char) tile_index,
+								 tile_area );
+				
+	/*    ޣ 
+	 * . */
+	if (neg) {
+		mi->nz = 0;
+		mi->nzl = 0;
+		mi->pz++;
+	} else {
+		mi->pz = 0;
+		mi->pzl = 0;
+		mi->nz++;
+	}
+}
+
+/**
+ * ޣ #count   :  
+ * ޣ .
+ */
+static inline void
+put_spaces( struct engrave_ctx *ctx, struct maketiles_info *mi,
+			unsigned int count )
+{
+	mi->nz += count;
+	mi->pz += count;
+	ctx->stats.zerotile += count;
+}
+
+/**
+ *   ,     
+ *           #c.
+ *        #ctx, 
+ *       .   
+ * (  )      
+ * .   ޣ     
+ *    ,    .
+ */
+static void
+maketiles( struct engrave_ctx *ctx, int c )
+{
+	/*    . */
+	const struct engrave_params *params = &ctx->params;
+	struct maketiles_info *mi = &ctx->mi[c];
+	unsigned char **buf = ctx->buf;
+	unsigned char *outbuf = ctx->outbuf;
+	size_t ss = ctx->ss;
+	size_t len = params->image.width;
+
+	/*  ޣ. */
+	t_window window;
+
+	/* ޣ */
+	int x;
+
+	/*  . */
+	int neg;
+
+	/*  . */
+	int tile_index = 0;
+
+	/*   . */
+	unsigned char tile_area;
+
+	/*      . */
+	struct tile32_sums sums;
+
+	/*     ( ģ). */
+	struct engrave_tile *rec = ctx->rec_tiles[c];
+
+	/*   . */
+	size_t half_len = len/2;
+
+	/*    */
+	size_t c_offs = (c - ctx->c0) * ctx->smp;
+
+	/*  16- ޣ. */
+	int wide = ctx->smp == 2;
+
+	/*    . */
+	int passthrough = params->passthrough[c];
+
+	/*  ޣ      
+	 *  .
+	 */
+	mi->pz = 0;
+	mi->nz = 0;
+	if (params->sweep_count)
+		memset(ctx->sweep_index, 0,
+			   params->sweep_count * sizeof(*ctx->sweep_index));
+
+	/*    ޣ    ޣ 
+	 * ޣ      .
+	 *
+	 *    ,    window 
+	 *  .
+	 */
+	pB1 = buf[0] + 2*ss + c_offs;
+	pA = buf[1] + ss + c_offs;
+	pB = buf[1] + 2*ss + c_offs;
+	pC = buf[1] + 3*ss + c_offs;
+	pD1 = buf[2] + c_offs;
+	pD = buf[2] + ss + c_offs;
+	pE = buf[2] + 2*ss + c_offs;
+	pF = buf[2] + 3*ss + c_offs;
+	pF1 = buf[2] + 4*ss + c_offs;
+	pG = buf[3] + ss + c_offs;
+	pH = buf[3] + 2*ss + c_offs;
+	pI = buf[3] + 3*ss + c_offs;
+	pH1 = buf[4] + 2*ss + c_offs;
+
+	/*        ޣ 
+	 *  
+	 */
+	outbuf += c_offs;
+
+	/*     ޣ. */
+	for (x = 0; x < len; x++) {
+		/*      
+		 *  ,     
+		 *       .
+		 *     
+		 *  .
+		 */
+		if ( (params->want_half && x > half_len) || passthrough ) {
+			tile_index = 0;
+			if (wide)
+				*(unsigned short *) outbuf =
+					*(unsigned short *) pE ^ params->tile.bg_mask;
+			else
+				*outbuf = E ^ params->tile.bg_mask;
+			if (params->sweep_count)
+				sweep_window(ctx, window, NULL);
+		} else {
+			/*       
+			 *    ,   
+			 *    .    
+			 *     .
+			 */
+			if (wide) {
+				get_window_sums16(window, &sums);
+				get_tile_sums16(&params->tile, window, &sums, &neg,
+								&tile_index, &tile_area,
+								(unsigned short *) outbuf);
+			} else {
+				get_window_sums(window, &sums);
+				get_tile_sums(&params->tile, window, &sums, &neg,
+							  &tile_index, &tile_area, outbuf);
+			}
+			if (params->sweep_count)
+				sweep_window(ctx, window, &sums);
+		}
+
+		/*      . */
+		pA += ss;
+		pB += ss;
+		pC += ss;
+		pD += ss;
+		pE += ss;
+		pF += ss;
+		pG += ss;
+		pH += ss;
+		pI += ss;
+		pB1 += ss;
+		pD1 += ss;
+		pH1 += ss;
+		pF1 += ss;
+		outbuf += ss;
+
+		/*  ,     ,
+		 *    . 
+		 *     
+		 * ޣ .
+		 */
+		if (tile_index) {
+			put_tile(ctx, c, mi, tile_index, tile_area, neg);
+			if (rec) {
+				rec->x = x;
+				rec->index = (unsigned char) tile_index;
+				rec->area = tile_area;
+				rec->neg = (unsigned char) neg;
+				rec++;
+			}
+		} else {
+			put_spaces(ctx, mi, 1);
+		}
+	}
+
+	/*    . */
+	if (rec)
+		ctx->rec_count[c] = rec - ctx->rec_tiles[c];
+
+	/*  ޣ  () . */
+	mi->nzl++;
+	mi->pzl++;
+}
+
+/**
+ *       #row
+ *    #c:     , 
+ *  ,   ޣ .
+ */
+static void
+replay_tiles( struct engrave_ctx *ctx, int c, const struct engrave_row *row )
+{
+	struct maketiles_info *mi = &ctx->mi[c];
+	const struct engrave_tile *t = row->tiles[c];
+	const struct engrave_tile *end = t + row->count[c];
+	unsigned long x = 0;
+
+	mi->pz = 0;
+	mi->nz = 0;
+
+	for ( ; t < end; t++ ) {
+		if ( t->x > x )
+			put_spaces( ctx, mi, t->x - x );
+		put_tile( ctx, c, mi, t->index, t->area, t->neg );
+		x = t->x + 1;
+	}
+	if ( ctx->params.image.width > x )
+		put_spaces( ctx, mi, ctx->params.image.width - x );
+
+	mi->nzl++;
+	mi->pzl++;
+}
+
+/**
+ *   ,    
+ * ,        
+ *   .    
+ *    ,    .
+ */
+static void
+process_line( struct engrave_ctx *ctx )
+{
+	struct engrave_output *out = &ctx->output;
+	struct engrave_row row;
+	unsigned long y = ctx->y_out++;
+	unsigned long z0;
+	int c;
+
+	if ( out->replay_row && out->replay_row(out->arg, y, &row) ) {
+		for (c = ctx->c0; c <= ctx->cN; c++)
+			replay_tiles(ctx, c, &row);
+		memcpy(ctx->outbuf, row.toneline,
+			   ctx->ss * ctx->params.image.width);
+	} else {
+		for (c = ctx->c0; c <= ctx->cN; c++) {
+			if (out->row_begin)
+				out->row_begin(out->arg, c);
+			z0 = ctx->stats.zerotile;
+			maketiles(ctx, c);
+			if (out->row_end)
+				out->row_end(out->arg, c, ctx->stats.zerotile - z0);
+		}
+		if ( out->record_row ) {
+			memset(&row, 0, sizeof(row));
+			row.toneline = ctx->outbuf;
+			for (c = ctx->c0; c <= ctx->cN; c++) {
+				row.tiles[c] = ctx->rec_tiles[c];
+				row.count[c] = ctx->rec_count[c];
+			}
+			out->record_row(out->arg, y, &row);
+		}
+	}
+
+	if (out->write_toneline) {
+		/*        
+		 *   (. tile32_params.bg_mask)  
+		 * 8-: 16- ޣ   . */
+		if (ctx->smp == 2)
+			smp16to8(ctx->outbuf, ctx->outbuf,
+					 ctx->ss / 2 * ctx->params.image.width);
+		out->write_toneline(out->arg, ctx->outbuf, ctx->ss / ctx->smp,
+							ctx->params.image.width);
+	}
+}
+
+/*       ,  
+ *   5-  (4)    
+ *  (0). */
+static void
+rotate_lines( struct engrave_ctx *ctx )
+{
+	unsigned char *tmpbuf = ctx->buf[0];
+
+	ctx->buf[0] = ctx->buf[1];
+	ctx->buf[1] = ctx->buf[2];
+	ctx->buf[2] = ctx->buf[3];
+	ctx->buf[3] = ctx->buf[4];
+	ctx->buf[4] = tmpbuf;
+}
+
+/*    #line   #dst,  
+ * 3- ޣ,    ޣ  
+ *  . */
+static void
+load_line( struct engrave_ctx *ctx, unsigned char *dst,
+		   const unsigned char *line )
+{
+	size_t width = ctx->params.image.width;
+
+	/*  ģ   :   
+	 *    . */
+	if (ctx->params.image.miniswhite ^ ctx->params.image.negative_input)
+		invertsmp_copy(dst + 2*ctx->ss, line, ctx->ss, width);
+	else
+		memcpy(dst + 2*ctx->ss, line, ctx->ss * width);
+	edgecpy((char *) dst, width, ctx->ss);
+}
+
+/*    (3) :  3- (2)   (1)
+ *      . */
+static void
+prime_lines( struct engrave_ctx *ctx )
+{
+	size_t linesize = ctx->ss * (ctx->params.image.width + 4);
+
+	memcpy(ctx->buf[2], ctx->buf[3], linesize);
+	memcpy(ctx->buf[1], ctx->buf[2], linesize);
+}
+
+/**
+ *       #outformat 
+ * #NULL,   .
+ */
+struct filter_writer *
+get_filter_writer( filter_outformat_t outformat )
+{
+	switch ( outformat ) {
+	case FILTER_EPS_FMT:
+		return &ascii85_filter_writer;
+	case FILTER_TIFF_FMT:
+		return &tiffout_filter_writer;
+	case FILTER_PDF_FMT:
+	case FILTER_PDF_G4_FMT:
+	case FILTER_PDF_GLYPHS_FMT:
+		return &pdfout_filter_writer;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ *  #params   .
+ */
+void
+engrave_init_params( struct engrave_params *params )
+{
+	memset( params, 0, sizeof(*params) );
+	params->image.bits = 8;
+	params->image.outformat = FILTER_EPS_FMT;
+	init_tile32_params( &params->tile );
+}
+
+static void destroy_ctx( struct engrave_ctx *ctx );
+
+/**
+ *     #params   #output.
+ */
+struct engrave_ctx *
+engrave_open( const struct engrave_params *params,
+			  const struct engrave_output *output )
+{
+	struct engrave_ctx *ctx;
+	int c, i;
+
+	if ( !params->image.width || !params->image.height ||
+		 !output->writer )
+		return NULL;
+
+	ctx = (struct engrave_ctx *) calloc( 1, sizeof(struct engrave_ctx) );
+	if ( !ctx ) return NULL;
+
+	ctx->params = *params;
+	ctx->output = *output;
+
+	/*        
+	 *  . */
+	ctx->params.tile.bg_mask = params->image.miniswhite ? 0xFFFF : 0;
+
+	/*   ޣ  ޣ   
+	 *    . */
+	if ( params->image.is_cmyk ) {
+		ctx->ss = 4;
+		ctx->c0 = 0;
+		ctx->cN = 3;
+	} else {
+		ctx->ss = 1;
+		ctx->c0 = 3;
+		ctx->cN = 3;
+	}
+	ctx->smp = params->image.bits == 16 ? 2 : 1;
+	ctx->ss *= ctx->smp;
+
+	for ( c = ctx->c0; c <= ctx->cN; c++ ) {
+		if ( !output->pos_writer[c] || !output->neg_writer[c] ) {
+			destroy_ctx( ctx );
+			return NULL;
+		}
+	}
+
+	/*  2 ޣ     
+	 *     . */
+	for ( i = 0; i < 5; i++ ) {
+		ctx->buf[i] = calloc( ctx->ss, params->image.width + 4 );
+		if ( !ctx->buf[i] ) {
+			destroy_ctx( ctx );
+			return NULL;
+		}
+	}
+	ctx->outbuf = calloc( ctx->ss, params->image.width );
+	if ( !ctx->outbuf ) {
+		destroy_ctx( ctx );
+		return NULL;
+	}
+
+	for ( c = ctx->c0; c <= ctx->cN; c++ )
+		init_maketiles_info( &ctx->mi[c] );
+
+	if ( output->record_row ) {
+		for ( c = ctx->c0; c <= ctx->cN; c++ ) {
+			ctx->rec_tiles[c] = calloc( params->image.width,
+										sizeof(struct engrave_tile) );
+			if ( !ctx->rec_tiles[c] ) {
+				destroy_ctx( ctx );
+				return NULL;
+			}
+		}
+	}
+
+	if ( params->sweep_count ) {
+		ctx->sweep = calloc( params->sweep_count,
+							 sizeof(struct tile32_params) );
+		ctx->sweep_stats = calloc( params->sweep_count,
+								   sizeof(struct engrave_stats) );
+		ctx->sweep_index = calloc( params->sweep_count, sizeof(int) );
+		if ( !ctx->sweep || !ctx->sweep_stats || !ctx->sweep_index ) {
+			destroy_ctx( ctx );
+			return NULL;
+		}
+		memcpy( ctx->sweep, params->sweep,
+				params->sweep_count * sizeof(struct tile32_params) );
+	}
+	ctx->params.sweep = ctx->sweep;
+
+	return ctx;
+}
+
+/**
+ *   #ctx #rows     #lines.
+ */
+int
+engrave_push_lines( struct engrave_ctx *ctx, const void *lines,
+					size_t rows )
+{
+	const unsigned char *line = (const unsigned char *) lines;
+	size_t linesize = ctx->ss * ctx->params.image.width;
+
+	if ( ctx->y + rows > ctx->params.image.height )
+		return 1;
+
+	for ( ; rows > 0; rows--, line += linesize ) {
+		if ( ctx->y == 0 ) {
+			/*      4-  (3). */
+			load_line( ctx, ctx->buf[3], line );
+		} else if ( ctx->y == 1 ) {
+			/*  --   5-  (4). */
+			load_line( ctx, ctx->buf[4], line );
+			prime_lines( ctx );
+		} else {
+			/*   3- ,    
+			 *  ,    . */
+			rotate_lines( ctx );
+			load_line( ctx, ctx->buf[4], line );
+			process_line( ctx );
+		}
+		ctx->y++;
+	}
+
+	return 0;
+}
+
+/**
+ *   #ctx   .
+ */
+int
+engrave_close( struct engrave_ctx *ctx, struct engrave_stats *stats )
+{
+	struct filter_writer *writer = ctx->output.writer;
+	int ret = 0;
+	int c, i;
+
+	if ( ctx->y < ctx->params.image.height ) {
+		ret = 1;
+	} else {
+		/*       ,  
+		 * . */
+		if ( ctx->y == 1 ) {
+			memcpy( ctx->buf[4], ctx->buf[3],
+					ctx->ss * (ctx->params.image.width + 4) );
+			prime_lines( ctx );
+		}
+
+		/*       :
+		 *       
+		 * . */
+		for ( i = 0; i < (ctx->y > 1 ? 2 : 1); i++ ) {
+			rotate_lines( ctx );
+			memcpy( ctx->buf[4], ctx->buf[3],
+					ctx->ss * (ctx->params.image.width + 4) );
+			process_line( ctx );
+		}
+
+		/*      . */
+		for ( c = ctx->c0; c <= ctx->cN; c++ ) {
+			if ( ctx->mi[c].pzl )
+				writer->write_tile_lines( ctx->output.pos_writer[c],
+										  ctx->mi[c].pzl );
+			if ( ctx->mi[c].nzl )
+				writer->write_tile_lines( ctx->output.neg_writer[c],
+										  ctx->mi[c].nzl );
+		}
+	}
+
+	if ( stats ) {
+		stats[0] = ctx->stats;
+		if ( ctx->params.sweep_count )
+			memcpy( stats + 1, ctx->sweep_stats,
+					ctx->params.sweep_count *
+					sizeof(struct engrave_stats) );
+	}
+
+	destroy_ctx( ctx );
+	return ret;
+}
+
+/*  ,  . */
+static void
+destroy_ctx( struct engrave_ctx *ctx )
+{
+	int i;
+
+	for ( i = 0; i < 5; i++ )
+		free( ctx->buf[i] );
+	free( ctx->outbuf );
+	free( ctx->sweep );
+	free( ctx->sweep_stats );
+	free( ctx->sweep_index );
+	for ( i = 0; i < 4; i++ )
+		free( ctx->rec_tiles[i] );
+	free( ctx );
+}
+
+
+/*  . */
+
+/**
+ *    .
+ */
+struct engrave_ct_ctx {
+	struct engrave_ct_params params;	/*  . */
+	struct engrave_ct_output output;	/*  . */
+	struct filter_params layer;			/*  . */
+
+	size_t ss;				/*  8- ޣ  . */
+	int c0, cN;				/*     . */
+	unsigned long ds;		/*   . */
+
+	/*  8- ޣ ( 16- ). */
+	unsigned char *buf;
+
+	/*  ޣ  ds x ds    . */
+	unsigned int *acc;
+	unsigned char *dsbuf;
+
+	unsigned long y;		/*   . */
+};
+
+/**
+ *  #layer      #params.
+ */
+void
+engrave_ct_layer_params( const struct engrave_ct_params *params,
+						 struct filter_params *layer )
+{
+	const struct filter_params *image = &params->image;
+	unsigned long ds = params->downsample > 1 ? params->downsample : 1;
+
+	*layer = *image;
+
+	/*   ޣ   ,  
+	 *    :   ţ 
+	 *  (Decode, Photometric),    
+	 * . ޣ   8-. */
+	if ( image->negative_input )
+		layer->miniswhite = !image->miniswhite;
+	layer->negative_input = 0;
+	layer->bits = 8;
+
+	/*   .   , 
+	 *     . */
+	if ( ds > 1 ) {
+		layer->width = (image->width + ds - 1) / ds;
+		layer->height = (image->height + ds - 1) / ds;
+		layer->hres = image->hres * layer->width / image->width;
+		layer->vres = image->vres * layer->height / image->height;
+	}
+}
+
+static void destroy_ct_ctx( struct engrave_ct_ctx *ctx );
+
+/**
+ *       #params  
+ * #output.
+ */
+struct engrave_ct_ctx *
+engrave_ct_open( const struct engrave_ct_params *params,
+				 const struct engrave_ct_output *output )
+{
+	struct engrave_ct_ctx *ctx;
+	int c;
+
+	if ( !params->image.width || !params->image.height ||
+		 !output->writer )
+		return NULL;
+
+	ctx = (struct engrave_ct_ctx *) calloc( 1, sizeof(*ctx) );
+	if ( !ctx ) return NULL;
+
+	ctx->params = *params;
+	ctx->output = *output;
+	engrave_ct_layer_params( params, &ctx->layer );
+	ctx->ds = params->downsample > 1 ? params->downsample : 1;
+
+	if ( params->image.is_cmyk ) {
+		ctx->ss = 4;
+		ctx->c0 = 0;
+		ctx->cN = 3;
+	} else {
+		ctx->ss = 1;
+		ctx->c0 = 3;
+		ctx->cN = 3;
+	}
+
+	for ( c = ctx->c0; c <= ctx->cN; c++ ) {
+		if ( !output->tone_writer[c] ) {
+			destroy_ct_ctx( ctx );
+			return NULL;
+		}
+	}
+
+	if ( params->image.bits == 16 ) {
+		ctx->buf = calloc( ctx->ss, params->image.width );
+		if ( !ctx->buf ) {
+			destroy_ct_ctx( ctx );
+			return NULL;
+		}
+	}
+
+	if ( ctx->ds > 1 ) {
+		ctx->acc = calloc( ctx->ss * ctx->layer.width, sizeof(*ctx->acc) );
+		ctx->dsbuf = calloc( ctx->ss, ctx->layer.width );
+		if ( !ctx->acc || !ctx->dsbuf ) {
+			destroy_ct_ctx( ctx );
+			return NULL;
+		}
+	}
+
+	return ctx;
+}
+
+/**
+ *     #line  #count ޣ 
+ *   .
+ */
+static void
+put_ct_line( struct engrave_ct_ctx *ctx, const unsigned char *line,
+			 unsigned long count )
+{
+	struct filter_writer *writer = ctx->output.writer;
+	int c;
+
+	for ( c = ctx->c0; c <= ctx->cN; c++ )
+		writer->write_toneline( ctx->output.tone_writer[c],
+								(const char *) line + c - ctx->c0,
+								ctx->ss, count );
+}
+
+/**
+ *     #ctx #rows   
+ *  #lines.
+ */
+int
+engrave_ct_push_lines( struct engrave_ct_ctx *ctx, const void *lines,
+					   size_t rows )
+{
+	const struct filter_params *image = &ctx->params.image;
+	const unsigned char *line = (const unsigned char *) lines;
+	size_t linesize = ctx->ss * image->width * (image->bits == 16 ? 2 : 1);
+	unsigned long ds = ctx->ds;
+	size_t ss = ctx->ss;
+	unsigned long x, n, cols, nrows;
+
+	if ( ctx->y + rows > image->height )
+		return 1;
+
+	for ( ; rows > 0; rows--, line += linesize, ctx->y++ ) {
+		const unsigned char *row = line;
+
+		/* 16- ޣ   8-. */
+		if ( ctx->buf ) {
+			smp16to8( ctx->buf, line, ss * image->width );
+			row = ctx->buf;
+		}
+
+		if ( ds == 1 ) {
+			put_ct_line( ctx, row, image->width );
+			continue;
+		}
+
+		/*       
+		 * ;      ds 
+		 *     .   
+		 *      
+		 * ޣ. */
+		for ( x = 0; x < image->width * ss; x++ )
+			ctx->acc[x / (ds * ss) * ss + x % ss] += row[x];
+		if ( (ctx->y + 1) % ds != 0 && ctx->y + 1 < image->height )
+			continue;
+		nrows = ctx->y % ds + 1;
+		for ( x = 0; x < ctx->layer.width * ss; x++ ) {
+			cols = image->width - x / ss * ds;
+			if ( cols > ds )
+				cols = ds;
+			n = cols * nrows;
+			ctx->dsbuf[x] = (ctx->acc[x] + n / 2) / n;
+			ctx->acc[x] = 0;
+		}
+		put_ct_line( ctx, ctx->dsbuf, ctx->layer.width );
+	}
+
+	return 0;
+}
+
+/**
+ *     #ctx   .
+ */
+int
+engrave_ct_close( struct engrave_ct_ctx *ctx )
+{
+	int ret = ctx->y < ctx->params.image.height;
+
+	destroy_ct_ctx( ctx );
+	return ret;
+}
+
+/*  ,    . */
+static void
+destroy_ct_ctx( struct engrave_ct_ctx *ctx )
+{
+	free( ctx->buf );
+	free( ctx->acc );
+	free( ctx->dsbuf );
+	free( ctx );
+}
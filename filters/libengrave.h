@@ -0,0 +1,376 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __LIBENGRAVE_H
+#define __LIBENGRAVE_H
+
+/*   :   
+ *  (  tile32)    
+ * ( ct)   .
+ *
+ * ӣ      #engrave_ctx
+ * (#engrave_ct_ctx),     
+ * ,       
+ *   (    ).  
+ *     ,     --
+ *  ϣ,     , 
+ *  ,      -- 
+ *  .
+ *
+ *        libtiff  zlib
+ * (-lengrave -ltiff -lz -lm -lpthread). */
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/*   ϣ. */
+typedef enum { FILTER_EPS_FMT, FILTER_TIFF_FMT, FILTER_PDF_FMT,
+			   FILTER_PDF_G4_FMT, FILTER_PDF_GLYPHS_FMT } filter_outformat_t;
+
+/**
+ *     ,  
+ *   .     
+ * ,       
+ *   .
+ */
+struct filter_params {
+	unsigned long width;	/*  ; */
+	unsigned long height;	/*  ; */
+	float hres;				/*   ; */
+	float vres;				/*   ; */
+	int is_cmyk;			/*  4- ; */
+	int miniswhite;			/*   ; */
+	int bits;				/*   ޣ (8  16); */
+	int negative_input;		/*  ޣ  ,
+							 *  #miniswhite; */
+	filter_outformat_t outformat;	/*  . */
+};
+
+/**
+ *     .   
+ *  ,   ;   
+ *           
+ * TIFF.
+ */
+struct filter_writer {
+	/**
+	 *      
+	 *    #params   #out.
+	 *   #mask   ().
+	 *    ,   
+	 *   .
+	 */
+	void * (*open_tilemap)      ( const struct filter_params *params,
+								  FILE *out, int mask );
+	
+	/**
+	 *      
+	 *   #params   #out.   
+	 * ,      .
+	 */
+	void * (*open_tonemap)      ( const struct filter_params *params,
+								  FILE *out );
+
+	/**
+	 *  #zl  .  #zl > 1,  
+     *   .
+	 */
+	void   (*write_tile_lines) ( void *ctx, unsigned int zl );
+
+	/**
+	 *  #z .
+	 */
+	void   (*write_spaces)      ( void *ctx, unsigned int z );
+
+	/**
+	 *     #tile_index  
+	 *  #tile_area.
+	 */
+	void   (*write_tile)        ( void *ctx,
+								  unsigned char tile_index,
+								  unsigned char tile_area );
+
+	/**
+	 *    .   #count ޣ
+	 *  #ss     #buf.
+	 */
+	void  (*write_toneline)     ( void *ctx, const char *buf,
+								  size_t ss, size_t count );
+
+	/**
+	 *  ,     
+	 *  .   .
+	 */
+	void   (*close)             ( void *ctx );
+};
+
+/**
+ *       #outformat 
+ * #NULL,   .
+ */
+struct filter_writer *get_filter_writer( filter_outformat_t outformat );
+
+/*    . */
+#define TILE_COUNT 20
+
+/*   .     ,
+ *        
+ * . */
+struct tile32_params {
+	/*      
+	 * . */
+	int outtest;
+
+	/*    ޣ (0 - 255). */
+	unsigned char FThr;
+
+	/*     ޣ (0 - 3*255). */
+	double FThr2;
+
+	/*      ޣ. */
+	double FDcor;
+
+	/*   . */
+	unsigned char minarea;
+
+	/*     .  ģ 
+	 *  ;     
+	 *   0   (  ) 
+	 *  0xFFFF,       .
+	 *    . */
+	unsigned short bg_mask;
+};
+
+/**
+ *  .
+ */
+struct engrave_params {
+	struct filter_params image;	/*  . */
+	struct tile32_params tile;	/*   . */
+	int want_half;				/*    . */
+	int passthrough[4];			/*  C, M, Y, K,  
+								 * . */
+
+	/*    ,     
+	 *     (   
+	 * ).     . */
+	const struct tile32_params *sweep;
+	size_t sweep_count;
+};
+
+/**
+ *  : , ,    .
+ */
+struct engrave_tile {
+	unsigned long x;
+	unsigned char index;
+	unsigned char area;
+	unsigned char neg;
+};
+
+/**
+ *    ,    
+ *     :    
+ * (  #miniswhite   )    
+ * C, M, Y, K    .
+ */
+struct engrave_row {
+	const unsigned char *toneline;
+	const struct engrave_tile *tiles[4];
+	size_t count[4];
+};
+
+/**
+ *   .
+ */
+struct engrave_output {
+	/*  ϣ   . */
+	struct filter_writer *writer;
+
+	/*    ()   ()
+	 *    C, M, Y, K.  
+	 *    K (3).    
+	 *  . */
+	void *pos_writer[4];
+	void *neg_writer[4];
+
+	/*       #count ޣ 
+	 * #ss   ,  #miniswhite (  
+	 * ,  #negative_input,  ). 
+	 *  8-: 16-  . 
+	 *  #NULL. */
+	void (*write_toneline)( void *arg, const unsigned char *buf,
+							size_t ss, size_t count );
+
+	/*        #c (, 
+	 * ). #flat --   ޣ
+	 *  .   #NULL. */
+	void (*row_begin)( void *arg, int c );
+	void (*row_end)( void *arg, int c, unsigned long flat );
+
+	/*     #y   . 
+	 * #row     .   #NULL. */
+	void (*record_row)( void *arg, unsigned long y,
+						const struct engrave_row *row );
+
+	/*     #y.   
+	 * #row   -0,     , 
+	 *        #row: ޣ 
+	 *     ,   . 
+	 *  #NULL. */
+	int (*replay_row)( void *arg, unsigned long y,
+					   struct engrave_row *row );
+
+	/*   . */
+	void *arg;
+};
+
+/**
+ *   .
+ */
+struct engrave_stats {
+	unsigned long phist[TILE_COUNT];	/*  . */
+	unsigned long nhist[TILE_COUNT];	/*  . */
+	unsigned long zerotile;				/*  . */
+};
+
+/**
+ *  .
+ */
+struct engrave_ctx;
+
+/**
+ *  #params   .  
+ *       .
+ */
+void engrave_init_params( struct engrave_params *params );
+
+/**
+ *     #params;  
+ *  #output.      #NULL
+ *   .
+ */
+struct engrave_ctx *engrave_open( const struct engrave_params *params,
+								  const struct engrave_output *output );
+
+/**
+ *   #rows     #lines. 
+ *      ޣ  1 (4  CMYK)  ,
+ *      16- ޣ,  2
+ * (8)     .
+ *  0     -0,    
+ * .
+ */
+int engrave_push_lines( struct engrave_ctx *ctx, const void *lines,
+						size_t rows );
+
+/**
+ *    ,  
+ *       
+ * .   .  #stats  #NULL, 
+ *   ,    --   
+ *    ( 1 + sweep_count ).
+ *  0     -0,     
+ * .
+ */
+int engrave_close( struct engrave_ctx *ctx, struct engrave_stats *stats );
+
+/*   ( ct). */
+
+/**
+ *    .
+ */
+struct engrave_ct_params {
+	struct filter_params image;	/*  . */
+	unsigned long downsample;	/*   downsample x downsample
+								 * ޣ    ޣ
+								 *  (0  1 --  ). */
+};
+
+/**
+ *   .
+ */
+struct engrave_ct_output {
+	/*  . */
+	struct filter_writer *writer;
+
+	/*     C, M, Y, K (
+	 *  --   K).    ,
+	 *   engrave_ct_layer_params();  
+	 *    . */
+	void *tone_writer[4];
+};
+
+/**
+ *    .
+ */
+struct engrave_ct_ctx;
+
+/**
+ *  #layer      #params:
+ *     ޣ    
+ * ޣ (    ).
+ */
+void engrave_ct_layer_params( const struct engrave_ct_params *params,
+							  struct filter_params *layer );
+
+/**
+ *       #params; 
+ *   #output.     
+ * #NULL   .
+ */
+struct engrave_ct_ctx *
+engrave_ct_open( const struct engrave_ct_params *params,
+				 const struct engrave_ct_output *output );
+
+/**
+ *   #rows     #lines   
+ * ,   engrave_push_lines().  0   
+ *  -0,     .
+ */
+int engrave_ct_push_lines( struct engrave_ct_ctx *ctx, const void *lines,
+						   size_t rows );
+
+/**
+ *   .   .
+ *  0     -0,     
+ * .
+ */
+int engrave_ct_close( struct engrave_ct_ctx *ctx );
+
+#endif /* __LIBENGRAVE_H */
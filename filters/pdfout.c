@@ -0,0 +1,744 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*    ϣ       PDF
+ *  .
+ *
+ *      JBIG2 ( 
+ *        ,  
+ *       )  
+ * CCITT Group 4,   --  Deflate.
+ *
+ *    (pdf-glyphs)   
+ *    Deflate   :
+ *     TJ  Type 3 /T1 - /T20
+ * (    ,   --  )  ,
+ *   .    .      
+ *  " ",   "data",  
+ *    ,    
+ *      PDF. */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "pdfout.h"
+#include "g4enc.h"
+#include "jbig2enc.h"
+#include "weightfunc.h"
+#include <zlib.h>
+
+void * pdfout_open_bitmap( const struct filter_params *params,
+						   FILE *out, int mask );
+void * pdfout_open_tonemap( const struct filter_params *params,
+							FILE *out );
+void pdfout_write_tile_lines( void *ctx, unsigned int zl );
+void pdfout_write_spaces( void *ctx, unsigned int z );
+void pdfout_write_tile( void *ctx, unsigned char tile_index,
+						unsigned char tile_area );
+void pdfout_write_toneline( void *ctx, const char *buf,
+							size_t ss, size_t count );
+void pdfout_close( void *ctx );
+
+/**
+ *       PDF.
+ */
+struct filter_writer pdfout_filter_writer = {
+	.open_tilemap      = pdfout_open_bitmap,
+	.open_tonemap      = pdfout_open_tonemap,
+	.write_tile_lines  = pdfout_write_tile_lines,
+	.write_spaces      = pdfout_write_spaces,
+	.write_tile        = pdfout_write_tile,
+	.write_toneline    = pdfout_write_toneline,
+	.close             = pdfout_close
+};
+
+/*     Deflate. */
+#define ZBUFSIZE 65536
+
+/*     . */
+#define TILE_AREAS 256
+
+/*      . */
+#define NO_SYMBOL 0xffff
+
+/**
+ *      .
+ */
+struct pdfout_text {
+	int font;				/*   ( )  0. */
+	int row_open;			/*    . */
+	int in_array;			/*   TJ. */
+	int in_string;			/*     TJ. */
+	unsigned long row;		/*     . */
+	long line_x;			/*    . */
+	long line_y;
+	unsigned long next_x;	/*    . */
+	size_t len;				/*     #buf. */
+	char buf[4096];			/*   . */
+};
+
+/**
+ *        .
+ */
+struct pdfout {
+	FILE *file;
+	unsigned char *buf;
+	size_t buflinesize;
+	size_t bufsize;
+	unsigned long y;		/*   . */
+	unsigned long rows;		/*    . */
+	int written;
+	unsigned long tile_x;
+	int is_bitmap;
+	struct g4enc *g4;		/*   . */
+	struct jbig2enc *jbig2;	/*  JBIG2 ( #g4). */
+	unsigned short *symbols;	/*      . */
+	unsigned long tile_y;	/*     (JBIG2, ). */
+	int glyphs;				/*   . */
+	struct pdfout_text text;	/*   . */
+	z_stream z;				/*   . */
+	unsigned char *zbuf;
+	struct filter_params params;	/*  . */
+};
+
+static struct pdfout *new_pdfout( const struct filter_params *params,
+								  FILE *out, int bitmap );
+static void destroy_pdfout( struct pdfout *a );
+static void pdfout_flush( struct pdfout *a );
+static void pdfout_put_line( struct pdfout *a, const unsigned char *line );
+static int pdfout_open_jbig2( struct pdfout *a );
+static int pdfout_open_deflate( struct pdfout *a );
+static void pdfout_deflate( struct pdfout *a, const void *data,
+							size_t len, int flush );
+static void pdfout_put_glyph( struct pdfout *a, unsigned char tile_index,
+							  unsigned char tile_area );
+static void pdfout_text_end_array( struct pdfout *a );
+static void pdfout_text_put( struct pdfout *a, const char *data,
+							 size_t len );
+
+/**
+ *   #pdfout    
+ *     #params   #out. 
+ * #mask   ()   .
+ *    ,   
+ *   .
+ */
+void *
+pdfout_open_bitmap( const struct filter_params *params,
+					FILE *out, int mask )
+{
+	struct pdfout *a;
+	unsigned long width = params->width;
+
+	weightfuncs_init();
+	a = new_pdfout( params, out, 1 );
+	if ( !a ) return NULL;
+
+	if ( params->outformat == FILTER_PDF_GLYPHS_FMT ) {
+		fprintf( a->file, "pdfimage 1\n"
+				 "kind %s\n"
+				 "width %lu\n"
+				 "height %lu\n"
+				 "bpc 1\n"
+				 "filter FlateDecode\n"
+				 "content glyphs\n"
+				 "columns %lu\n"
+				 "rows %lu\n"
+				 "data\n",
+				 mask ? "mask" : "stroke",
+				 width * TILEWIDTH, a->rows, width, params->height );
+	} else {
+		fprintf( a->file, "pdfimage 1\n"
+				 "kind %s\n"
+				 "width %lu\n"
+				 "height %lu\n"
+				 "bpc 1\n"
+				 "filter %s\n"
+				 "data\n",
+				 mask ? "mask" : "stroke",
+				 width * TILEWIDTH, a->rows,
+				 params->outformat == FILTER_PDF_G4_FMT ?
+				 "CCITTFaxDecode" : "JBIG2Decode" );
+	}
+
+	if ( params->outformat == FILTER_PDF_GLYPHS_FMT ) {
+		a->glyphs = 1;
+		if ( pdfout_open_deflate( a ) ) {
+			destroy_pdfout( a );
+			return NULL;
+		}
+		pdfout_text_put( a, "BT\n", 3 );
+	} else if ( params->outformat == FILTER_PDF_G4_FMT ) {
+		a->g4 = g4enc_open( a->file, width * TILEWIDTH );
+		if ( !a->g4 ) {
+			fprintf( stderr, "Unable to create the G4 encoder\n" );
+			destroy_pdfout( a );
+			return NULL;
+		}
+	} else if ( pdfout_open_jbig2( a ) ) {
+		fprintf( stderr, "Unable to create the JBIG2 encoder\n" );
+		destroy_pdfout( a );
+		return NULL;
+	}
+
+	return a;
+}
+
+/**
+ *   #pdfout   
+ *    #params   #out. 
+ *   ,     
+ * .
+ */
+void *
+pdfout_open_tonemap( const struct filter_params *params,
+					 FILE *out )
+{
+	struct pdfout *a;
+
+	a = new_pdfout( params, out, 0 );
+	if ( !a ) return NULL;
+
+	fprintf( a->file, "pdfimage 1\n"
+			 "kind tone\n"
+			 "width %lu\n"
+			 "height %lu\n"
+			 "bpc 8\n"
+			 "filter FlateDecode\n"
+			 "miniswhite %d\n"
+			 "data\n",
+			 params->width, a->rows, params->miniswhite );
+
+	if ( pdfout_open_deflate( a ) ) {
+		destroy_pdfout( a );
+		return NULL;
+	}
+
+	return a;
+}
+
+/**
+ *  #zl     #ctx.  #zl > 1,
+ *     .
+ */
+void
+pdfout_write_tile_lines( void *ctx, unsigned int zl )
+{
+	struct pdfout *a = (struct pdfout *) ctx;
+
+	if ( a->jbig2 || a->glyphs ) {
+		/*    . */
+		if ( zl ) {
+			a->tile_y += zl;
+			a->tile_x = 0;
+			a->written = 1;
+		}
+		return;
+	}
+
+	if ( zl ) {
+		if ( !a->written ) {
+			pdfout_flush( a );
+			zl--;
+		}
+		memset( a->buf, 0, a->bufsize );
+
+		while ( zl ) {
+			a->written = 0;
+			pdfout_flush( a );
+			zl--;
+		}
+	}
+}
+
+/**
+ *  #z     #ctx.
+ */
+void
+pdfout_write_spaces( void *ctx, unsigned int z )
+{
+	while ( z ) {
+		pdfout_write_tile( ctx, 0, 0 );
+		z--;
+	}
+}
+
+/**
+ *     #tile_index  
+ *  #tile_area   #ctx.
+ */
+void
+pdfout_write_tile( void *ctx, unsigned char tile_index,
+				   unsigned char tile_area )
+{
+	struct pdfout *a = (struct pdfout *) ctx;
+	unsigned char tilebuf[WEIGHTFUNC_LEN];
+	unsigned long bit;
+	unsigned char *p;
+	int i, j;
+
+	if ( a->tile_x >= a->params.width ) {
+		fprintf( stderr, "Error: tile X too big: %lu\n", a->tile_x );
+		return;
+	}
+
+	if ( a->jbig2 ) {
+		unsigned short sym = tile_index <= WEIGHTFUNCS_COUNT ?
+			a->symbols[tile_index * TILE_AREAS + tile_area] : NO_SYMBOL;
+		if ( sym != NO_SYMBOL && (a->tile_y + 1) * TILEHEIGHT <= a->rows ) {
+			jbig2enc_put_symbol( a->jbig2, a->tile_x * TILEWIDTH,
+								 a->tile_y * TILEHEIGHT, sym );
+		}
+		a->tile_x++;
+		a->written = 0;
+		return;
+	}
+
+	if ( a->glyphs ) {
+		if ( tile_area && tile_index && tile_index <= WEIGHTFUNCS_COUNT &&
+			 (a->tile_y + 1) * TILEHEIGHT <= a->rows )
+		{
+			pdfout_put_glyph( a, tile_index, tile_area );
+		}
+		a->tile_x++;
+		a->written = 0;
+		return;
+	}
+
+	weight_func_apply( tilebuf, tile_index, tile_area );
+
+	for ( j = 0; j < TILEHEIGHT; j++ ) {
+		p = a->buf + a->buflinesize * j;
+		for ( i = 0; i < TILEWIDTH; i++ ) {
+			bit = a->tile_x * TILEWIDTH + i;
+			if ( tilebuf[j * TILEWIDTH + i] ) {
+				p[bit >> 3] |= 0x80 >> (bit & 7);
+			} else {
+				p[bit >> 3] &= ~(0x80 >> (bit & 7));
+			}
+		}
+	}
+
+	a->tile_x++;
+	a->written = 0;
+}
+
+/**
+ *       #ctx.  
+ * #count ޣ   #ss     #buf: 
+ * ң   ޣ  .
+ */
+void
+pdfout_write_toneline( void *ctx, const char *buf, size_t ss,
+					   size_t count )
+{
+	struct pdfout *a = (struct pdfout *) ctx;
+	size_t x;
+
+	if ( ss == 0 || count != a->params.width ) {
+		fprintf( stderr, "Error: Wrong tone line: %lu x %lu\n",
+				 (unsigned long) ss, (unsigned long) count );
+		return;
+	}
+	if ( ss == 1 ) {
+		pdfout_put_line( a, (const unsigned char *) buf );
+		return;
+	}
+
+	/* ޣ     . */
+	for ( x = 0; x < count; x++ )
+		a->buf[x] = buf[x * ss];
+	pdfout_put_line( a, a->buf );
+}
+
+/**
+ *   #ctx:   
+ * ,       .
+ */
+void
+pdfout_close( void *ctx )
+{
+	struct pdfout *a = (struct pdfout *) ctx;
+
+	if ( a->jbig2 ) {
+		if ( jbig2enc_close( a->jbig2 ) || fflush( a->file ) ) {
+			fprintf( stderr, "Unable to write the PDF image stream\n" );
+		}
+		destroy_pdfout( a );
+		return;
+	}
+
+	if ( a->glyphs ) {
+		pdfout_text_end_array( a );
+		pdfout_text_put( a, "ET\n", 3 );
+		pdfout_deflate( a, a->text.buf, a->text.len, Z_FINISH );
+		deflateEnd( &a->z );
+	} else {
+		pdfout_flush( a );
+
+		memset( a->buf, 0, a->buflinesize );
+		while ( a->y < a->rows ) {
+			pdfout_put_line( a, a->buf );
+		}
+
+		if ( a->is_bitmap ) {
+			g4enc_close( a->g4 );
+		} else {
+			pdfout_deflate( a, NULL, 0, Z_FINISH );
+			deflateEnd( &a->z );
+		}
+	}
+
+	if ( fflush( a->file ) ) {
+		fprintf( stderr, "Unable to write the PDF image stream\n" );
+	}
+	destroy_pdfout( a );
+}
+
+
+/*  . */
+
+/**
+ *   #pdfout     #out.
+ *    (#bitmap)    
+ * .
+ */
+static struct pdfout *
+new_pdfout( const struct filter_params *params, FILE *out,
+			int bitmap )
+{
+	struct pdfout *a;
+	unsigned long width = params->width;
+	unsigned long height = params->height;
+
+	a = (struct pdfout *) calloc( 1, sizeof(struct pdfout) );
+	if ( a == NULL ) {
+		fprintf( stderr, "Unable to create allocate memory\n" );
+		return NULL;
+	}
+
+	a->params = *params;
+	a->written = 1;
+	a->is_bitmap = bitmap;
+	if ( bitmap ) {
+		a->buflinesize = (width * TILEWIDTH + 7) / 8;
+		a->bufsize = a->buflinesize * TILEHEIGHT;
+		a->rows = height * TILEHEIGHT;
+	} else {
+		a->buflinesize = width;
+		a->bufsize = a->buflinesize;
+		a->rows = height;
+	}
+	a->buf = calloc( a->bufsize, 1 );
+	if ( !a->buf ) {
+		fprintf( stderr, "Unable to create allocate memory\n" );
+		free( a );
+		return NULL;
+	}
+
+	a->file = out;
+	if ( a->file == NULL ) {
+		fprintf( stderr, "No output stream for the PDF image\n" );
+		destroy_pdfout( a );
+		return NULL;
+	}
+
+	return a;
+}
+
+/**
+ *  ,   #a.
+ */
+static void
+destroy_pdfout( struct pdfout *a )
+{
+	if ( a ) {
+		free( a->buf );
+		free( a->zbuf );
+		free( a->symbols );
+		free( a );
+	}
+}
+
+/**
+ *   #line .   
+ *  .
+ */
+static void
+pdfout_put_line( struct pdfout *a, const unsigned char *line )
+{
+	if ( a->y >= a->rows ) return;
+
+	if ( a->is_bitmap ) {
+		g4enc_encode_row( a->g4, line );
+	} else {
+		pdfout_deflate( a, line, a->buflinesize, Z_NO_FLUSH );
+	}
+	a->y++;
+}
+
+/**
+ *   Deflate.  0   .
+ */
+static int
+pdfout_open_deflate( struct pdfout *a )
+{
+	memset( &a->z, 0, sizeof(a->z) );
+	a->zbuf = malloc( ZBUFSIZE );
+	if ( !a->zbuf || deflateInit( &a->z, Z_DEFAULT_COMPRESSION ) != Z_OK ) {
+		fprintf( stderr, "Unable to initialize the Deflate encoder\n" );
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ *  #len   #data     . 
+ * #flush == Z_FINISH   .
+ */
+static void
+pdfout_deflate( struct pdfout *a, const void *data, size_t len,
+				int flush )
+{
+	size_t n;
+	int ret;
+
+	a->z.next_in = (unsigned char *) data;
+	a->z.avail_in = len;
+	do {
+		a->z.next_out = a->zbuf;
+		a->z.avail_out = ZBUFSIZE;
+		ret = deflate( &a->z, flush );
+		n = ZBUFSIZE - a->z.avail_out;
+		if ( n ) {
+			fwrite( a->zbuf, 1, n, a->file );
+		}
+	} while ( a->z.avail_in > 0 ||
+			  ( flush == Z_FINISH && ret == Z_OK ) );
+}
+
+/**
+ *      TJ,   .
+ */
+static void
+pdfout_text_end_array( struct pdfout *a )
+{
+	if ( a->text.in_string ) {
+		pdfout_text_put( a, ")", 1 );
+		a->text.in_string = 0;
+	}
+	if ( a->text.in_array ) {
+		pdfout_text_put( a, "] TJ\n", 5 );
+		a->text.in_array = 0;
+	}
+}
+
+/**
+ *    #tile_index   #tile_area  
+ * (#a->tile_x, #a->tile_y).    
+ *  Td,    --  Tf;  
+ *        TJ.
+ */
+static void
+pdfout_put_glyph( struct pdfout *a, unsigned char tile_index,
+				  unsigned char tile_area )
+{
+	struct pdfout_text *t = &a->text;
+	char op[64];
+	int n;
+
+	if ( !t->row_open || t->row != a->tile_y ) {
+		long x = a->tile_x;
+		long y = (long) a->params.height - (long) a->tile_y - 1;
+
+		pdfout_text_end_array( a );
+		n = snprintf( op, sizeof(op), "%ld %ld Td\n",
+					  x - t->line_x, y - t->line_y );
+		pdfout_text_put( a, op, n );
+		t->line_x = x;
+		t->line_y = y;
+		t->next_x = a->tile_x;
+		t->row = a->tile_y;
+		t->row_open = 1;
+	}
+
+	if ( tile_index != t->font ) {
+		pdfout_text_end_array( a );
+		n = snprintf( op, sizeof(op), "/T%d 1 Tf\n", tile_index );
+		pdfout_text_put( a, op, n );
+		t->font = tile_index;
+	}
+
+	if ( !t->in_array ) {
+		pdfout_text_put( a, "[", 1 );
+		t->in_array = 1;
+	}
+
+	if ( a->tile_x > t->next_x ) {
+		if ( t->in_string ) {
+			pdfout_text_put( a, ")", 1 );
+			t->in_string = 0;
+		}
+		n = snprintf( op, sizeof(op), "-%lu",
+					  (a->tile_x - t->next_x) * 1000 );
+		pdfout_text_put( a, op, n );
+	}
+
+	if ( !t->in_string ) {
+		pdfout_text_put( a, "(", 1 );
+		t->in_string = 1;
+	}
+
+	/* ,       . */
+	switch ( tile_area ) {
+	case '(':
+	case ')':
+	case '\\':
+		op[0] = '\\';
+		op[1] = tile_area;
+		n = 2;
+		break;
+	case '\r':
+		n = snprintf( op, sizeof(op), "\\r" );
+		break;
+	case '\n':
+		n = snprintf( op, sizeof(op), "\\n" );
+		break;
+	default:
+		op[0] = tile_area;
+		n = 1;
+	}
+	pdfout_text_put( a, op, n );
+
+	t->next_x = a->tile_x + 1;
+}
+
+/**
+ *  ݣ    .
+ */
+static void
+pdfout_flush( struct pdfout *a )
+{
+	int y;
+
+	if ( !a->written ) {
+		for ( y = 0; y < TILEHEIGHT; y++ ) {
+			pdfout_put_line( a, a->buf + y * a->buflinesize );
+		}
+		a->written = 1;
+		a->tile_x = 0;
+	}
+}
+
+/**
+ *    JBIG2    
+ *      .  0  
+ * .
+ */
+static int
+pdfout_open_jbig2( struct pdfout *a )
+{
+	unsigned char *syms, *sym;
+	unsigned int nsyms = 0, last, k;
+	int idx, area;
+
+	a->symbols = malloc( (WEIGHTFUNCS_COUNT + 1) * TILE_AREAS *
+						 sizeof(*a->symbols) );
+	syms = malloc( WEIGHTFUNCS_COUNT * TILE_AREAS * WEIGHTFUNC_LEN );
+	if ( !a->symbols || !syms ) {
+		fprintf( stderr, "Unable to create allocate memory\n" );
+		free( syms );
+		return 1;
+	}
+
+	for ( area = 0; area < TILE_AREAS; area++ ) {
+		a->symbols[area] = NO_SYMBOL;
+	}
+	for ( idx = 1; idx <= WEIGHTFUNCS_COUNT; idx++ ) {
+		last = NO_SYMBOL;
+		for ( area = 0; area < TILE_AREAS; area++ ) {
+			sym = syms + nsyms * WEIGHTFUNC_LEN;
+			weight_func_apply( sym, idx, area );
+			for ( k = 0; k < WEIGHTFUNC_LEN && !sym[k]; k++ )
+				;
+			if ( k == WEIGHTFUNC_LEN ) {
+				a->symbols[idx * TILE_AREAS + area] = NO_SYMBOL;
+				continue;
+			}
+			/*        . */
+			if ( last != NO_SYMBOL &&
+				 memcmp( sym, syms + last * WEIGHTFUNC_LEN,
+						 WEIGHTFUNC_LEN ) == 0 )
+			{
+				k = last;
+			} else {
+				for ( k = 0; k < nsyms; k++ ) {
+					if ( memcmp( sym, syms + k * WEIGHTFUNC_LEN,
+								 WEIGHTFUNC_LEN ) == 0 )
+						break;
+				}
+				if ( k == nsyms ) nsyms++;
+			}
+			a->symbols[idx * TILE_AREAS + area] = k;
+			last = k;
+		}
+	}
+
+	a->jbig2 = jbig2enc_open( a->file, a->params.width * TILEWIDTH,
+							  a->rows, syms, nsyms, TILEWIDTH, TILEHEIGHT );
+	free( syms );
+
+	return a->jbig2 ? 0 : 1;
+}
+
+/**
+ *  #len   #data     .
+ */
+static void
+pdfout_text_put( struct pdfout *a, const char *data, size_t len )
+{
+	struct pdfout_text *t = &a->text;
+
+	if ( t->len + len > sizeof(t->buf) ) {
+		pdfout_deflate( a, t->buf, t->len, Z_NO_FLUSH );
+		t->len = 0;
+	}
+	memcpy( t->buf + t->len, data, len );
+	t->len += len;
+}
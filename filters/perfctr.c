@@ -0,0 +1,237 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*   ޣ  . */
+
+#include "system.h"
+#include "perfctr.h"
+
+#include <errno.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/*   ޣ. */
+static const char *perfctr_names[PERFCTR_COUNT] = {
+	"cycles", "instructions", "branch-misses",
+	"l1d-read-misses", "llc-misses"
+};
+
+const char *
+perfctr_name( int i )
+{
+	return perfctr_names[i];
+}
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) && defined(__NR_perf_event_open)
+
+/*      ޣ. */
+static const struct {
+	unsigned int type;
+	unsigned long long config;
+} perfctr_events[PERFCTR_COUNT] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+	  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+
+/*   ޣ #i   #group (  ). */
+static int
+open_event( int i, int group )
+{
+	struct perf_event_attr attr;
+
+	memset( &attr, 0, sizeof(attr) );
+	attr.size = sizeof(attr);
+	attr.type = perfctr_events[i].type;
+	attr.config = perfctr_events[i].config;
+	attr.disabled = (group == -1);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP |
+		PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return syscall( __NR_perf_event_open, &attr, 0, -1, group, 0 );
+}
+
+int
+perfctr_open( struct perfctr *p )
+{
+	int i;
+
+	p->leader = -1;
+	p->count = 0;
+	p->err = 0;
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		p->fd[i] = -1;
+		p->idx[i] = -1;
+	}
+
+	/*    ޣ,   ;
+	 *     ,   
+	 *  . */
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		p->fd[i] = open_event( i, p->leader );
+		if ( p->fd[i] == -1 ) {
+			if ( p->leader == -1 && !p->err ) {
+				p->err = errno;
+			}
+			continue;
+		}
+		if ( p->leader == -1 ) {
+			p->leader = p->fd[i];
+		}
+		p->idx[i] = p->count++;
+	}
+
+	if ( p->leader != -1 ) {
+		ioctl( p->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+		ioctl( p->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+	}
+
+	return p->count;
+}
+
+int
+perfctr_read( struct perfctr *p, unsigned long long *vals )
+{
+	unsigned long long data[PERFCTR_COUNT + 3];
+	unsigned long long enabled, running;
+	ssize_t len;
+	int i;
+
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		vals[i] = 0;
+	}
+	if ( p->leader == -1 ) {
+		return -1;
+	}
+
+	/*   :  , ,  
+	 *       ,  
+	 *     ޣ. */
+	len = read( p->leader, data, sizeof(data) );
+	if ( len < (ssize_t) ((p->count + 3) * sizeof(data[0])) ) {
+		return -1;
+	}
+	enabled = data[1];
+	running = data[2];
+
+	/*  ޣ ,   , 
+	 *  ,    
+	 *  . ,     ,
+	 *   . */
+	if ( running == 0 ) {
+		return -1;
+	}
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		if ( p->idx[i] != -1 ) {
+			vals[i] = data[3 + p->idx[i]];
+			if ( running < enabled ) {
+				vals[i] = (unsigned long long)
+					((double) vals[i] * enabled / running);
+			}
+		}
+	}
+
+	return 0;
+}
+
+void
+perfctr_close( struct perfctr *p )
+{
+	int i;
+
+	if ( p->leader != -1 ) {
+		ioctl( p->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+	}
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		if ( p->fd[i] != -1 ) {
+			close( p->fd[i] );
+			p->fd[i] = -1;
+		}
+	}
+	p->leader = -1;
+	p->count = 0;
+}
+
+#else /* !HAVE_LINUX_PERF_EVENT_H */
+
+/*  ޣ   . */
+
+int
+perfctr_open( struct perfctr *p )
+{
+	int i;
+
+	p->leader = -1;
+	p->count = 0;
+	p->err = ENOSYS;
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		p->fd[i] = -1;
+		p->idx[i] = -1;
+	}
+
+	return 0;
+}
+
+int
+perfctr_read( struct perfctr *p, unsigned long long *vals )
+{
+	int i;
+
+	for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+		vals[i] = 0;
+	}
+
+	return -1;
+}
+
+void
+perfctr_close( struct perfctr *p )
+{
+}
+
+#endif /* HAVE_LINUX_PERF_EVENT_H */
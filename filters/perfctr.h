@@ -0,0 +1,94 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __PERFCTR_H
+#define __PERFCTR_H
+
+/*   ޣ  
+ * (perf_event_open)    . */
+
+/*  ޣ. */
+#define PERFCTR_CYCLES 0
+#define PERFCTR_INSTRUCTIONS 1
+#define PERFCTR_BRANCH_MISSES 2
+#define PERFCTR_L1D_MISSES 3
+#define PERFCTR_LLC_MISSES 4
+
+/*   ޣ. */
+#define PERFCTR_COUNT 5
+
+/**
+ *  ޣ  . ޣ,   
+ * ,   -1  #fd.
+ */
+struct perfctr {
+	int leader;					/*   ޣ . */
+	int fd[PERFCTR_COUNT];		/*  ޣ. */
+	int idx[PERFCTR_COUNT];		/*     . */
+	int count;					/*   ޣ. */
+	int err;					/*     ޣ. */
+};
+
+/**
+ *     ޣ #p   
+ * (  ).    ޣ;
+ *  0      #err.
+ */
+int perfctr_open( struct perfctr *p );
+
+/**
+ *    ޣ  #p  
+ *    #vals  #PERFCTR_COUNT . 
+ *  ޣ  0.     ӣ 
+ * (),      ţ
+ * .  0     -1,  
+ *  (     ݣ  ).
+ */
+int perfctr_read( struct perfctr *p, unsigned long long *vals );
+
+/**
+ *     ޣ #p.
+ */
+void perfctr_close( struct perfctr *p );
+
+/**
+ *    ޣ   #i.
+ */
+const char *perfctr_name( int i );
+
+#endif /* __PERFCTR_H */
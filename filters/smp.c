@@ -0,0 +1,72 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*    ޣ . */
+
+#include <sys/types.h>
+#include "smp.h"
+
+/*     ޣ   
+ *    ޣ   .
+ *    ,    
+ *    .    16- ޣ.
+ */
+void invertsmp_copy(void *dst, const void *src, size_t ss, size_t count) {
+
+	const unsigned char *s = src;
+	unsigned char *d = dst;
+	size_t i;
+
+	for (i = 0; i < ss*count; i++)
+		d[i] = s[i] ^ 0xFF;
+
+}
+
+/*    16- ޣ ( 
+ *  )  8-  .   .
+ */
+void smp16to8(void *dst, const void *src, size_t count) {
+
+	const unsigned short *s = src;
+	unsigned char *d = dst;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		d[i] = (s[i] + 128) / 257;
+
+}
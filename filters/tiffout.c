@@ -46,8 +46,10 @@
 #include <tiffio.h>
 #include "weightfunc.h"
 
-void * tiffout_open_bitmap( const char *outfile, int mask );
-void * tiffout_open_tonemap( const char *outfile );
+void * tiffout_open_bitmap( const struct filter_params *params,
+							FILE *out, int mask );
+void * tiffout_open_tonemap( const struct filter_params *params,
+							 FILE *out );
 void tiffout_write_tile_lines( void *ctx, unsigned int zl );
 void tiffout_write_spaces( void *ctx, unsigned int z );
 void tiffout_write_tile( void *ctx, unsigned char tile_index,
@@ -81,21 +83,25 @@ struct tiffout {
 	int written;
 	int tile_x;
 	int is_bitmap;
+	struct filter_params params;
 };
 
 
-static struct tiffout *new_tiffout(const char *outfile, int bitmap);
+static struct tiffout *new_tiffout(const struct filter_params *params,
+								   FILE *out, int bitmap);
 static void write_bitmap_header(struct tiffout *tiffout_p, int mask);
 
 /**
  *   #tiffout    
- *    #outfile.   #mask 
- *  ().    .
+ *     #params   #out.
+ *   #mask   ().
+ *    .
  */
 struct tiffout *
-_tiffout_open_bitmap( const char *outfile, int mask )
+_tiffout_open_bitmap( const struct filter_params *params,
+					  FILE *out, int mask )
 {
-	struct tiffout * ctx = new_tiffout( outfile, 1 );
+	struct tiffout * ctx = new_tiffout( params, out, 1 );
 	if ( ctx ) {		
 		write_bitmap_header( ctx, mask );
 	}
@@ -105,16 +111,17 @@ _tiffout_open_bitmap( const char *outfile, int mask )
 
 /**
  *   #tiffout    
- *    #outfile.   #mask 
+ *    #out.   #mask 
  *  ().  £ 
  * _tiffout_open_bitmap().    ,
  *      .
  */
 void *
-tiffout_open_bitmap( const char *outfile, int mask )
+tiffout_open_bitmap( const struct filter_params *params,
+					 FILE *out, int mask )
 {
 	weightfuncs_init();
-	return (void *) _tiffout_open_bitmap( outfile, mask );
+	return (void *) _tiffout_open_bitmap( params, out, mask );
 }
 
 
@@ -122,12 +129,14 @@ static void write_tonemap_header( struct tiffout *tiffout_p );
 
 /**
  *   #tiffout   
- *    #outfile.    ţ.
+ *    #params   #out. 
+ *   ţ.
  */
 struct tiffout *
-_tiffout_open_tonemap( const char *outfile )
+_tiffout_open_tonemap( const struct filter_params *params,
+					   FILE *out )
 {
-	struct tiffout * ctx = new_tiffout( outfile, 0 );
+	struct tiffout * ctx = new_tiffout( params, out, 0 );
 	if ( ctx )
 		write_tonemap_header( ctx );
 	
@@ -136,14 +145,15 @@ _tiffout_open_tonemap( const char *outfile )
 
 /**
  *   #tiffout   
- *    #outfile.  £ 
+ *    #out.  £ 
  * _tiffout_open_tonemap().    ,
  *      .
  */
 void *
-tiffout_open_tonemap( const char *outfile )
+tiffout_open_tonemap( const struct filter_params *params,
+					  FILE *out )
 {
-	return (void *) _tiffout_open_tonemap( outfile );
+	return (void *) _tiffout_open_tonemap( params, out );
 }
 
 static void tiffout_flush( struct tiffout *a );
@@ -223,7 +233,7 @@ _tiffout_write_tile( struct tiffout *a,
 					 unsigned char tile_index,
 					 unsigned char tile_area )
 {
-	static unsigned char tilebuf[WEIGHTFUNC_LEN];
+	unsigned char tilebuf[WEIGHTFUNC_LEN];
 	get_tile_bytemap( tilebuf, tile_index, tile_area );
 	tiffout_encode_tile( a, tilebuf );
 }
@@ -249,7 +259,7 @@ static void
 _tiffout_write_toneline( struct tiffout *a, const char *buf,
 						 size_t ss, size_t count )
 {
-	if ( ss != 1 && count != width ) {
+	if ( ss != 1 && count != a->params.width ) {
 		fprintf( stderr, "Error: Wrong tone line: %d x %d\n",
 				 ss, count );
 		return;
@@ -281,7 +291,7 @@ _tiffout_close( struct tiffout *tiffout_p )
 	/*   . */
 	tiffout_flush( tiffout_p );
 	
-	/*  . */
+	/*   TIFF;    . */
 	TIFFClose( tiffout_p->tif );
 
 	/*   */
@@ -301,20 +311,80 @@ tiffout_close( void *ctx )
 
 /*  . */
 
+/**
+ *  - libtiff   stdio.  TIFF
+ *    :   
+ * .
+ */
+static tmsize_t
+tiffout_stream_read( thandle_t h, void *buf, tmsize_t size )
+{
+	return (tmsize_t) fread( buf, 1, size, (FILE *) h );
+}
+
+static tmsize_t
+tiffout_stream_write( thandle_t h, void *buf, tmsize_t size )
+{
+	return (tmsize_t) fwrite( buf, 1, size, (FILE *) h );
+}
+
+static toff_t
+tiffout_stream_seek( thandle_t h, toff_t off, int whence )
+{
+	if ( fseeko( (FILE *) h, (off_t) off, whence ) != 0 )
+		return (toff_t) -1;
+
+	return (toff_t) ftello( (FILE *) h );
+}
+
+static int
+tiffout_stream_close( thandle_t h )
+{
+	return fflush( (FILE *) h );
+}
+
+static toff_t
+tiffout_stream_size( thandle_t h )
+{
+	FILE *f = (FILE *) h;
+	off_t pos = ftello( f );
+	off_t size;
+
+	fseeko( f, 0, SEEK_END );
+	size = ftello( f );
+	fseeko( f, pos, SEEK_SET );
+
+	return (toff_t) size;
+}
+
+static int
+tiffout_stream_map( thandle_t h, void **base, toff_t *size )
+{
+	return 0;
+}
+
+static void
+tiffout_stream_unmap( thandle_t h, void *base, toff_t size )
+{
+}
+
 /**
  *   #tiffout,    
  *         
  *      TIFF.
- *   TIFF c  #outfile.
+ *   TIFF c   #out.
  */
 static struct tiffout *
-new_tiffout( const char *outfile, int bitmap ) {
+new_tiffout( const struct filter_params *params, FILE *out,
+			 int bitmap ) {
 
 	struct tiffout *a;
+	unsigned long width = params->width;
 
 	a = (struct tiffout *) malloc( sizeof(struct tiffout) );
 	
 	if (a != NULL) {
+		a->params = *params;
 		a->y = 0;
 		a->written = 1;
 		a->tile_x = 0;
@@ -334,10 +404,14 @@ new_tiffout( const char *outfile, int bitmap ) {
 			a = NULL;
 		} else {
 			memset( a->buf, 0, a->bufsize );
-			a->tif = TIFFOpen( outfile, "w" );
+			a->tif = out == NULL ? NULL :
+				TIFFClientOpen( "layer", "w", (thandle_t) out,
+								tiffout_stream_read, tiffout_stream_write,
+								tiffout_stream_seek, tiffout_stream_close,
+								tiffout_stream_size, tiffout_stream_map,
+								tiffout_stream_unmap );
 			if ( a->tif == NULL ) {
-				fprintf( stderr, "Unable to create TIFF file %s\n",
-						 outfile );
+				fprintf( stderr, "Unable to create the TIFF layer\n" );
 				_TIFFfree( a->buf );
 				free( a );
 				a = NULL;
@@ -394,13 +468,13 @@ write_bitmap_header( struct tiffout *tiffout_p, int mask ) {
 	TIFFSetField( tiffout_p->tif, TIFFTAG_SAMPLESPERPIXEL, 1 );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_BITSPERSAMPLE, 1 );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_IMAGEWIDTH,
-				  width * TILEWIDTH);
+				  tiffout_p->params.width * TILEWIDTH);
 	TIFFSetField( tiffout_p->tif, TIFFTAG_IMAGELENGTH,
-				  height * TILEHEIGHT );
+				  tiffout_p->params.height * TILEHEIGHT );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_XRESOLUTION,
-				  hres * TILEWIDTH );
+				  tiffout_p->params.hres * TILEWIDTH );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_YRESOLUTION,
-				  vres * TILEHEIGHT );
+				  tiffout_p->params.vres * TILEHEIGHT );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_PHOTOMETRIC,
 				  PHOTOMETRIC_MINISWHITE );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_RESOLUTIONUNIT,
@@ -420,12 +494,16 @@ write_tonemap_header( struct tiffout *tiffout_p )
 				  PLANARCONFIG_CONTIG );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_SAMPLESPERPIXEL, 1 );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_BITSPERSAMPLE, 8 );
-	TIFFSetField( tiffout_p->tif, TIFFTAG_IMAGEWIDTH, width );
-	TIFFSetField( tiffout_p->tif, TIFFTAG_IMAGELENGTH, height );
-	TIFFSetField( tiffout_p->tif, TIFFTAG_XRESOLUTION, hres );
-	TIFFSetField( tiffout_p->tif, TIFFTAG_YRESOLUTION, vres );
+	TIFFSetField( tiffout_p->tif, TIFFTAG_IMAGEWIDTH,
+				  tiffout_p->params.width );
+	TIFFSetField( tiffout_p->tif, TIFFTAG_IMAGELENGTH,
+				  tiffout_p->params.height );
+	TIFFSetField( tiffout_p->tif, TIFFTAG_XRESOLUTION,
+				  tiffout_p->params.hres );
+	TIFFSetField( tiffout_p->tif, TIFFTAG_YRESOLUTION,
+				  tiffout_p->params.vres );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_PHOTOMETRIC, 
-				  miniswhite ? PHOTOMETRIC_MINISWHITE :
+				  tiffout_p->params.miniswhite ? PHOTOMETRIC_MINISWHITE :
 				               PHOTOMETRIC_MINISBLACK );
 	TIFFSetField( tiffout_p->tif, TIFFTAG_RESOLUTIONUNIT,
 				  RESUNIT_INCH );
@@ -445,7 +523,7 @@ static void tiffout_encode_tile( struct tiffout *a,
 	int i, j;
 	unsigned char *p;
 
-	if ( a->tile_x >= width ) {
+	if ( a->tile_x >= a->params.width ) {
 		fprintf( stderr, "Error: tile X too big: %d\n", a->tile_x );
 		return;
 	}
@@ -42,7 +42,7 @@
 
 /*        TIFF. */
 
-#include "filter.h"
+#include "libengrave.h"
 
 /**
  *     TIFF.
@@ -48,8 +48,11 @@
 
 #include "system.h"
 #include "filter.h"
-#include "tile32f.h"
+#include "libengrave.h"
+#include "bandstore.h"
 #include "misc.h"
+#include "stats.h"
+#include "perfctr.h"
 
 /*  ,   . */
 
@@ -61,18 +64,29 @@ enum {DUMMY_CODE=129
 
 /*   */
 
+/*  : ,  , 
+ *     .   
+ *     . */
+struct engrave_params params;
+
 /*   : */
-int want_half = 0;		/*   ()
-				 * 
-				 * ; */
 char *histfn;			/*     
 				 *  ; */
-
-/*      : */
-int phist[TILE_COUNT];          /*   ; */
-int nhist[TILE_COUNT];          /*   ; */
-int zerotile = 0;               /*  
-				 * . */
+int want_profile = 0;		/*    
+				 *  ; */
+char *sweepfn;			/*     
+				 *  ; */
+char *incremental_dir;		/*    
+				 *  . */
+
+/*      . */
+char *band_rows_str;
+unsigned long band_rows = 64;
+
+/*    ,   
+ * sweepfn. */
+struct tile32_params *sweep;
+size_t sweep_count;
 
 /*     . */
 
@@ -90,7 +104,6 @@ char *minarea_str;
 
 /*      . */
 char *passthrough_str;
-int passthrough[] = {0, 0, 0, 0};
 
 /*    . */
 char *select_mask_str;
@@ -99,15 +112,19 @@ int select_mask[] = {1, 1};
 /*    . */
 static struct option const long_options[] =
 {
-	{"half", no_argument, &want_half, 1},
+	{"half", no_argument, &params.want_half, 1},
 	{"hist", required_argument, NULL, 0},
-	{"ignore-outtest", no_argument, &outtest, 0},
+	{"ignore-outtest", no_argument, &params.tile.outtest, 0},
 	{"minarea", required_argument, NULL, 0},
 	{"value-thr", required_argument, NULL, 0},
 	{"sum-thr", required_argument, NULL, 0},
 	{"dia-corr", required_argument, NULL, 0},
 	{"passthrough", required_argument, NULL, 0},
 	{"select-mask", required_argument, NULL, 0},
+	{"profile", no_argument, &want_profile, 1},
+	{"sweep", required_argument, NULL, 0},
+	{"incremental", required_argument, NULL, 0},
+	{"band-rows", required_argument, NULL, 0},
 	{NULL, 0, NULL, 0}
 };
 
@@ -116,205 +133,212 @@ char **option_vars[] =
 {
 	NULL, &histfn, NULL, &minarea_str,
 	&FThr_str, &FThr2_str, &FDcor_str, &passthrough_str,
-	&select_mask_str
+	&select_mask_str, NULL, &sweepfn, &incremental_dir,
+	&band_rows_str
 };
 
 
-/**
- *  ,    .
- *
- *   ,     
- *       .  
- *     #buf,   
- *       #outbuf. 
- *        #c0 + #c. 
- *    ޣ  #ss  #len  
- * ޣ.    (  ) 
- *  #filter_writer_p   #pos_filter_writer 
- *   #neg_filter_writer.   ޣ 
- *        ,  
- *   #mi. */
-void maketiles(unsigned char *buf[], unsigned char *outbuf,
-			   int c0, int c, size_t ss, size_t len,
-			   struct filter_writer *filter_writer_p,
-			   void *pos_filter_writer,
-			   void *neg_filter_writer,
-			   struct maketiles_info *mi)
+/*    . */
+void
+usage_header (FILE *out)
 {
+  fprintf (out, _("%s - \
+Image filter for 'engrave' package. Produces binary images (PostScript or TIFF) for the stroke part of each image color channel reading a RAW CT image data from stdin\n"), program_name);
+  
+}
 
-	/*  ޣ. */
-	t_window window;
-
-	/* ޣ */
-	int x;
-
-	/*  . */
-	int neg;
-
-	/*  . */
-	int tile_index;
-
-	/*   . */
-	unsigned char tile_area;
-
-	/*   ޣ      . */
-	unsigned int z;
-	unsigned int zl;
-
-	/*  . */
-	void *filter_writer_ctx;
-
-	/*   . */
-	size_t half_len = len/2;
-
-	/*    */
-	size_t c_offs = c - c0;
-
-	/*  ޣ      
-	 *  .
-	 */
-	mi->pz = 0;
-	mi->nz = 0;
-
-	/*    ޣ    ޣ 
-	 * ޣ      .
-	 *
-	 *    ,    window 
-	 *  .
-	 */
-	pB1 = buf[0] + 2*ss + c_offs;
-	pA = buf[1] + ss + c_offs;
-	pB = buf[1] + 2*ss + c_offs;
-	pC = buf[1] + 3*ss + c_offs;
-	pD1 = buf[2] + c_offs;
-	pD = buf[2] + ss + c_offs;
-	pE = buf[2] + 2*ss + c_offs;
-	pF = buf[2] + 3*ss + c_offs;
-	pF1 = buf[2] + 4*ss + c_offs;
-	pG = buf[3] + ss + c_offs;
-	pH = buf[3] + 2*ss + c_offs;
-	pI = buf[3] + 3*ss + c_offs;
-	pH1 = buf[4] + 2*ss + c_offs;
-
-	/*        ޣ 
-	 *  
-	 */
-	outbuf += c_offs;
-
-	/*     ޣ. */
-	for (x = 0; x < len; x++) {
-		/*      
-		 *  ,     
-		 *       .
-		 *     
-		 *  .
-		 */
-		if ( (want_half && x > half_len) || passthrough[c] ) {
-			tile_index = 0;
-			*outbuf = E;
-		} else {
-			/*       
-			 *    ,   
-			 *    .
-			 */
-			get_tile(window, &neg, &tile_index, &tile_area, outbuf);
-		}
+/*    . */
+
+/*       . */
+struct profile_info {
+	unsigned long long total[PERFCTR_COUNT];	/*  ޣ. */
+	double wall;				/*  , . */
+	unsigned long rows;			/*   . */
+	unsigned long long flat;	/*   ޣ. */
+	unsigned long long tiled;	/*  ޣ  . */
+	/*   ޣ,    ޣ : */
+	unsigned long lost;			/*   ; */
+	unsigned long long cflat;	/*  ޣ; */
+	unsigned long long ctiled;	/* ޣ  . */
+	/*        ޣ
+	 *      : */
+	double sff, sft, stt, sfy, sty;
+};
 
-		/*      . */
-		pA += ss;
-		pB += ss;
-		pC += ss;
-		pD += ss;
-		pE += ss;
-		pF += ss;
-		pG += ss;
-		pH += ss;
-		pI += ss;
-		pB1 += ss;
-		pD1 += ss;
-		pH1 += ss;
-		pF1 += ss;
-		outbuf += ss;
-
-		/*  ,     ,
-		 *    .
-		 */
-		if (tile_index) {
-			/*      
-			 *    .
-			 */
-			if (neg) {
-				/*     
-				 * .
-				 */
-				nhist[tile_index-1]++;
-				/*    
-				 *    . */
-				filter_writer_ctx = neg_filter_writer;
-				z = mi->nz;
-				zl = mi->nzl;
-			} else {
-				/*     
-				 * .
-				 */
-				phist[tile_index-1]++;
-				/*    
-				 *    . */
-				filter_writer_ctx = pos_filter_writer;
-				z = mi->pz;
-				zl = mi->pzl;
-			}
+/*   ޣ. */
+static struct perfctr perfctr;
 
+/*     . */
+static struct profile_info profile[4];
 
-			/*      , 
-			 *      ,
-			 *     ޣ.
-			 */
-			if ( zl ) {
-				filter_writer_p->write_tile_lines( filter_writer_ctx, zl );
-			}
-			if ( z ) {
-				filter_writer_p->write_spaces( filter_writer_ctx, z );
-			}
+/*  ޣ      . */
+static unsigned long long profile_v0[PERFCTR_COUNT];
+static int profile_v0_ok;
+static double profile_t0;
 
-			/*     . */
-			filter_writer_p->write_tile( filter_writer_ctx,
-										 (unsigned char) tile_index,
-										 tile_area );
-				
-			/*    ޣ 
-			 * . */
-			if (neg) {
-				mi->nz = 0;
-				mi->nzl = 0;
-				mi->pz++;
-			} else {
-				mi->pz = 0;
-				mi->pzl = 0;
-				mi->nz++;
-			}
-		} else {
-			/*      
-			 *  ޣ . */
-			mi->nz++;
-			mi->pz++;
-			zerotile++;
-		}
+/**
+ *   ޣ   .  
+ * ,       .
+ */
+void
+profile_start()
+{
+	memset( profile, 0, sizeof(profile) );
+	if ( perfctr_open( &perfctr ) == 0 ) {
+		fprintf( stderr, "[%s] Hardware counters are unavailable (%s), "
+				 "profiling wall time only\n",
+				 program_name, strerror( perfctr.err ) );
 	}
+}
+
+/**
+ *   ޣ     #c
+ * (. #engrave_output).
+ */
+void profile_row_begin(void *arg, int c)
+{
+	profile_t0 = stats_now();
+	profile_v0_ok = perfctr_read( &perfctr, profile_v0 ) == 0;
+}
 
+/**
+ *   ޣ     
+ *  #c. ޣ    (#flat)  .
+ * ,    ޣ , 
+ *   .
+ */
+void profile_row_end(void *arg, int c, unsigned long flat)
+{
+	unsigned long long v1[PERFCTR_COUNT];
+	unsigned long long *v0 = profile_v0;
+	struct profile_info *p;
+	double t0 = profile_t0, t1, f, t, y;
+	int i, ok;
+
+	ok = perfctr_read( &perfctr, v1 ) == 0 && profile_v0_ok;
+	t1 = stats_now();
+
+	p = &profile[c];
+	p->wall += t1 - t0;
+	p->rows++;
+
+	f = flat;
+	t = width - f;
+	p->flat += f;
+	p->tiled += t;
+
+	if ( ok ) {
+		for ( i = 0; i < PERFCTR_COUNT; i++ ) {
+			p->total[i] += v1[i] - v0[i];
+		}
+		p->cflat += f;
+		p->ctiled += t;
+	} else {
+		p->lost++;
+	}
 
-	/*  ޣ  () . */
-	mi->nzl++;
-	mi->pzl++;
+	/*  : ,  ޣ , 
+	 * . */
+	if ( perfctr.fd[PERFCTR_CYCLES] != -1 ) {
+		if ( !ok ) {
+			return;
+		}
+		y = v1[PERFCTR_CYCLES] - v0[PERFCTR_CYCLES];
+	} else {
+		y = (t1 - t0) * 1e9;
+	}
+	p->sff += f * f;
+	p->sft += f * t;
+	p->stt += t * t;
+	p->sfy += f * y;
+	p->sty += t * y;
 }
 
-/*    . */
+/**
+ *      #c0  #cN    
+ *   ޣ.
+ */
 void
-usage_header (FILE *out)
+profile_report( int c0, int cN )
 {
-  fprintf (out, _("%s - \
-Image filter for 'engrave' package. Produces binary images (PostScript or TIFF) for the stroke part of each image color channel reading a RAW CT image data from stdin\n"), program_name);
-  
+	struct profile_info *p;
+	const char *unit;
+	double pixels, cpixels, flat, tiled, cost, det, a, b;
+	int c, i, cycles;
+
+	cycles = perfctr.fd[PERFCTR_CYCLES] != -1;
+	unit = cycles ? "cycles" : "ns";
+
+	for ( c = c0; c <= cN; c++ ) {
+		p = &profile[c];
+		pixels = (double) (p->flat + p->tiled);
+		if ( pixels == 0 ) {
+			continue;
+		}
+
+		fprintf( stderr, "[%s] Profile of channel %c: %lu rows, "
+				 "%.0f pixels (%llu flat, %llu tiled), %.3f s\n",
+				 program_name, "CMYK"[c], p->rows, pixels,
+				 p->flat, p->tiled, p->wall );
+
+		/*  ޣ    ,  
+		 *   . */
+		cpixels = (double) (p->cflat + p->ctiled);
+		if ( perfctr.count > 0 && p->lost > 0 ) {
+			fprintf( stderr, "[%s]   hardware counters unavailable "
+					 "for %lu of %lu rows\n", program_name, p->lost,
+					 p->rows );
+		}
+		for ( i = 0; i < PERFCTR_COUNT && cpixels > 0; i++ ) {
+			if ( perfctr.fd[i] == -1 ) {
+				continue;
+			}
+			fprintf( stderr, "[%s]   %s: %llu (%.3f per pixel)\n",
+					 program_name, perfctr_name( i ), p->total[i],
+					 p->total[i] / cpixels );
+		}
+		if ( cycles &&
+			 perfctr.fd[PERFCTR_INSTRUCTIONS] != -1 &&
+			 p->total[PERFCTR_CYCLES] ) {
+			fprintf( stderr, "[%s]   IPC: %.2f\n", program_name,
+					 (double) p->total[PERFCTR_INSTRUCTIONS] /
+					 p->total[PERFCTR_CYCLES] );
+		}
+
+		/*   (a)   (b) ޣ 
+		 *   .   ޣ  
+		 *  ,    . */
+		if ( cycles ) {
+			cost = (double) p->total[PERFCTR_CYCLES];
+			flat = p->cflat;
+			tiled = p->ctiled;
+		} else {
+			cost = p->wall * 1e9;
+			flat = p->flat;
+			tiled = p->tiled;
+		}
+		det = p->sff * p->stt - p->sft * p->sft;
+		if ( flat + tiled == 0 ) {
+			continue;
+		} else if ( tiled == 0 ) {
+			fprintf( stderr, "[%s]   %s per pixel: flat %.2f\n",
+					 program_name, unit, cost / flat );
+		} else if ( flat == 0 ) {
+			fprintf( stderr, "[%s]   %s per pixel: tiled %.2f\n",
+					 program_name, unit, cost / tiled );
+		} else if ( det > 1e-9 * p->sff * p->stt ) {
+			a = (p->sfy * p->stt - p->sty * p->sft) / det;
+			b = (p->sty * p->sff - p->sfy * p->sft) / det;
+			fprintf( stderr, "[%s]   %s per pixel: flat %.2f, "
+					 "tiled %.2f\n", program_name, unit, a, b );
+		} else {
+			fprintf( stderr, "[%s]   %s per pixel: %.2f "
+					 "(flat/tiled split is undetermined)\n",
+					 program_name, unit, cost / (flat + tiled) );
+		}
+	}
+
+	perfctr_close( &perfctr );
 }
 
 /*      . */
@@ -337,6 +361,15 @@ usage_params(FILE *out)
   --passthrough=CMYK   ignores selected color channels\n\
   --select-mask=BW     select black, white or both correction\n\
                        images\n\
+  --profile            report hardware counters for the tile\n\
+                       generation loop to stderr\n\
+  --sweep=FILE         also evaluate the parameter sets listed in\n\
+                       FILE (VALUE-THR SUM-THR DIA-CORR MINAREA\n\
+                       per line) and report their tile statistics\n\
+  --incremental=DIR    keep per-band analysis results in DIR and\n\
+                       re-analyse only the bands changed since the\n\
+                       previous run\n\
+  --band-rows=N        rows per band for --incremental, default is 64\n\
 "));
 
 }
@@ -354,7 +387,7 @@ set_paramenetrs()
 	 * . */
 
 	if (FThr_str != NULL) {
-		FThr = (char) strtol(FThr_str, &endptr, 0);
+		params.tile.FThr = (char) strtol(FThr_str, &endptr, 0);
 		if (endptr == FThr_str) {
 			fprintf(stderr, "Value comparison threshold should be an integer number.\n");
 	  		/*    ,   
@@ -364,7 +397,7 @@ set_paramenetrs()
 	}
 
 	if (FThr2_str != NULL) {
-		FThr = strtod(FThr2_str, &endptr);
+		params.tile.FThr2 = strtod(FThr2_str, &endptr);
 		if (endptr == FThr2_str) {
 			fprintf(stderr, "Summary values comparison threshold should be a decimal number.\n");
 	  		/*    ,   
@@ -374,7 +407,7 @@ set_paramenetrs()
 	}
 
 	if (FDcor_str != NULL) {
-		FThr = strtod(FDcor_str, &endptr);
+		params.tile.FDcor = strtod(FDcor_str, &endptr);
 		if (endptr == FDcor_str) {
 			fprintf(stderr, "Diagonal correlator should be a decimal number.\n");
 	  		/*    ,   
@@ -384,7 +417,7 @@ set_paramenetrs()
 	}
 
 	if (minarea_str != NULL) {
-		minarea = (char) strtol(minarea_str, &endptr, 0);
+		params.tile.minarea = (char) strtol(minarea_str, &endptr, 0);
 		if (endptr == minarea_str) {
 			fprintf(stderr, "Minimal line area should be a decimal number.\n");
 	  		/*    ,   
@@ -395,18 +428,28 @@ set_paramenetrs()
 
 	if (passthrough_str != NULL) {
 	  if (strchr(passthrough_str, 'C') != NULL) {
-	    passthrough[0] = 1;
+	    params.passthrough[0] = 1;
 	  }
 	  if (strchr(passthrough_str, 'M') != NULL) {
-	    passthrough[1] = 1;
+	    params.passthrough[1] = 1;
 	  }
 	  if (strchr(passthrough_str, 'Y') != NULL) {
-	    passthrough[2] = 1;
+	    params.passthrough[2] = 1;
 	  }
 	  if (strchr(passthrough_str, 'K') != NULL) {
-	    passthrough[3] = 1;
+	    params.passthrough[3] = 1;
 	  }
 	}
+	if (band_rows_str != NULL) {
+		band_rows = strtoul(band_rows_str, &endptr, 0);
+		if (endptr == band_rows_str || band_rows == 0) {
+			fprintf(stderr, "Band rows should be a positive integer number.\n");
+	  		/*    ,   
+	   	 	 *  . */
+	  		exit(EXIT_FAILURE);
+		}
+	}
+
 	if (select_mask_str != NULL) {
 	  if (strchr(select_mask_str, 'B') != NULL) {
 	    select_mask[0] = 1;
@@ -421,6 +464,175 @@ set_paramenetrs()
 	}
 }
 
+/**
+ *        #fn. 
+ *    VALUE-THR, SUM-THR, DIA-CORR  MINAREA;
+ *         .
+ *    ,   '#', .
+ */
+void
+read_sweep(const char *fn)
+{
+	FILE *f;
+	char line[MAXLINE];
+	struct tile32_params *p;
+	unsigned int thr, area;
+	int n, lineno = 0;
+
+	f = fopen(fn, "r");
+	if (f == NULL) {
+		fprintf(stderr, "%s: Unable to open the sweep file %s\n", program_name, fn);
+		/*    ,     . */
+		exit(EXIT_FAILURE);
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		lineno++;
+		n = strspn(line, " \t\r\n");
+		if (line[n] == '\0' || line[n] == '#')
+			continue;
+
+		p = realloc(sweep, (sweep_count + 1) * sizeof(*sweep));
+		if (p == NULL) {
+			fprintf(stderr, "%s: Sweep set allocation failed\n", program_name);
+			exit(EXIT_FAILURE);
+		}
+		sweep = p;
+		p = &sweep[sweep_count];
+		*p = params.tile;
+
+		thr = p->FThr;
+		area = p->minarea;
+		n = sscanf(line, "%u %lf %lf %u", &thr, &p->FThr2, &p->FDcor, &area);
+		if (n < 1 || thr > 255 || area > 255) {
+			fprintf(stderr, "%s: %s:%i: Invalid parameter set\n", program_name, fn, lineno);
+			/*    ,    
+			 * . */
+			exit(EXIT_FAILURE);
+		}
+		p->FThr = thr;
+		p->minarea = area;
+		sweep_count++;
+	}
+
+	fclose(f);
+
+	if (sweep_count == 0) {
+		fprintf(stderr, "%s: No parameter sets in %s\n", program_name, fn);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*     #stats   #fn. */
+void
+write_hist(const char *fn, const struct engrave_stats *stats)
+{
+	FILE *histf;
+	int i;
+
+	histf = fopen(fn, "w");
+	if (histf != NULL) {
+		fprintf(histf, "#0: %lu\n", stats->zerotile);
+		for (i = 0; i < TILE_COUNT; i++)
+			fprintf(histf, "#%i: %lu\n", i+1, stats->phist[i]);
+		for (i = 0; i < TILE_COUNT; i++)
+			fprintf(histf, "#-%i: %lu\n", i+1, stats->nhist[i]);
+		fclose(histf);
+	} else {
+		/*       , 
+		 *    . */
+		fprintf(stderr, "Writing histogram to file %s failedi.\n", fn);
+	}
+}
+
+/*          #p
+ *   #n (0 --  )   #stats. */
+void
+sweep_report(size_t n, const struct tile32_params *p,
+			 const struct engrave_stats *stats)
+{
+	unsigned long pos = 0, neg = 0, tiled;
+	double pixels;
+	int i;
+
+	for (i = 0; i < TILE_COUNT; i++) {
+		pos += stats->phist[i];
+		neg += stats->nhist[i];
+	}
+	tiled = pos + neg;
+	pixels = (double) stats->zerotile + tiled;
+
+	fprintf(stderr, "[%s] Sweep set #%lu: value-thr %u, sum-thr %.2f, "
+			"dia-corr %.2f, minarea %u: %lu flat, %lu tiled "
+			"(%.2f%% tiled; %lu strokes, %lu masks)\n",
+			program_name, (unsigned long) n, p->FThr, p->FThr2, p->FDcor,
+			p->minarea, stats->zerotile, tiled,
+			pixels > 0 ? 100.0 * tiled / pixels : 0.0, pos, neg);
+}
+
+/*     ,   
+ *  ,      . 
+ *    ,   -D/-I. */
+static void
+write_toneline(void *arg, const unsigned char *buf, size_t ss, size_t count)
+{
+	if (fwrite(buf, ss, count, stdout) < count) {
+		fprintf(stderr, "%s: Failed to transfer scanline data further\n", program_name);
+		/*    ,     
+		 *  .
+		 */
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*      :  
+ *        . */
+static void
+get_params_key(char *key, size_t size)
+{
+	snprintf(key, size, "tile32 value-thr %u sum-thr %.17g "
+			 "dia-corr %.17g minarea %u outtest %i half %i "
+			 "passthrough %i%i%i%i miniswhite %i negative-input %i "
+			 "cmyk %i bits %i",
+			 params.tile.FThr, params.tile.FThr2, params.tile.FDcor,
+			 params.tile.minarea, params.tile.outtest, params.want_half,
+			 params.passthrough[0], params.passthrough[1],
+			 params.passthrough[2], params.passthrough[3],
+			 params.image.miniswhite, params.image.negative_input,
+			 params.image.is_cmyk,
+			 params.image.bits);
+}
+
+/*    #y   #buf   . */
+static void
+read_line(unsigned char *buf, size_t ss, unsigned long y)
+{
+	size_t rd;
+
+	rd = fread(buf, ss, width, stdin);
+
+	/*    ޣ    
+	 * ,      . */
+	if (rd < width) {
+		fprintf(stderr, "%s: Line %lu. Image stream suddenly closed (%lu samples has been read)\n", program_name, y, (unsigned long) rd);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*    #*file   #fname.  ,
+ *   ,    . */
+static void
+close_layer_file(FILE **file, const char *fname)
+{
+	FILE *f = *file;
+
+	*file = NULL;
+	if (f != NULL && fclose(f) != 0) {
+		fprintf(stderr, "%s: Unable to write temporary file %s\n", program_name, fname);
+		exit(EXIT_FAILURE);
+	}
+}
+
 /*  . */
 int
 main (int argc, char **argv)
@@ -431,14 +643,15 @@ main (int argc, char **argv)
 
   /*  ޣ  . */
   size_t ss;
-   /*    . */
-  FILE *histf = NULL;
 
   /*    . */
   struct filter_writer *filter_writer_p = NULL;
 
   /*       . */
   const char *pos_filenames[4] = { NULL, NULL, NULL, NULL };
+
+  /*    . */
+  FILE *pos_files[4] = { NULL, NULL, NULL, NULL };
   
   /*    . */
   void *pos_filter_writer[] = {
@@ -451,6 +664,9 @@ main (int argc, char **argv)
   /*      . */
   const char *neg_filenames[4] = { NULL, NULL, NULL, NULL };
 
+  /*   . */
+  FILE *neg_files[4] = { NULL, NULL, NULL, NULL };
+
   /*    . */
   void *neg_filter_writer[] = {
 	  NULL,
@@ -459,38 +675,45 @@ main (int argc, char **argv)
 	  NULL
   };
 
-  /*     5  ,  
-   *   .
-   */
-  unsigned char *buf[] = {
-	  NULL,
-	  NULL,
-	  NULL,
-	  NULL,
-	  NULL
-  };
+  /*    . */
+  struct engrave_output output;
 
-  /*     ޣ   
-   *  .
-   */
-  struct maketiles_info mi[4];
-  
-  /*     . */
-  unsigned char *tmpbuf = NULL;
-  
-  /*      ,   
-   * .
-   */
-  unsigned char *outbuf = NULL;	/* Buffer for output image data */ 
+  /*   . */
+  struct engrave_ctx *ectx = NULL;
+
+  /*   :    
+   *  . */
+  struct engrave_stats *stats = NULL;
+
+  /*      . */
+  char sweep_histfn[MAXLINE];
+
+  /*      ,  
+   * ,         ţ. */
+  unsigned char *linebuf = NULL;
+
+  /*  . */
+  struct bandstore *bstore = NULL;
+
+  /*      . */
+  char params_key[MAXLINE];
+
+  /*  ,  ,     
+   * ,    ,    ,
+   *     . */
+  unsigned long band, nbands, first, end, bufrow, y_read, y_push;
+
+  /*    . */
+  size_t rowsize;
+
+  /*  ģ   . */
+  unsigned long reused, analysed;
   
   /* ޣ   . */
   int c0, c, cN;
 
-  /*  ޣ    . */
-  size_t rd;
-
   /*   . */
-  int y;
+  unsigned long y;
 
   /* ޣ   . */
   int i;
@@ -508,11 +731,23 @@ main (int argc, char **argv)
 
 	  if (!OK)
 		  fprintf(stderr, "%s: Finished with error.\n", program_name);
+	  if (ectx != NULL) {
+		  engrave_close(ectx, NULL);
+		  ectx = NULL;
+	  }
+	  if (bstore != NULL) {
+		  bandstore_close(bstore, 0, NULL, NULL);
+		  bstore = NULL;
+	  }
 	  for (i = 0; i < 4; i++) {
 		  if (pos_filter_writer[i] != NULL) {
 			  filter_writer_p->close( pos_filter_writer[i] );
 			  pos_filter_writer[i] = NULL;
 		  }
+		  if (pos_files[i] != NULL) {
+			  fclose( pos_files[i] );
+			  pos_files[i] = NULL;
+		  }
 		  if (!OK && pos_filenames[i] != NULL) {
 			  fprintf( stderr, "%s: Delete temporary file: %s\n",
 					   program_name, pos_filenames[i] );
@@ -524,6 +759,10 @@ main (int argc, char **argv)
 			  filter_writer_p->close( neg_filter_writer[i] );
 			  neg_filter_writer[i] = NULL;
 		  }
+		  if (neg_files[i] != NULL) {
+			  fclose( neg_files[i] );
+			  neg_files[i] = NULL;
+		  }
 		  if (!OK && neg_filenames[i] != NULL) {
 			  fprintf( stderr, "%s: Delete temporary file: %s\n",
 					   program_name, neg_filenames[i] );
@@ -533,11 +772,12 @@ main (int argc, char **argv)
 		  }
 	  }
 	  
-	  for (i = 0; i < 5; i++)
-		  if (buf[i] != NULL)
-			  free(buf[i]);
-	  if (outbuf != NULL)
-		  free(outbuf);
+	  if (linebuf != NULL)
+		  free(linebuf);
+	  if (stats != NULL)
+		  free(stats);
+	  if (sweep != NULL)
+		  free(sweep);
   }
 
   /*   . */
@@ -547,11 +787,33 @@ main (int argc, char **argv)
   init_cleanup(program_name);
   push_cleanup(cleanup);
 
+  /*    . */
+  engrave_init_params(&params);
+
+  /*       
+   * (. --describe). */
+  filter_produces_output = 1;
+
   /*    . */
   opt_r = decode_switches (argc, argv, EXIT_FAILURE, long_options, option_vars, &usage_header, &usage_params);
 
   /*    . */
   set_paramenetrs();
+  get_filter_params(&params.image);
+
+  /*    . */
+  if (sweepfn != NULL) {
+	  read_sweep(sweepfn);
+	  params.sweep = sweep;
+	  params.sweep_count = sweep_count;
+  }
+
+  /*       
+   * ,       . */
+  if (sweepfn != NULL && incremental_dir != NULL) {
+	  fprintf(stderr, "%s: --sweep and --incremental can't be used together\n", program_name);
+	  exit(EXIT_FAILURE);
+  }
 
   /*  . */
   filter_writer_p = get_selected_filter_writer();
@@ -577,34 +839,20 @@ main (int argc, char **argv)
 	  c0 = 3;	/* 1 ,  0 */
 	  cN = 3;	/*  0 */
   }
-
-  /*    .  2 ޣ   
-   *       . */
-  for (i = 0; i < 5; i++) {
-	  buf[i] = calloc(ss, width + 4);
-	  if (buf[i] == NULL) {
-		  fprintf(stderr, "%s: Scanline buffer #%i allocation failed\n", program_name, i);
-		  /*    ,    ,
-		   *  . */
-		  exit(EXIT_FAILURE);
-	  }
-  }
-
-  /*     . */
-  outbuf = calloc(ss, width);
-  if (outbuf == NULL) {
-	  fprintf(stderr, "%s: Output buffer allocation failed\n", program_name);
+  /* 16- ޣ   . */
+  ss *= sample_bits / 8;
+
+  /*       . */
+  rowsize = ss * width;
+  linebuf = calloc(incremental_dir != NULL ? band_rows + 4 : 1, rowsize);
+  stats = calloc(1 + sweep_count, sizeof(*stats));
+  if (linebuf == NULL || stats == NULL) {
+	  fprintf(stderr, "%s: Scanline buffer allocation failed\n", program_name);
 	  /*    ,    ,
 	   *  . */
 	  exit(EXIT_FAILURE);
   }
 
-  /*  . */
-  for (i = 0; i < TILE_COUNT-1; i++) {
-	  phist[i] = 0;
-	  nhist[i] = 0;
-  }
-
   /*      . */
   for (c = c0; c <= cN; c++) {
 	 /*  . */
@@ -615,6 +863,12 @@ main (int argc, char **argv)
 		fprintf( stderr, "%s: Can't get temp file name\n", program_name );
 		exit(EXIT_FAILURE);
 	  }
+	  pos_files[c] = open_tmp_filter_file( pos_filenames[c] );
+	  if ( pos_files[c] == NULL ) {
+		fprintf( stderr, "%s: Can't create temp file %s\n", program_name,
+				 pos_filenames[c] );
+		exit(EXIT_FAILURE);
+	  }
     }
     if (select_mask[1]) {
       neg_filenames[c] = get_tmp_filter_file_name( "m", c );
@@ -623,13 +877,19 @@ main (int argc, char **argv)
 		fprintf( stderr, "%s: Can't get temp file name\n", program_name );
 		exit(EXIT_FAILURE);
 	  }
+	  neg_files[c] = open_tmp_filter_file( neg_filenames[c] );
+	  if ( neg_files[c] == NULL ) {
+		fprintf( stderr, "%s: Can't create temp file %s\n", program_name,
+				 neg_filenames[c] );
+		exit(EXIT_FAILURE);
+	  }
     }
 	 
 	 /*  . */
 	 pos_filter_writer[c] =
-		 filter_writer_p->open_tilemap( pos_filenames[c], 0 );
+		 filter_writer_p->open_tilemap( &params.image, pos_files[c], 0 );
 	 neg_filter_writer[c] =
-		 filter_writer_p->open_tilemap( neg_filenames[c], 1 );
+		 filter_writer_p->open_tilemap( &params.image, neg_files[c], 1 );
 	 if (pos_filter_writer[c] == NULL || neg_filter_writer[c] == NULL) {
 		 fprintf(stderr,
 				 "%s: Failed to initialize the tile writers.\n",
@@ -646,157 +906,156 @@ main (int argc, char **argv)
     if (histfn != NULL) {
       fprintf(stderr, "[%s] Histogram file: %s\n", program_name, histfn);
     }
-    fprintf(stderr, "[%s] Byte threshold: %u\n", program_name, FThr);
-    fprintf(stderr, "[%s] Summ threshold: %.2f\n", program_name, FThr2);
-    fprintf(stderr, "[%s] Diagonal correlator: %.2f\n", program_name, FDcor);
-    fprintf(stderr, "[%s] Minimum line area: %u\n", program_name, minarea);
-    fprintf(stderr, "[%s] Middle area test: %s\n", program_name, outtest ? "on" : "off");
+    fprintf(stderr, "[%s] Byte threshold: %u\n", program_name, params.tile.FThr);
+    fprintf(stderr, "[%s] Summ threshold: %.2f\n", program_name, params.tile.FThr2);
+    fprintf(stderr, "[%s] Diagonal correlator: %.2f\n", program_name, params.tile.FDcor);
+    fprintf(stderr, "[%s] Minimum line area: %u\n", program_name, params.tile.minarea);
+    fprintf(stderr, "[%s] Middle area test: %s\n", program_name, params.tile.outtest ? "on" : "off");
     if (passthrough_str != NULL) {
       fprintf(stderr, "[%s] Passthrough separations: %s\n", program_name, passthrough_str);
     }
     if (select_mask_str != NULL) {
       fprintf(stderr, "[%s] Selected correction images: %s\n", program_name, select_mask_str);
     }
+    if (sweepfn != NULL) {
+      fprintf(stderr, "[%s] Sweep sets: %lu from %s\n", program_name, (unsigned long) sweep_count, sweepfn);
+    }
+    if (incremental_dir != NULL) {
+      fprintf(stderr, "[%s] Band store: %s, %lu rows per band\n", program_name, incremental_dir, band_rows);
+    }
   }
 
-  /*     . */
-
-  /*       4-  (3), 
-   *  3- ޣ (2). */
-  rd = freadsmp(buf[3]+2*ss, ss, width, stdin, miniswhite);
-  /*    ޣ    
-   * ,      . */
-  if (rd < width) {
-	  fprintf(stderr, "%s: Line 0. Image stream suddenly closed (%i samples has been read)\n", program_name, rd);
-	  exit(EXIT_FAILURE);
-  }
-  /*   ޣ 4-  (3)   
-   * . */
-  edgecpy(buf[3], width, ss);
- 
-  /*      ,   
-   *      5-  (4),   3- ޣ
-   * (2). */
-  if (height > 1) {
-	  rd = freadsmp(buf[4]+2*ss, ss, width, stdin, miniswhite);
-	  /*    ޣ    
-	   * ,      . */
-	  if (rd < width) {
-		  fprintf(stderr, "%s: Line 1. Image stream suddenly closed (%i samples has been read)\n", program_name, rd);
-		  exit(EXIT_FAILURE);
-	  } 
-  }
-  /*   ޣ 5-  (4)   
-   * . */
-  edgecpy(buf[4], width, ss);
-
-  /*  4-  (3) :  3- (2)   (1)   
-   *   . */
-  memcpy(buf[2], buf[3], ss*(width+4));
-  memcpy(buf[1], buf[2], ss*(width+4));
-
-  /*  ޣ    . */
-  for (c = c0; c <= cN; c++)
-	  init_maketiles_info(&mi[c]);
-  
-  /*    .  2   
-   *  ,    3- . */
-  for (y = 2; y < height; y++) {
-	  /*       ,  
-	   *   5-  (4)    
-	   *  (0),     ,  
-	   *  . */
-	  tmpbuf = buf[0];
-	  buf[0] = buf[1];
-	  buf[1] = buf[2];
-	  buf[2] = buf[3];
-	  buf[3] = buf[4];
-	  buf[4] = tmpbuf;
-
-	  rd = freadsmp(buf[4]+2*ss, ss, width, stdin, miniswhite);
-
-	  /*    ޣ    
-	   * ,      . */
-	  if (rd < width) {
-		  fprintf(stderr, "%s: Line %i. Image stream suddenly closed (%i samples has been read)\n", program_name, y, rd);
+  /*   . */
+  if (incremental_dir != NULL) {
+	  get_params_key(params_key, sizeof(params_key));
+	  bstore = bandstore_open(incremental_dir, params_key, width, height,
+							  ss, c0, cN, band_rows);
+	  if (bstore == NULL) {
+		  fprintf(stderr, "%s: Unable to open the band store %s\n", program_name, incremental_dir);
 		  exit(EXIT_FAILURE);
 	  }
+  }
 
-	  /*   ޣ    . */
-	  edgecpy(buf[4], width, ss);	/* Copy edges of the new line */
-
-	  /*       . */
-	  for (c = c0; c <= cN; c++) {
-		  maketiles(buf, outbuf, c0, c, ss, width, filter_writer_p, pos_filter_writer[c], neg_filter_writer[c], &mi[c]);
-	  }
+  /*  ޣ   . */
+  if (want_profile)
+	  profile_start();
 
-	  /*        
-	   *  . */
-	  write_outbuf(outbuf, ss, width);
+  /*    . */
+  memset(&output, 0, sizeof(output));
+  output.writer = filter_writer_p;
+  for (c = c0; c <= cN; c++) {
+	  output.pos_writer[c] = pos_filter_writer[c];
+	  output.neg_writer[c] = neg_filter_writer[c];
+  }
+  /*    ,     
+   *  (--no-output). */
+  output.write_toneline = want_output ? write_toneline : NULL;
+  if (want_profile) {
+	  output.row_begin = profile_row_begin;
+	  output.row_end = profile_row_end;
+  }
+  if (bstore != NULL) {
+	  output.record_row = bandstore_record_row;
+	  output.replay_row = bandstore_replay_row;
+	  output.arg = bstore;
+  }
+  ectx = engrave_open(&params, &output);
+  if (ectx == NULL) {
+	  fprintf(stderr, "%s: Failed to initialize the tile generator.\n", program_name);
+	  exit(EXIT_FAILURE);
   }
   
-  /*       ,   . */
-  if (height == 1)
-	  memcpy(buf[4], buf[3], ss*(width+4));
-
-  /*       . */
-  for (i = 0; i < (height > 1 ? 2 : 1); i++) {
-	  /*   . */
-	  tmpbuf = buf[0];
-	  buf[0] = buf[1];
-	  buf[1] = buf[2];
-	  buf[2] = buf[3];
-	  buf[3] = buf[4];
-	  buf[4] = tmpbuf;
-
-	  /*    ,   
-	   * . */
-	  memcpy(buf[4], buf[3], ss*(width+4));
-	  
-	  /*       . */
-	  for (c = c0; c <= cN; c++) {
-		  maketiles(buf, outbuf, c0, c, ss, width, filter_writer_p, pos_filter_writer[c], neg_filter_writer[c], &mi[c]);
+  if (bstore == NULL) {
+	  /*  :     
+	   *      . */
+	  for (y = 0; y < height; y++) {
+		  read_line(linebuf, ss, y);
+		  engrave_push_lines(ectx, linebuf, 1);
 	  }
-	  /*        
-	   *  . */
-	  write_outbuf(outbuf, ss, width);
+  } else {
+	  /*  :    . 
+	   * ,     , 
+	   *         
+	   *   ţ.      
+	   *  ,    ,
+	   *   . */
+	  nbands = (height + band_rows - 1) / band_rows;
+	  bufrow = 0;
+	  y_read = 0;
+	  y_push = 0;
+	  for (band = 0; band < nbands; band++) {
+		  end = (band + 1) * band_rows + 2;
+		  if (end > height)
+			  end = height;
+		  for (; y_read < end; y_read++)
+			  read_line(linebuf + (y_read - bufrow) * rowsize, ss, y_read);
+
+		  first = band * band_rows >= 2 ? band * band_rows - 2 : 0;
+		  bandstore_hash_band(bstore, band,
+							  linebuf + (first - bufrow) * rowsize,
+							  end - first);
+		  engrave_push_lines(ectx, linebuf + (y_push - bufrow) * rowsize,
+							 end - y_push);
+		  y_push = end;
+
+		  /*    ,    
+		   * . */
+		  first = (band + 1) * band_rows >= 2 ? (band + 1) * band_rows - 2 : 0;
+		  if (band + 1 < nbands && first > bufrow) {
+			  memmove(linebuf, linebuf + (first - bufrow) * rowsize,
+					  (y_read - first) * rowsize);
+			  bufrow = first;
+		  }
+	  }
+  }
+
+  /*        
+   *  . */
+  engrave_close(ectx, stats);
+  ectx = NULL;
+
+  /*      ,   
+   *  . */
+  if (bstore != NULL) {
+	  if (bandstore_close(bstore, 1, &reused, &analysed) != 0)
+		  fprintf(stderr, "%s: Some bands were not saved to %s\n", program_name, incremental_dir);
+	  bstore = NULL;
+	  if (want_verbose)
+		  fprintf(stderr, "[%s] Bands: %lu reused, %lu analysed\n", program_name, reused, analysed);
   }
   
-  /*         
-   *  .     .
-   */
+  /*        . */
   for (c = c0; c <= cN; c++) {
-	  /*  . */
-	  if ( mi[c].pzl ) {
-		  filter_writer_p->write_tile_lines( pos_filter_writer[c], mi[c].pzl );
-	  }
 	  filter_writer_p->close( pos_filter_writer[c] );
 	  pos_filter_writer[c] = NULL;
-	  
-	  if ( mi[c].nzl ) {
-		  filter_writer_p->write_tile_lines( neg_filter_writer[c], mi[c].nzl );
-	  }
 	  filter_writer_p->close( neg_filter_writer[c] );
 	  neg_filter_writer[c] = NULL;
+	  close_layer_file(&pos_files[c], pos_filenames[c]);
+	  close_layer_file(&neg_files[c], neg_filenames[c]);
   }
 
-  /*   ,       . */
+  /*     . */
+  if (want_profile)
+	  profile_report(c0, cN);
+
+  /*   ,       .
+   *       
+   *      . */
   if (histfn != NULL) {
-	  histf = fopen(histfn, "w");
-	  if (histf != NULL) {
-		  fprintf(histf, "#0: %i\n", zerotile);
-		  for (i = 0; i < TILE_COUNT; i++)
-			  fprintf(histf, "#%i: %i\n", i+1, phist[i]);
-		  for (i = 0; i < TILE_COUNT; i++)
-			  fprintf(histf, "#-%i: %i\n", i+1, nhist[i]);
-		  fclose(histf);
-	  } else {
-		  /*       , 
-		   *    . */
-		  fprintf(stderr, "Writing histogram to file %s failedi.\n", histfn);
+	  write_hist(histfn, &stats[0]);
+	  for (i = 1; i <= sweep_count; i++) {
+		  snprintf(sweep_histfn, sizeof(sweep_histfn), "%s.%i", histfn, i);
+		  write_hist(sweep_histfn, &stats[i]);
 	  }
   }
 
+  /*     . */
+  if (sweepfn != NULL) {
+	  sweep_report(0, &params.tile, &stats[0]);
+	  for (i = 1; i <= sweep_count; i++)
+		  sweep_report(i, &sweep[i-1], &stats[i]);
+  }
+
   /*    . */
   OK = 1;
   
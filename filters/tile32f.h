@@ -40,6 +40,7 @@
  * . */
 
 #include "system.h"
+#include "libengrave.h"
 
 /*  --   . */
 #define TILE_NL 1
@@ -63,9 +64,6 @@
 #define TILE_SEC 19
 #define TILE_SWC 20
 
-/*    . */
-#define TILE_COUNT 20
-
 /*  . */
 
 #define AE 7
@@ -107,7 +105,8 @@
 #define F1 *pF1
 
 /*      ޣ    
- *  ޣ . */
+ *  ޣ .  16-  
+ *     ޣ. */
 typedef unsigned char *t_window[5][5];
 
 /*  ޣ    ,   
@@ -120,40 +119,39 @@ struct maketiles_info {
 };
 
 
-/*   . */
-
-/*       . */
-extern int outtest;
-
-/*    ޣ (0 - 255). */
-extern unsigned char FThr;
-
-/*     ޣ (0 - 3*255). */
-extern double FThr2;
-
-/*      ޣ. */
-extern double FDcor;
-
-/*   . */
-extern unsigned char minarea;
+/*        ޣ: 
+ *   ޣ  8-      
+ * .     ޣ,    
+ *      . */
+struct tile32_sums {
+	/*  ޣ  --   ,  ޣ
+	 * () --  ޣ,    
+	 * . */
+	int S[8];
+
+	/*       (8- 
+	 * 16-). */
+	unsigned short wmax;
+	unsigned short wmin;
+};
 
 /*  . */
 
-void setOutSens(int value);
-int getOutSens();
-void setFThr(unsigned char value);
-unsigned char getFThr();
-void setFThr2(double value);
-double getFThr2();
-void setFDCor(double value);
-double getFDCor();
 void set_qMethod(int value);
 int get_qMethod();
-void set_too_thin_line(unsigned char value);
-unsigned char get_too_thin_line();
 
+void init_tile32_params(struct tile32_params *params);
 void edgecpy(char *buf, size_t width, size_t ss);
 void init_maketiles_info(struct maketiles_info *mi);
 
-void get_tile(t_window window, int *neg, int *tile_index, unsigned char *tile_area, unsigned char *bg_value);
+void get_tile(const struct tile32_params *params, t_window window, int *neg, int *tile_index, unsigned char *tile_area, unsigned char *bg_value);
+void get_window_sums(t_window window, struct tile32_sums *sums);
+void get_tile_sums(const struct tile32_params *params, t_window window, const struct tile32_sums *sums, int *neg, int *tile_index, unsigned char *tile_area, unsigned char *bg_value);
+
+/*    16- ޣ:    
+ * ޣ  unsigned short,     
+ *  0 - 255  ,   --   0 - 255. */
+void get_tile16(const struct tile32_params *params, t_window window, int *neg, int *tile_index, unsigned char *tile_area, unsigned short *bg_value);
+void get_window_sums16(t_window window, struct tile32_sums *sums);
+void get_tile_sums16(const struct tile32_params *params, t_window window, const struct tile32_sums *sums, int *neg, int *tile_index, unsigned char *tile_area, unsigned short *bg_value);
 
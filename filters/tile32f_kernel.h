@@ -0,0 +1,555 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*    ޣ,   ޣ.
+ *
+ *     :   
+ * tile32f.c     ޣ, ޣ 
+ *     :
+ *
+ *   SAMPLE       --  ޣ (unsigned char, unsigned short);
+ *   SAMPLE_MAX   --   ޣ;
+ *   KERNEL(name) --      ޣ.
+ *
+ *      8- ޣ (0 - 255) 
+ *   SAMPLE_SCALE.    
+ *    0 - 255.   bg_mask  
+ *      ޣ.  
+ *  .
+ */
+
+/*  . */
+#define SAMPLE_SCALE (SAMPLE_MAX / 255)
+
+/*  ޣ   . */
+#undef A
+#define A (*(const SAMPLE *) pA)
+#undef B
+#define B (*(const SAMPLE *) pB)
+#undef C
+#define C (*(const SAMPLE *) pC)
+#undef D
+#define D (*(const SAMPLE *) pD)
+#undef E
+#define E (*(const SAMPLE *) pE)
+#undef F
+#define F (*(const SAMPLE *) pF)
+#undef G
+#define G (*(const SAMPLE *) pG)
+#undef H
+#define H (*(const SAMPLE *) pH)
+#undef I
+#define I (*(const SAMPLE *) pI)
+#undef B1
+#define B1 (*(const SAMPLE *) pB1)
+#undef D1
+#define D1 (*(const SAMPLE *) pD1)
+#undef H1
+#define H1 (*(const SAMPLE *) pH1)
+#undef F1
+#define F1 (*(const SAMPLE *) pF1)
+
+/*        :
+ *     8-      
+ * . */
+void KERNEL(get_window_sums)(t_window window, struct tile32_sums *sums) {
+
+  SAMPLE res;
+
+  sums->S[0] = D + E + F - A - B - C;
+  sums->S[1] = A + E + I;
+  sums->S[2] = B + E + H - C - F - I;
+  sums->S[3] = C + E + G;
+  sums->S[4] = D + E + F - G - H - I;
+  sums->S[5] = A + E + I;
+  sums->S[6] = B + E + H - A - D - G;
+  sums->S[7] = C + E + G;
+
+  res = 0;
+  if (A > res)
+    res = A;
+  if (B > res)
+    res = B;
+  if (C > res)
+    res = C;
+  if (D > res)
+    res = D;
+  if (E > res)
+    res = E;
+  if (F > res)
+    res = F;
+  if (G > res)
+    res = G;
+  if (H > res)
+    res = H;
+  if (I > res)
+    res = I;
+  sums->wmax = res;
+
+  res = SAMPLE_MAX;
+  if (A < res)
+    res = A;
+  if (B < res)
+    res = B;
+  if (C < res)
+    res = C;
+  if (D < res)
+    res = D;
+  if (E < res)
+    res = E;
+  if (F < res)
+    res = F;
+  if (G < res)
+    res = G;
+  if (H < res)
+    res = H;
+  if (I < res)
+    res = I;
+  sums->wmin = res;
+
+}
+
+/*  :    
+ *  ޣ . */
+SAMPLE KERNEL(max)(t_window window, const struct tile32_sums *sums, int FThr) {
+			
+  SAMPLE res = sums->wmax;
+			
+  if ((res - E) < FThr)
+    res = E;
+  if ((SAMPLE_MAX - res) < FThr)
+    res = SAMPLE_MAX;
+
+  return res;
+			
+}
+		
+/*  :    
+ *  ޣ . */
+SAMPLE KERNEL(min)(t_window window, const struct tile32_sums *sums, int FThr) {
+
+  SAMPLE res = sums->wmin;
+			
+  if ((E - res)<FThr)
+    res = E;
+  if (res < FThr)
+    res = 0;
+
+  return res;
+}
+
+/*        
+ * .   ޣ,   . */
+int KERNEL(get_tile_index)(const struct tile32_params *params, t_window window, const struct tile32_sums *sums, int *negfig, int *inverse) {
+
+	/*   , ģ   ޣ. */
+	const int FThr = params->FThr * SAMPLE_SCALE;
+	const double FThr2 = params->FThr2 * SAMPLE_SCALE;
+	const double FDcor = params->FDcor;
+
+	/*   ޣ  8- . */
+	double V[8];
+
+	/*     . */
+	int m;
+
+	/*    ޣ  . */
+	double ks;
+
+	/*  . */
+
+	/*    .  
+	 *    . */
+	int equ(int i1, int i2) {
+		if ((V[i1] > 0 && V[i2] < 0) || (V[i1] < 0 && V[i2] > 0))
+			return 0;
+		else
+		  if ((fabs(V[i1]) < FThr2 && fabs(V[i2]) > FThr2) || (fabs(V[i1]) > FThr2 && fabs(V[i2]) < FThr2))
+				return 0;
+			else
+				if (fabs( fabs(V[i1]) - fabs(V[i2]) ) < FThr2)
+					return 1;
+				else
+					return 0;
+	}
+
+	/* ,    
+	 *  .
+	 *//*
+	int iscodir(int i1, int i2) {
+	  if (V[i1] > 0 && V[i2] < 0) {
+	    return 1;
+	  }
+	  if (V[i1] < 0 && V[i2] > 0) {
+	    return 1;
+	  }
+	  return 0;
+	  }*/
+
+	/*   ,    
+	 *  ,  -- .
+	 *//*
+	int codir(int i1, int i2, int t1, int t2) {
+	  if (iscodir(i1, i2)) {
+	    return t1;
+	  } else {
+	    return t2;
+	  }
+	  }*/
+
+	/*  ,     
+	 *      
+	 * . */
+	int bGZ(SAMPLE s1, SAMPLE s2) {
+		return ((s1-E) > FThr && (s2-E) > FThr);
+	}
+
+	/*  ,     
+	 *     
+	 *   . */
+	int bLZ(SAMPLE s1, SAMPLE s2) {
+		return ( (s1-E) < -FThr && (s2-E) < -FThr);
+	}
+
+	/*    ޣ  ޣ . */
+	int equByte(SAMPLE s1, SAMPLE s2) {
+		return (abs(s1-s2) < FThr);
+	}
+
+	/*     ޣ . */
+	int tsign(int dif) {
+	  if (dif < -FThr)
+	    return -1;
+	  else if (dif > FThr)
+	    return 1;
+	  else
+	    return 0;
+	}
+
+	/*      
+	 * . */
+	int COut(int m) {
+		/*    . */
+		if (equByte(E,D) && equByte(E,B)) {
+			if (!equByte(E,F) && tsign(E-F) > 0 && tsign(D-D1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,F) && tsign(E-F) < 0 && tsign(D-D1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else if (!equByte(E,H) && tsign(E-H) > 0 && tsign(B-B1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,H) && tsign(E-H) < 0 && tsign(B-B1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else {
+				return 1;
+			}
+		}
+
+		if (equByte(E,F) && equByte(E,B)) {
+			if (!equByte(E,D) && tsign(E-D) > 0 && tsign(F-F1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,D) && tsign(E-D) < 0 && tsign(F-F1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else if (!equByte(E,H) && tsign(E-H) > 0 && tsign(B-B1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,H) && tsign(E-H) < 0 && tsign(B-B1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else {
+				return 1;
+			}
+		}
+
+		if (equByte(E,F) && equByte(E,H)) {
+			if (!equByte(E,D) && tsign(E-D) > 0 && tsign(F-F1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,D) && tsign(E-D) < 0 && tsign(F-F1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else if (!equByte(E,B) && tsign(E-B) > 0 && tsign(H-H1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,B) && tsign(E-B) < 0 && tsign(H-H1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else {
+				return 1;
+			}
+		}
+
+		if (equByte(E,D) && equByte(E,H) && m != CE) {
+			if (!equByte(E,F) && tsign(E-F) > 0 && tsign(D-D1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,F) && tsign(E-F) < 0 && tsign(D-D1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else if (!equByte(E,B) && tsign(E-B) > 0 && tsign(H-H1) > 0) {
+				*negfig = 1;
+				return 0;
+			} else if (!equByte(E,B) && tsign(E-B) < 0 &&  tsign(H-H1) < 0) {
+				*negfig = 0;
+				return 0;
+			} else {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	/*   . */
+	int identify(
+		     int dir,
+		     int opposite,
+		     SAMPLE ortvalue1,
+		     SAMPLE ortvalue2,
+		     SAMPLE oppvalue,
+		     int thinline,
+		     int dirside,
+		     int oppositeside,
+		     int dircorner,
+		     int oppositecorner
+	)
+	{
+
+	  if (equ(dir, opposite)) {
+	    /*     
+	     * . */
+	    *negfig = (V[m] > 0);
+	    *inverse = *negfig;
+	    return thinline;
+	  } else if (bGZ(ortvalue1, ortvalue2)) {
+	    /*     . */
+	    *negfig = 0;
+	    *inverse = 0;
+	    if (V[m] > 0) {
+	      return dircorner;
+	    } else {
+	      return oppositecorner;
+	    }
+	  } else if (bLZ(ortvalue1,ortvalue2)) {
+	    /*     . */
+	    *negfig = 1;
+	    *inverse = 1;
+	    if (V[m] > 0) {
+	      return oppositecorner;
+	    } else {
+	      return dircorner;
+	    }
+	  } else {
+	    *negfig = (V[m] < 0) && oppvalue <= 128 * SAMPLE_SCALE;
+	    *inverse = *negfig;
+	    if (V[m] < 0) {
+	      if (*negfig) {
+		return dirside;
+	      } else {
+		return oppositeside;
+	      }
+	    } else {
+	      if (*negfig) {
+		return oppositeside;
+	      } else {
+		return dirside;
+	      }
+	    }
+	  }
+	}
+
+	/*   . */
+
+	/*    ޣ  8- 
+	 * . */
+
+	ks = (double)(3-FDcor)/2;
+	V[0] = sums->S[0];
+	V[1] = sums->S[1] - B*ks - C*FDcor - F*ks;
+	V[2] = sums->S[2];
+	V[3] = sums->S[3] - F*ks - I*FDcor - H*ks;
+	V[4] = sums->S[4];
+	V[5] = sums->S[5] - D*ks - G*FDcor - H*ks;
+	V[6] = sums->S[6];
+	V[7] = sums->S[7] - B*ks - A*FDcor - D*ks;
+
+	/*     . */
+	m = amax(V, FThr2);
+
+	/*       
+	 * ,    ,   
+	 *  ,     
+	 * 0,   . */
+	if (params->outtest && COut(m)) {
+	  return 0;
+	}
+
+	/* ,        
+	 *     ,  
+	 *     
+	 *  . */
+	  switch  (m) {
+		  case FE:
+		    return identify(
+				    FE, DE, B, H, D,
+			     TILE_NL, TILE_ES, TILE_WS, TILE_EC, TILE_WC
+		    );
+
+		  case HE:
+		    return identify(
+				    HE, BE, D, F, B,
+			     TILE_WL, TILE_SS, TILE_NS, TILE_SC, TILE_NC
+		    );
+
+		  case IE:
+		    return identify(
+				    IE, AE, C, G, A,
+			     TILE_NEL, TILE_SES, TILE_NWS, TILE_SEC, TILE_NWC
+		    );
+  
+		  case GE:
+		    return identify(
+				    GE, CE, A, I, C,
+			     TILE_NWL, TILE_SWS, TILE_NES, TILE_SWC, TILE_NEC
+		    );
+
+		  case DE:
+		    return identify(
+				    DE, FE, B, H, F,
+			     TILE_NL, TILE_WS, TILE_ES, TILE_WC, TILE_EC
+		    );
+
+		  case AE:
+		    return identify(
+				    AE, IE, G, C, I,
+			     TILE_NEL, TILE_NWS, TILE_SES, TILE_NWC, TILE_SEC
+		    );
+
+		  case BE:
+		    return identify(
+				    BE, HE, D, F, H,
+			     TILE_WL, TILE_NS, TILE_SS, TILE_NC, TILE_SC
+		    );
+
+		  case CE:
+		    return identify(
+				    CE, GE, A, I, G,
+			     TILE_NWL, TILE_NES, TILE_SWS, TILE_NEC, TILE_SWC
+		    );
+
+		  default :
+			  return 0;
+	  }
+}
+
+/*       . 
+ *  ,   ,    
+ *      (). */
+void KERNEL(get_tile)(const struct tile32_params *params, t_window window, int *neg, int *tile_index, unsigned char *tile_area, SAMPLE *bg_value) {
+
+	/*  ,    . */
+	struct tile32_sums sums;
+
+	KERNEL(get_window_sums)(window, &sums);
+	KERNEL(get_tile_sums)(params, window, &sums, neg, tile_index, tile_area, bg_value);
+
+}
+
+/*  ,   get_tile(),     
+ *  #sums. */
+void KERNEL(get_tile_sums)(const struct tile32_params *params, t_window window, const struct tile32_sums *sums, int *neg, int *tile_index, unsigned char *tile_area, SAMPLE *bg_value) {
+	
+	/*   . */
+	unsigned char index;
+
+	/*  . */
+	int inverse;
+	
+	/*    . */
+	void get_area() {
+
+		/*     . */
+		SAMPLE m;
+
+		/*        
+		 *       . ޣ
+		 *  . */
+		if (!inverse) {
+		  m = KERNEL(max)(window, sums, params->FThr * SAMPLE_SCALE);
+		  *bg_value = m ^ params->bg_mask;
+		  *tile_area = (unsigned char) rint( 255.0 * ( (double)((SAMPLE_MAX-E) - (SAMPLE_MAX-m)) / (SAMPLE_MAX - (SAMPLE_MAX-m)) ) );
+		} else {
+		  m = KERNEL(min)(window, sums, params->FThr * SAMPLE_SCALE);
+		  *bg_value = m ^ params->bg_mask;
+		  *tile_area = (unsigned char) rint( 255.0 * ( (double)((SAMPLE_MAX-m) - (SAMPLE_MAX-E)) / (SAMPLE_MAX-m) ) ) ;
+		}
+	}
+
+	/*         
+	 * . */
+	index = KERNEL(get_tile_index)(params, window, sums, neg, &inverse);
+	
+	/*       , 
+	 *       . 
+	 *     ޣ  . */
+	if (index) {
+		get_area();
+		/*        ,
+		 *      . */
+		if (*tile_area == 0 || too_thin(*tile_index, *tile_area, params->minarea)) {
+		  *tile_index = 0;
+		  *bg_value = E ^ params->bg_mask;
+		} else {
+		  *tile_index = index;
+		}
+	} else {
+		/*      . */
+		*tile_index = 0;
+		*tile_area = 0;
+		*bg_value = E ^ params->bg_mask;
+	}
+}
+
+#undef SAMPLE_SCALE
+#undef SAMPLE
+#undef SAMPLE_MAX
+#undef KERNEL
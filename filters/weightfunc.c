@@ -39,8 +39,13 @@
 
 #include <string.h>
 #include <stdio.h>
+#include "system.h"
 #include "weightfunc.h"
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 /**
  *    .
  */
@@ -154,15 +159,11 @@ static void copyweightfunc( unsigned char *dest,
 							int rotation );
 
 /**
- *    .
+ *    .
  */
-void
-weightfuncs_init ()
+static void
+weightfuncs_fill ()
 {
-	static int initialized = 0;
-
-	if ( initialized ) return;
-	
 	copyweightfunc( weightfuncs[TILE_NL - 1],  ortline,     0   );
 	copyweightfunc( weightfuncs[TILE_WL - 1],  ortline,    -90  );
 	copyweightfunc( weightfuncs[TILE_NWL - 1], dialine,     0   );
@@ -183,8 +184,26 @@ weightfuncs_init ()
 	copyweightfunc( weightfuncs[TILE_NEC - 1], ortcorner,  -90  );
 	copyweightfunc( weightfuncs[TILE_SEC - 1], ortcorner,  180  );
 	copyweightfunc( weightfuncs[TILE_SWC - 1], ortcorner,   90  );
+}
 
+/**
+ *    .  
+ *  ,        .
+ */
+void
+weightfuncs_init ()
+{
+#ifdef HAVE_PTHREAD_H
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once( &once, weightfuncs_fill );
+#else
+	static int initialized = 0;
+
+	if ( initialized ) return;
+	weightfuncs_fill();
 	initialized = 1;
+#endif
 }
 
 /**
@@ -0,0 +1,714 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*     . */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "aout.h"
+
+#if defined(HAVE_FOPENCOOKIE) && defined(HAVE_PWRITE)
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && \
+	defined(IORING_FEAT_SINGLE_MMAP)
+#define AOUT_URING 1
+#endif
+
+/**
+ *  .
+ */
+struct aout_buf {
+	char *data;		/* . */
+	size_t len;		/* ߣ . */
+	off_t off;		/*    . */
+	int busy;		/*   . */
+};
+
+#ifdef AOUT_URING
+/**
+ *  io_uring, ֣   .
+ */
+struct aout_ring {
+	int fd;
+	void *ring;		/*    . */
+	size_t ring_size;
+	struct io_uring_sqe *sqes;	/* . */
+	size_t sqes_size;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;	/* . */
+};
+#endif
+
+/**
+ *    .
+ */
+struct aout {
+	int fd;
+	off_t pos;				/*  . */
+	off_t size;				/*  . */
+	struct aout_buf *bufs;	/*  . */
+	int nbufs;
+	struct aout_buf *cur;	/*  . */
+	int inflight;			/*   . */
+	int error;				/*    . */
+#ifdef AOUT_URING
+	struct aout_ring ring;
+	int uring;				/*    io_uring. */
+#endif
+};
+
+/**
+ *  #len   #data   #off  pwrite().
+ *  0   .
+ */
+static int
+aout_pwrite( int fd, const char *data, size_t len, off_t off )
+{
+	ssize_t wt;
+
+	while ( len > 0 ) {
+		wt = pwrite( fd, data, len, off );
+		if ( wt < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+		data += wt;
+		len -= wt;
+		off += wt;
+	}
+
+	return 0;
+}
+
+#ifdef AOUT_URING
+/**
+ *   io_uring  #depth   
+ *  #o.  0   .
+ */
+static int
+aout_ring_init( struct aout *o, int depth )
+{
+	struct aout_ring *r = &o->ring;
+	struct io_uring_params p;
+	struct iovec *iov;
+	size_t sq_size, cq_size;
+	char *ring;
+	int i, ret;
+
+	memset( &p, 0, sizeof(p) );
+	r->fd = syscall( __NR_io_uring_setup, depth, &p );
+	if ( r->fd < 0 )
+		return -1;
+
+	/*       . */
+	sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if ( !(p.features & IORING_FEAT_SINGLE_MMAP) ) {
+		close( r->fd );
+		return -1;
+	}
+	r->ring_size = sq_size > cq_size ? sq_size : cq_size;
+	r->ring = mmap( NULL, r->ring_size, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING );
+	if ( r->ring == MAP_FAILED ) {
+		close( r->fd );
+		return -1;
+	}
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap( NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES );
+	if ( r->sqes == MAP_FAILED ) {
+		munmap( r->ring, r->ring_size );
+		close( r->fd );
+		return -1;
+	}
+
+	ring = r->ring;
+	r->sq_head = (unsigned *) (ring + p.sq_off.head);
+	r->sq_tail = (unsigned *) (ring + p.sq_off.tail);
+	r->sq_mask = (unsigned *) (ring + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *) (ring + p.sq_off.array);
+	r->cq_head = (unsigned *) (ring + p.cq_off.head);
+	r->cq_tail = (unsigned *) (ring + p.cq_off.tail);
+	r->cq_mask = (unsigned *) (ring + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+
+	/*   . */
+	iov = calloc( o->nbufs, sizeof(*iov) );
+	ret = -1;
+	if ( iov != NULL ) {
+		for ( i = 0; i < o->nbufs; i++ ) {
+			iov[i].iov_base = o->bufs[i].data;
+			iov[i].iov_len = AOUT_BUFSIZE;
+		}
+		ret = syscall( __NR_io_uring_register, r->fd,
+					   IORING_REGISTER_BUFFERS, iov, o->nbufs );
+		free( iov );
+	}
+	if ( ret < 0 ) {
+		munmap( r->sqes, r->sqes_size );
+		munmap( r->ring, r->ring_size );
+		close( r->fd );
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ *   io_uring.
+ */
+static void
+aout_ring_free( struct aout_ring *r )
+{
+	munmap( r->sqes, r->sqes_size );
+	munmap( r->ring, r->ring_size );
+	close( r->fd );
+}
+
+/**
+ *  ۣ    #o.
+ */
+static void
+aout_ring_reap( struct aout *o )
+{
+	struct aout_ring *r = &o->ring;
+	struct io_uring_cqe *cqe;
+	struct aout_buf *b;
+	unsigned head, tail;
+
+	head = *r->cq_head;
+	tail = __atomic_load_n( r->cq_tail, __ATOMIC_ACQUIRE );
+	while ( head != tail ) {
+		cqe = &r->cqes[head & *r->cq_mask];
+		b = &o->bufs[cqe->user_data];
+		if ( cqe->res < 0 ) {
+			if ( !o->error ) o->error = -cqe->res;
+		} else if ( (size_t) cqe->res < b->len ) {
+			/*    . */
+			if ( aout_pwrite( o->fd, b->data + cqe->res, b->len - cqe->res,
+							  b->off + cqe->res ) != 0 && !o->error )
+				o->error = errno;
+		}
+		b->busy = 0;
+		o->inflight--;
+		head++;
+	}
+	__atomic_store_n( r->cq_head, head, __ATOMIC_RELEASE );
+}
+
+/**
+ *         #o.
+ *  0     -1,    
+ *  ;      .
+ */
+static int
+aout_ring_wait( struct aout *o )
+{
+	int ret;
+
+	do {
+		ret = syscall( __NR_io_uring_enter, o->ring.fd, 0, 1,
+					   IORING_ENTER_GETEVENTS, NULL, 0 );
+	} while ( ret < 0 && errno == EINTR );
+	if ( ret < 0 )
+		return -1;
+	aout_ring_reap( o );
+
+	return 0;
+}
+
+/**
+ *   #o    pwrite(): 
+ *      . ,
+ *      ,  ݣ 
+ * :         ,
+ *      .
+ */
+static void
+aout_ring_stop( struct aout *o )
+{
+	while ( o->inflight > 0 )
+		if ( aout_ring_wait( o ) != 0 ) {
+			if ( !o->error ) o->error = errno;
+			break;
+		}
+	aout_ring_free( &o->ring );
+	o->uring = 0;
+}
+
+/**
+ *       #b  #o.  0
+ *   .
+ */
+static int
+aout_ring_submit( struct aout *o, struct aout_buf *b )
+{
+	struct aout_ring *r = &o->ring;
+	struct io_uring_sqe *sqe;
+	unsigned tail, idx;
+	int ret;
+
+	tail = *r->sq_tail;
+	idx = tail & *r->sq_mask;
+	sqe = &r->sqes[idx];
+	memset( sqe, 0, sizeof(*sqe) );
+	sqe->opcode = IORING_OP_WRITE_FIXED;
+	sqe->fd = o->fd;
+	sqe->addr = (unsigned long) b->data;
+	sqe->len = b->len;
+	sqe->off = b->off;
+	sqe->buf_index = b - o->bufs;
+	sqe->user_data = b - o->bufs;
+	r->sq_array[idx] = idx;
+	__atomic_store_n( r->sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+	do {
+		ret = syscall( __NR_io_uring_enter, r->fd, 1, 0, 0, NULL, 0 );
+	} while ( ret < 0 && errno == EINTR );
+	if ( ret > 0 )
+		return 0;
+
+	/* ,   ,  ۣ  .  
+	 *  ,      
+	 * io_uring_enter()    . */
+	if ( __atomic_load_n( r->sq_head, __ATOMIC_ACQUIRE ) != tail )
+		return 0;
+	__atomic_store_n( r->sq_tail, tail, __ATOMIC_RELEASE );
+
+	return -1;
+}
+#endif /* AOUT_URING */
+
+/**
+ *     #o  .
+ */
+static void
+aout_submit( struct aout *o )
+{
+	struct aout_buf *b = o->cur;
+
+	o->cur = NULL;
+	if ( b == NULL || b->len == 0 )
+		return;
+
+#ifdef AOUT_URING
+	if ( o->uring ) {
+		b->busy = 1;
+		o->inflight++;
+		if ( aout_ring_submit( o, b ) == 0 )
+			return;
+		/*   :    
+		 *  ,    , 
+		 * . */
+		b->busy = 0;
+		o->inflight--;
+		aout_ring_stop( o );
+	}
+#endif
+
+	if ( aout_pwrite( o->fd, b->data, b->len, b->off ) != 0 && !o->error )
+		o->error = errno;
+}
+
+/**
+ *       #o.
+ */
+static void
+aout_drain( struct aout *o )
+{
+#ifdef AOUT_URING
+	while ( o->uring && o->inflight > 0 )
+		if ( aout_ring_wait( o ) != 0 )
+			aout_ring_stop( o );
+#endif
+}
+
+/**
+ *     #o,   ,
+ *    .  NULL,  
+ *     .
+ */
+static struct aout_buf *
+aout_get_buf( struct aout *o )
+{
+	int i;
+
+	for (;;) {
+		for ( i = 0; i < o->nbufs; i++ )
+			if ( !o->bufs[i].busy )
+				return &o->bufs[i];
+#ifdef AOUT_URING
+		if ( o->uring && aout_ring_wait( o ) == 0 )
+			continue;
+		if ( o->uring )
+			aout_ring_stop( o );
+#endif
+		return NULL;
+	}
+}
+
+/**
+ *  #len   #data     #o.
+ *    :     #len
+ * ( fopencookie()    ).
+ */
+static ssize_t
+aout_write( void *cookie, const char *data, size_t len )
+{
+	struct aout *o = cookie;
+	size_t n, left = len;
+
+	while ( left > 0 ) {
+		if ( o->error ) {
+			errno = o->error;
+			break;
+		}
+		if ( o->cur != NULL && o->cur->len == AOUT_BUFSIZE )
+			aout_submit( o );
+		if ( o->cur == NULL ) {
+			o->cur = aout_get_buf( o );
+			if ( o->cur == NULL ) {
+				if ( !o->error ) o->error = EIO;
+				continue;
+			}
+			o->cur->off = o->pos;
+			o->cur->len = 0;
+		}
+		n = AOUT_BUFSIZE - o->cur->len;
+		if ( n > left ) n = left;
+		memcpy( o->cur->data + o->cur->len, data, n );
+		o->cur->len += n;
+		o->pos += n;
+		data += n;
+		left -= n;
+	}
+	if ( o->pos > o->size )
+		o->size = o->pos;
+
+	return len - left;
+}
+
+/**
+ *  #len      #o  #data. 
+ *  .
+ */
+static ssize_t
+aout_read( void *cookie, char *data, size_t len )
+{
+	struct aout *o = cookie;
+	ssize_t rd;
+
+	aout_submit( o );
+	aout_drain( o );
+	rd = pread( o->fd, data, len, o->pos );
+	if ( rd > 0 )
+		o->pos += rd;
+
+	return rd;
+}
+
+/**
+ *     #o.   
+ *     ,   
+ * ,      
+ * .
+ */
+static int
+aout_seek( void *cookie, off64_t *offset, int whence )
+{
+	struct aout *o = cookie;
+	off_t pos;
+
+	switch ( whence ) {
+	case SEEK_SET:
+		pos = *offset;
+		break;
+	case SEEK_CUR:
+		pos = o->pos + *offset;
+		break;
+	case SEEK_END:
+		pos = o->size + *offset;
+		break;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+	if ( pos < 0 ) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ( pos != o->pos ) {
+		aout_submit( o );
+		aout_drain( o );
+		o->pos = pos;
+	}
+	*offset = pos;
+
+	return 0;
+}
+
+/**
+ *    #o,    .
+ */
+static void
+destroy_aout( struct aout *o )
+{
+	int i;
+
+	/*    ݣ   (. aout_ring_stop()). */
+	for ( i = 0; i < o->nbufs; i++ )
+		if ( !o->bufs[i].busy )
+			free( o->bufs[i].data );
+	free( o->bufs );
+	free( o );
+}
+
+/**
+ *       #o. 
+ * -1,     .
+ */
+static int
+aout_close( void *cookie )
+{
+	struct aout *o = cookie;
+	int error;
+
+	aout_submit( o );
+	aout_drain( o );
+#ifdef AOUT_URING
+	if ( o->uring )
+		aout_ring_free( &o->ring );
+#endif
+	if ( close( o->fd ) != 0 && !o->error )
+		o->error = errno;
+
+	error = o->error;
+	destroy_aout( o );
+	if ( error ) {
+		errno = error;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ *   #path   ( ,   
+ * #rw)    #depth .  NULL   .
+ */
+static struct aout *
+aout_open( const char *path, int rw, int depth )
+{
+	struct aout *o;
+	int i;
+
+	o = calloc( 1, sizeof(*o) );
+	if ( o == NULL ) return NULL;
+
+	o->bufs = calloc( depth, sizeof(*o->bufs) );
+	if ( o->bufs == NULL ) {
+		free( o );
+		return NULL;
+	}
+	o->nbufs = depth;
+	for ( i = 0; i < depth; i++ ) {
+		o->bufs[i].data = malloc( AOUT_BUFSIZE );
+		if ( o->bufs[i].data == NULL ) {
+			destroy_aout( o );
+			return NULL;
+		}
+	}
+
+	o->fd = open( path, (rw ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC, 0666 );
+	if ( o->fd < 0 ) {
+		destroy_aout( o );
+		return NULL;
+	}
+
+#ifdef AOUT_URING
+	o->uring = aout_ring_init( o, depth ) == 0;
+#endif
+
+	return o;
+}
+
+/**
+ *   #path     #mode ( fopen())
+ *    #depth .  #depth  0   
+ *    ,   
+ * fopen().      .
+ */
+FILE *
+aout_fopen( const char *path, const char *mode, int depth )
+{
+	cookie_io_functions_t io = {
+		.read = aout_read,
+		.write = aout_write,
+		.seek = aout_seek,
+		.close = aout_close
+	};
+	struct aout *o;
+	FILE *f;
+
+	/*       . */
+	if ( depth <= 0 || mode[0] != 'w' )
+		return fopen( path, mode );
+
+	o = aout_open( path, strchr( mode, '+' ) != NULL, depth );
+	if ( o == NULL ) return NULL;
+
+	f = fopencookie( o, mode, io );
+	if ( f == NULL ) {
+		aout_close( o );
+		return NULL;
+	}
+
+	return f;
+}
+
+/**
+ *  - libtiff     .
+ */
+static tmsize_t
+aout_tiff_read( thandle_t h, void *buf, tmsize_t size )
+{
+	return aout_read( h, buf, size );
+}
+
+static tmsize_t
+aout_tiff_write( thandle_t h, void *buf, tmsize_t size )
+{
+	return aout_write( h, buf, size );
+}
+
+static toff_t
+aout_tiff_seek( thandle_t h, toff_t off, int whence )
+{
+	off64_t pos = (off64_t) off;
+
+	if ( aout_seek( h, &pos, whence ) != 0 )
+		return (toff_t) -1;
+
+	return (toff_t) pos;
+}
+
+static int
+aout_tiff_close( thandle_t h )
+{
+	return aout_close( h );
+}
+
+static toff_t
+aout_tiff_size( thandle_t h )
+{
+	return ((struct aout *) h)->size;
+}
+
+static int
+aout_tiff_map( thandle_t h, void **base, toff_t *size )
+{
+	return 0;
+}
+
+static void
+aout_tiff_unmap( thandle_t h, void *base, toff_t size )
+{
+}
+
+/**
+ *   TIFF #path      #depth .
+ *  #depth  0     , 
+ *   TIFFOpen().
+ */
+TIFF *
+aout_tiffopen( const char *path, int depth )
+{
+	struct aout *o;
+	TIFF *tif;
+
+	if ( depth <= 0 )
+		return TIFFOpen( path, "w" );
+
+	/* libtiff    :   
+	 *   . */
+	o = aout_open( path, 1, depth );
+	if ( o == NULL ) return NULL;
+
+	tif = TIFFClientOpen( path, "w", (thandle_t) o,
+						  aout_tiff_read, aout_tiff_write, aout_tiff_seek,
+						  aout_tiff_close, aout_tiff_size,
+						  aout_tiff_map, aout_tiff_unmap );
+	if ( tif == NULL )
+		aout_close( o );
+
+	return tif;
+}
+
+#else /* HAVE_FOPENCOOKIE && HAVE_PWRITE */
+
+/*      - 
+ *   . */
+
+FILE *
+aout_fopen( const char *path, const char *mode, int depth )
+{
+	return fopen( path, mode );
+}
+
+TIFF *
+aout_tiffopen( const char *path, int depth )
+{
+	return TIFFOpen( path, "w" );
+}
+
+#endif /* HAVE_FOPENCOOKIE && HAVE_PWRITE */
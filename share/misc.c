@@ -38,8 +38,15 @@
 
 /*   . */
 
+/*  F_SETPIPE_SZ. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <sys/types.h>
+#include <limits.h>
+#include <stdint.h>
 #include "system.h"
 #include "misc.h"
 
@@ -339,3 +346,95 @@ size_t fwritesmp(void *buf, size_t ss, size_t count, FILE *stream, int neg, void
 
 }
 
+/*      .  
+ *  #rows   ( 0),    ,  ߣ
+ *    #count ޣ  #ss    
+ * SMP_BATCH_BYTES.      #height (
+ *  ),   ߣ     size_t.
+ */
+size_t smp_batch_rows(size_t ss, size_t count, size_t height, size_t rows) {
+
+	size_t linesize = ss*count;
+
+	if (rows == 0) {
+		if (linesize == 0 || linesize >= SMP_BATCH_BYTES)
+			rows = 1;
+		else
+			rows = SMP_BATCH_BYTES / linesize;
+	}
+
+	if (height > 0 && rows > height)
+		rows = height;
+	if (linesize > 0 && rows > SIZE_MAX / linesize)
+		rows = SIZE_MAX / linesize;
+
+	return rows;
+
+}
+
+/*        
+ * ߣ #bytes:     ,   
+ * ,  ,    
+ * .        .
+ *     ,   
+ *   ,  NULL,     Σ.
+ */
+void *set_smp_transport(FILE *stream, size_t bytes) {
+
+	void *vbuf;
+#ifdef F_SETPIPE_SZ
+	struct stat st;
+
+	/*       :
+	 *      . */
+	if (fstat(fileno(stream), &st) == 0 && S_ISFIFO(st.st_mode) &&
+		bytes <= INT_MAX)
+		fcntl(fileno(stream), F_SETPIPE_SZ, (int) bytes);
+#endif
+
+	if (bytes <= BUFSIZ)
+		return NULL;
+
+	vbuf = malloc(bytes);
+	if (vbuf == NULL)
+		return NULL;
+
+	if (setvbuf(stream, vbuf, _IOFBF, bytes) != 0) {
+		free(vbuf);
+		return NULL;
+	}
+
+	return vbuf;
+
+}
+
+/*    #rows  ,   #count ޣ
+ *  #ss ,      ,  
+ *   .    
+ * .
+ */
+size_t freadsmp_rows(void *buf, size_t ss, size_t count, size_t rows, FILE *stream, int neg) {
+
+	size_t rd;
+
+	rd = fread(buf, ss*count, rows, stream);
+	if (neg)
+		invertsmp(buf, ss, count*rd);
+
+	return rd;
+
+}
+
+/*    #rows  ,   #count ޣ
+ *  #ss ,      ,  
+ *    (   ).
+ *     .
+ */
+size_t fwritesmp_rows(void *buf, size_t ss, size_t count, size_t rows, FILE *stream, int neg) {
+
+	if (neg)
+		invertsmp(buf, ss, count*rows);
+
+	return fwrite(buf, ss*count, rows, stream);
+
+}
@@ -96,4 +96,14 @@ void invertsmp(void *buf, size_t ss, size_t count);
 size_t freadsmp(void *buf, size_t ss, size_t count, FILE *stream, int neg); 
 size_t fwritesmp(void *buf, size_t ss, size_t count, FILE *stream, int neg, void *outbuf);
 
+/* ߣ   ,     
+ * ,  . */
+#define SMP_BATCH_BYTES (256*1024)
+
+/*      . */
+size_t smp_batch_rows(size_t ss, size_t count, size_t height, size_t rows);
+void *set_smp_transport(FILE *stream, size_t bytes);
+size_t freadsmp_rows(void *buf, size_t ss, size_t count, size_t rows, FILE *stream, int neg);
+size_t fwritesmp_rows(void *buf, size_t ss, size_t count, size_t rows, FILE *stream, int neg);
+
 
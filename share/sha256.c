@@ -0,0 +1,176 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*  - SHA-256 (FIPS 180-4). */
+
+#include <string.h>
+#include "sha256.h"
+
+/*  . */
+static const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/*     64 . */
+static void
+sha256_block( struct sha256 *s, const unsigned char *p )
+{
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for ( i = 0; i < 16; i++ ) {
+		w[i] = (uint32_t) p[4*i] << 24 | (uint32_t) p[4*i+1] << 16 |
+			(uint32_t) p[4*i+2] << 8 | p[4*i+3];
+	}
+	for ( ; i < 64; i++ ) {
+		w[i] = w[i-16] + w[i-7] +
+			(ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^ (w[i-15] >> 3)) +
+			(ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^ (w[i-2] >> 10));
+	}
+
+	a = s->h[0]; b = s->h[1]; c = s->h[2]; d = s->h[3];
+	e = s->h[4]; f = s->h[5]; g = s->h[6]; h = s->h[7];
+
+	for ( i = 0; i < 64; i++ ) {
+		t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) +
+			((e & f) ^ (~e & g)) + K[i] + w[i];
+		t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) +
+			((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	s->h[0] += a; s->h[1] += b; s->h[2] += c; s->h[3] += d;
+	s->h[4] += e; s->h[5] += f; s->h[6] += g; s->h[7] += h;
+}
+
+void
+sha256_init( struct sha256 *s )
+{
+	s->h[0] = 0x6a09e667; s->h[1] = 0xbb67ae85;
+	s->h[2] = 0x3c6ef372; s->h[3] = 0xa54ff53a;
+	s->h[4] = 0x510e527f; s->h[5] = 0x9b05688c;
+	s->h[6] = 0x1f83d9ab; s->h[7] = 0x5be0cd19;
+	s->len = 0;
+}
+
+void
+sha256_update( struct sha256 *s, const void *data, size_t len )
+{
+	const unsigned char *p = data;
+	size_t fill = s->len % 64;
+	size_t n;
+
+	s->len += len;
+
+	/*   . */
+	if ( fill ) {
+		n = 64 - fill < len ? 64 - fill : len;
+		memcpy( s->buf + fill, p, n );
+		p += n;
+		len -= n;
+		if ( fill + n < 64 ) return;
+		sha256_block( s, s->buf );
+	}
+
+	/*     . */
+	for ( ; len >= 64; p += 64, len -= 64 ) {
+		sha256_block( s, p );
+	}
+
+	memcpy( s->buf, p, len );
+}
+
+void
+sha256_final( struct sha256 *s, unsigned char digest[SHA256_SIZE] )
+{
+	uint64_t bits = s->len * 8;
+	size_t fill = s->len % 64;
+	int i;
+
+	/* :  1,      . */
+	s->buf[fill++] = 0x80;
+	if ( fill > 56 ) {
+		memset( s->buf + fill, 0, 64 - fill );
+		sha256_block( s, s->buf );
+		fill = 0;
+	}
+	memset( s->buf + fill, 0, 56 - fill );
+	for ( i = 0; i < 8; i++ ) {
+		s->buf[63 - i] = (unsigned char) (bits >> (8 * i));
+	}
+	sha256_block( s, s->buf );
+
+	for ( i = 0; i < 8; i++ ) {
+		digest[4*i] = (unsigned char) (s->h[i] >> 24);
+		digest[4*i+1] = (unsigned char) (s->h[i] >> 16);
+		digest[4*i+2] = (unsigned char) (s->h[i] >> 8);
+		digest[4*i+3] = (unsigned char) s->h[i];
+	}
+}
+
+void
+sha256_hex( const unsigned char digest[SHA256_SIZE], char *hex )
+{
+	static const char digits[] = "0123456789abcdef";
+	int i;
+
+	for ( i = 0; i < SHA256_SIZE; i++ ) {
+		hex[2*i] = digits[digest[i] >> 4];
+		hex[2*i+1] = digits[digest[i] & 15];
+	}
+	hex[2*SHA256_SIZE] = '\0';
+}
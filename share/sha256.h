@@ -0,0 +1,80 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __SHA256_H
+#define __SHA256_H
+
+/*  - SHA-256 (FIPS 180-4). */
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*   -  . */
+#define SHA256_SIZE 32
+
+/**
+ *  .
+ */
+struct sha256 {
+	uint32_t h[8];			/*  . */
+	uint64_t len;			/*   . */
+	unsigned char buf[64];	/*   . */
+};
+
+/**
+ *  .
+ */
+void sha256_init( struct sha256 *s );
+
+/**
+ *    #len    #data.
+ */
+void sha256_update( struct sha256 *s, const void *data, size_t len );
+
+/**
+ *      -  #digest.
+ */
+void sha256_final( struct sha256 *s, unsigned char digest[SHA256_SIZE] );
+
+/**
+ *   #digest      #hex
+ *    2*SHA256_SIZE+1 .
+ */
+void sha256_hex( const unsigned char digest[SHA256_SIZE], char *hex );
+
+#endif /* __SHA256_H */
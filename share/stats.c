@@ -0,0 +1,151 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*      . */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "system.h"
+#include "misc.h"
+#include "stats.h"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/**
+ *      .
+ */
+double
+stats_now()
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if ( clock_gettime( CLOCK_MONOTONIC, &ts ) == 0 )
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday( &tv, NULL );
+		return tv.tv_sec + tv.tv_usec / 1e6;
+	}
+}
+
+/**
+ *         0,
+ *      .
+ */
+double
+stats_thread_cpu()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	struct timespec ts;
+
+	if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) == 0 )
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+	return 0;
+}
+
+/**
+ *        (#user)
+ *   (#sys)  .    #children, 
+ *   ۣ  .
+ */
+void
+stats_rusage( int children, double *user, double *sys )
+{
+	struct rusage ru;
+
+	memset( &ru, 0, sizeof(ru) );
+	getrusage( children ? RUSAGE_CHILDREN : RUSAGE_SELF, &ru );
+	*user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+	*sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/**
+ *   #t.   ,  
+ *  #with_cpu.
+ */
+void
+stats_timer_init( struct stats_timer *t, int with_cpu )
+{
+	memset( t, 0, sizeof(*t) );
+	t->with_cpu = with_cpu;
+}
+
+/**
+ *    .
+ */
+void
+stats_timer_start( struct stats_timer *t )
+{
+	t->wall0 = stats_now();
+	if ( t->with_cpu )
+		t->cpu0 = stats_thread_cpu();
+}
+
+/**
+ *         .
+ */
+void
+stats_timer_stop( struct stats_timer *t )
+{
+	t->wall += stats_now() - t->wall0;
+	if ( t->with_cpu )
+		t->cpu += stats_thread_cpu() - t->cpu0;
+}
+
+/**
+ *        #fidx, 
+ *  #pid.   .
+ */
+char *
+get_stats_file_name( pid_t pid, int fidx )
+{
+	char str[MAXLINE];
+
+#ifndef __MINGW32__
+	snprintf( str, sizeof(str), "%s/%u.%u.stats", P_tmpdir, pid, fidx );
+#else
+	snprintf( str, sizeof(str), "%s\\%u.%u.stats", P_tmpdir, pid, fidx );
+#endif
+
+	return strdup( str );
+}
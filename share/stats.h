@@ -0,0 +1,98 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+#ifndef __STATS_H
+#define __STATS_H
+
+/*      . */
+
+#include <sys/types.h>
+
+/**
+ *   .    ,
+ *    #cpu,    .
+ */
+struct stats_timer {
+	double wall;	/*   , . */
+	double cpu;		/*   , . */
+	double wall0;	/*   . */
+	double cpu0;
+	int with_cpu;	/*    . */
+};
+
+/**
+ *      .
+ */
+double stats_now();
+
+/**
+ *         0,
+ *      .
+ */
+double stats_thread_cpu();
+
+/**
+ *        (#user)
+ *   (#sys)  .    #children, 
+ *   ۣ  .
+ */
+void stats_rusage( int children, double *user, double *sys );
+
+/**
+ *   #t.   ,  
+ *  #with_cpu.
+ */
+void stats_timer_init( struct stats_timer *t, int with_cpu );
+
+/**
+ *    .
+ */
+void stats_timer_start( struct stats_timer *t );
+
+/**
+ *         .
+ */
+void stats_timer_stop( struct stats_timer *t );
+
+/**
+ *        #fidx, 
+ *  #pid.   .
+ */
+char *get_stats_file_name( pid_t pid, int fidx );
+
+#endif /* __STATS_H */
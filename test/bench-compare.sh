@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Compares two result files written by bench.sh. For every case the
+# best (minimal) wall time of the runs is taken; cases slower than
+# the threshold are reported as regressions and make the script exit
+# with a non-zero status.
+#
+# Usage: bench-compare.sh BASE.tsv NEW.tsv [THRESHOLD]
+#
+# THRESHOLD is the relative change to report, default 0.05 (5%).
+
+BASE=${1:?Usage: $0 BASE.tsv NEW.tsv [THRESHOLD]}
+NEW=${2:?Usage: $0 BASE.tsv NEW.tsv [THRESHOLD]}
+THRESHOLD=${3:-0.05}
+
+awk -F '\t' -v thr="$THRESHOLD" '
+FNR == 1 { next }
+{
+    key = $2 "\t" $3 "\t" $4 "\t" $5 "\t" $6
+    if (FILENAME == ARGV[1]) {
+	if (!(key in base) || $8 < base[key]) base[key] = $8
+    } else {
+	if (!(key in new)) order[n++] = key
+	if (!(key in new) || $8 < new[key]) new[key] = $8
+    }
+}
+END {
+    printf "stage\tformat\tpattern\tmode\tmpix\tbase\tnew\tratio\tverdict\n"
+    bad = 0
+    for (i = 0; i < n; i++) {
+	key = order[i]
+	if (!(key in base)) {
+	    printf "%s\t-\t%.6f\t-\tnew\n", key, new[key]
+	    continue
+	}
+	ratio = base[key] > 0 ? new[key] / base[key] : 1
+	verdict = "same"
+	if (ratio > 1 + thr) { verdict = "SLOWER"; bad++ }
+	else if (ratio < 1 - thr) verdict = "faster"
+	printf "%s\t%.6f\t%.6f\t%.3f\t%s\n", key, base[key], new[key], ratio, verdict
+    }
+    exit bad > 0
+}' "$BASE" "$NEW"
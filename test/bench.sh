@@ -0,0 +1,117 @@
+#!/bin/sh
+#
+# Benchmark runner: times engrave end to end and each filter
+# standalone on synthetic images and appends the results to a
+# tab-separated file that can be compared between builds with
+# bench-compare.sh.
+#
+# Usage: bench.sh RESULTS.tsv
+#
+# The set of cases is controlled by the environment:
+#   BENCH_SIZES     image sizes in megapixels (default "1")
+#   BENCH_PATTERNS  synth patterns (default "gradient lines text noise flat")
+#   BENCH_MODES     "gray" and/or "cmyk" (default "gray cmyk")
+#   BENCH_FORMATS   engrave output formats (default "eps tiff pdf")
+#   BENCH_FILTERS   filters to time standalone (default "tile32 ct")
+#   BENCH_REPEAT    runs per case (default 3)
+#   BENCH_IMAGES    directory for the generated images (default "images")
+#   BENCH_LABEL     build label written to each row
+#   ENGRAVE, FILTERS, PSDIR, SYNTH  locations of the programs
+
+set -e
+
+RESULTS=${1:?Usage: $0 RESULTS.tsv}
+
+: ${BENCH_SIZES:=1}
+: ${BENCH_PATTERNS:=gradient lines text noise flat}
+: ${BENCH_MODES:=gray cmyk}
+: ${BENCH_FORMATS:=eps tiff pdf}
+: ${BENCH_FILTERS:=tile32 ct}
+: ${BENCH_REPEAT:=3}
+: ${BENCH_IMAGES:=images}
+: ${BENCH_LABEL:=$(git describe --always --dirty 2>/dev/null || echo build)}
+: ${ENGRAVE:=../bin/engrave}
+: ${FILTERS:=../filters}
+: ${PSDIR:=../filters}
+: ${SYNTH:=./synth}
+RES=300
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/bench.XXXXXX")
+trap 'rm -rf "$WORK"; rm -f /tmp/$$.[0-9].*' EXIT
+
+mkdir -p "$BENCH_IMAGES"
+if [ ! -s "$RESULTS" ]; then
+    printf 'label\tstage\tformat\tpattern\tmode\tmpix\trun\twall\tuser\tsys\n' > "$RESULTS"
+fi
+
+# Prints the value of a numeric field from a JSON line or a
+# "key value" stats file.
+json_field() {
+    sed -n 's/^{.*"'"$1"'":\([0-9.eE+-]*\).*$/\1/p' "$2" | head -n 1
+}
+stats_field() {
+    sed -n 's/^'"$1"' //p' "$2" | head -n 1
+}
+
+# Appends a row to the results.
+record() {
+    printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' \
+	   "$BENCH_LABEL" "$@" >> "$RESULTS"
+}
+
+for mp in $BENCH_SIZES; do
+    # 4:3 image with the given number of megapixels.
+    W=$(awk "BEGIN { printf \"%d\", sqrt($mp * 1e6 * 4 / 3) }")
+    H=$(awk "BEGIN { printf \"%d\", $mp * 1e6 / $W }")
+    for pattern in $BENCH_PATTERNS; do
+	for mode in $BENCH_MODES; do
+	    case $mode in
+		cmyk) cflag=-c ;;
+		*) cflag= ;;
+	    esac
+	    base=$BENCH_IMAGES/$pattern-$mode-${mp}mp
+	    # The generator is deterministic, so images are reused.
+	    [ -s "$base.tif" ] ||
+		"$SYNTH" -p $pattern -W $W -H $H -r $RES $cflag -o "$base.tif"
+	    [ -s "$base.raw" ] ||
+		"$SYNTH" -p $pattern -W $W -H $H -r $RES $cflag -R -o "$base.raw"
+
+	    for fmt in $BENCH_FORMATS; do
+		run=1
+		while [ $run -le $BENCH_REPEAT ]; do
+		    "$ENGRAVE" --stats=json -t $fmt -o"$WORK/out.$fmt" \
+			       -F "$FILTERS" -P "$PSDIR" -f tile32 -f ct \
+			       "$base.tif" 2> "$WORK/engrave.err" ||
+			{ cat "$WORK/engrave.err" >&2; exit 1; }
+		    grep '^{' "$WORK/engrave.err" > "$WORK/engrave.json"
+		    record engrave $fmt $pattern $mode $mp $run \
+			   $(json_field wall "$WORK/engrave.json") \
+			   $(awk "BEGIN { print $(json_field user "$WORK/engrave.json") + $(json_field children_user "$WORK/engrave.json") }") \
+			   $(awk "BEGIN { print $(json_field sys "$WORK/engrave.json") + $(json_field children_sys "$WORK/engrave.json") }")
+		    rm -f "$WORK/out.$fmt"
+		    run=$((run + 1))
+		done
+	    done
+
+	    # The filters only produce EPS or TIFF layers (PDF output is
+	    # assembled from TIFF layers by engrave).
+	    for fmt in $BENCH_FORMATS; do
+		[ $fmt = pdf ] && continue
+		for f in $BENCH_FILTERS; do
+		    run=1
+		    while [ $run -le $BENCH_REPEAT ]; do
+			"$FILTERS/$f" -p $$ -i 0 -w $W -h $H -x $RES -y $RES \
+				      -t $fmt $cflag -D -S \
+				      < "$base.raw" > /dev/null
+			st=/tmp/$$.0.stats
+			record $f $fmt $pattern $mode $mp $run \
+			       $(stats_field wall $st) $(stats_field user $st) \
+			       $(stats_field sys $st)
+			rm -f /tmp/$$.0.*
+			run=$((run + 1))
+		    done
+		done
+	    done
+	done
+    done
+done
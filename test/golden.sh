@@ -0,0 +1,115 @@
+#!/bin/sh
+#
+# Golden-output regression harness for the tile32 and ct filters.
+#
+# Usage: golden.sh record DIR   store the decoded filter output in DIR
+#        golden.sh check DIR    compare the current build with DIR
+#
+# The filters are run standalone on the test images and on synthetic
+# images (see synth.c) with EPS output. Their layers are decoded by
+# 'tokens dump' into tile lists (y, x, index, area) and background
+# samples, so changes of the encoders do not count as differences,
+# while any change of a tile decision does. For each differing layer
+# the first mismatching pixel is reported with its 5x5 neighbourhood.
+#
+# Environment:
+#   GOLDEN_IMAGES    test images (default "smp smp_usm Gates gravure test Gates_cmyk")
+#   GOLDEN_PATTERNS  synthetic patterns (default "gradient lines text noise flat")
+#   GOLDEN_MPIX      size of the synthetic images (default 0.25)
+#   TILEOPTS         extra tile32 options
+#   FILTERS, SYNTH, TOKENS  locations of the programs
+
+set -e
+
+MODE=${1:?Usage: $0 record|check DIR}
+DIR=${2:?Usage: $0 record|check DIR}
+
+: ${GOLDEN_IMAGES:=smp smp_usm Gates gravure test Gates_cmyk}
+: ${GOLDEN_PATTERNS:=gradient lines text noise flat}
+: ${GOLDEN_MPIX:=0.25}
+: ${FILTERS:=../filters}
+: ${SYNTH:=./synth}
+: ${TOKENS:=./tokens}
+TESTDIR=$(cd "$(dirname "$0")" && pwd)
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/golden.XXXXXX")
+trap 'rm -rf "$WORK"; rm -f /tmp/$$.[0-9].*' EXIT
+
+case $MODE in
+    record) OUT=$DIR; rm -rf "$OUT"; mkdir -p "$OUT" ;;
+    check) OUT=$WORK/out; mkdir -p "$OUT" ;;
+    *) echo "Usage: $0 record|check DIR" >&2; exit 2 ;;
+esac
+
+# Runs tile32 | ct on image $2 and stores the decoded layers under
+# the name $1.
+run_filters() {
+    name=$1
+    img=$2
+    args=$("$TOKENS" info "$img")
+    "$TOKENS" raw "$img" |
+	"$FILTERS/tile32" -p $$ -i 0 $args -t eps $TILEOPTS |
+	tee "$OUT/$name.bg" |
+	"$FILTERS/ct" -p $$ -i 1 $args -t eps > /dev/null
+    for f in /tmp/$$.[0-9].*; do
+	[ -f "$f" ] || continue
+	suf=${f#/tmp/$$.[0-9].}
+	"$TOKENS" dump "$f" > "$OUT/$name.$suf"
+	rm -f "$f"
+    done
+}
+
+# Collects the images: test TIFFs as they are, synthetic ones are
+# generated (the generator is deterministic).
+images=
+for i in $GOLDEN_IMAGES; do
+    images="$images $i=$TESTDIR/$i.tif"
+done
+for p in $GOLDEN_PATTERNS; do
+    "$SYNTH" -p $p -m $GOLDEN_MPIX -o "$WORK/synth-$p-gray.tif"
+    "$SYNTH" -p $p -m $GOLDEN_MPIX -c -o "$WORK/synth-$p-cmyk.tif"
+    images="$images synth-$p-gray=$WORK/synth-$p-gray.tif"
+    images="$images synth-$p-cmyk=$WORK/synth-$p-cmyk.tif"
+done
+
+for i in $images; do
+    run_filters "${i%%=*}" "${i#*=}"
+done
+
+[ $MODE = record ] && { ls "$OUT" | wc -l | sed 's/$/ golden files recorded/'; exit 0; }
+
+# Comparison with the golden files.
+failed=0
+for i in $images; do
+    name=${i%%=*}
+    img=${i#*=}
+    set -- $("$TOKENS" info "$img")
+    width=$2
+    ss=1
+    [ "$9" = -c ] && ss=4
+    for g in "$DIR/$name".*; do
+	f=${g##*/}
+	if [ ! -f "$OUT/$f" ]; then
+	    echo "$f: missing in the candidate output"
+	    failed=1
+	    continue
+	fi
+	case $f in
+	    *.bg) opts="-b $width:$ss" ;;
+	    *.ct.?) opts="-b $width:1" ;;
+	    *) opts= ;;
+	esac
+	case $f in
+	    *.c) c=0 ;; *.m) c=1 ;; *.y) c=2 ;; *) c=3 ;;
+	esac
+	[ $ss = 1 ] && c=0
+	"$TOKENS" diff -i "$img" -c $c $opts "$g" "$OUT/$f" || failed=1
+    done
+    for f in "$OUT/$name".*; do
+	[ -f "$DIR/${f##*/}" ] ||
+	    { echo "${f##*/}: not in the golden set"; failed=1; }
+    done
+done
+
+[ $failed = 0 ] && echo "Golden output matches"
+exit $failed
@@ -0,0 +1,442 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*     
+ * .
+ *
+ *      ޣ  
+ * (--seed),        
+ *   .  ޣ 
+ *  : 0 -- , 255 -- . 
+ *  ,       
+ * .
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <tiffio.h>
+
+/*  . */
+enum { GRADIENT, LINES, TEXT, NOISE, FLAT };
+
+static const char *pattern_names[] = {
+	"gradient", "lines", "text", "noise", "flat", NULL
+};
+
+/*  . */
+static int pattern = GRADIENT;
+static unsigned long width = 0;
+static unsigned long height = 0;
+static double mpix = 1;
+static int is_cmyk = 0;
+static double res = 300;
+static unsigned int seed = 1;
+static int want_raw = 0;
+static const char *output_name = NULL;
+
+/*        C, M, Y, K ( ). */
+static const double channel_angles[] = { 15, 75, 0, 45 };
+
+/*  5x7     :     5 
+ *  . */
+static const unsigned char font[][7] = {
+	{ 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },	/* 0 */
+	{ 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },	/* 1 */
+	{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },	/* 2 */
+	{ 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },	/* 3 */
+	{ 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },	/* 4 */
+	{ 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },	/* 5 */
+	{ 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },	/* 6 */
+	{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },	/* 7 */
+	{ 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },	/* 8 */
+	{ 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },	/* 9 */
+	{ 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },	/* A */
+	{ 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e },	/* B */
+	{ 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e },	/* C */
+	{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f },	/* E */
+	{ 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },	/* H */
+	{ 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x11 },	/* N */
+	{ 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 },	/* R */
+	{ 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e },	/* S */
+	{ 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },	/* T */
+	{ 0x11, 0x11, 0x11, 0x0a, 0x0a, 0x04, 0x04 },	/* V */
+};
+
+#define FONT_GLYPHS (sizeof(font) / sizeof(font[0]))
+
+/*      . */
+#define GLYPH_SCALE 2
+#define CELL_W (6 * GLYPH_SCALE)
+#define CELL_H (10 * GLYPH_SCALE)
+
+/**
+ * -  ( splitmix).  
+ *  ,   ޣ  
+ *   .
+ */
+static unsigned int
+hash3( unsigned long a, unsigned long b, unsigned long c )
+{
+	unsigned long long z;
+
+	z = seed + 0x9e3779b97f4a7c15ULL * (a + 1);
+	z ^= 0xbf58476d1ce4e5b9ULL * (b + 0x632be59bd9b4e019ULL);
+	z ^= 0x94d049bb133111ebULL * (c + 0x2545f4914f6cdd1dULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return (unsigned int) (z ^ (z >> 31));
+}
+
+/*   ޣ  0 - 255. */
+static unsigned char
+clamp( double v )
+{
+	if ( v < 0 ) return 0;
+	if ( v > 255 ) return 255;
+	return (unsigned char) (v + 0.5);
+}
+
+/**
+ *     , ף   ,
+ *    .
+ */
+static unsigned char
+gradient_sample( unsigned long x, unsigned long y, int ch, double a )
+{
+	double u, dx, dy, r;
+
+	u = (x * cos( a ) + y * sin( a )) / (width + height);
+	dx = (double) x / width - 0.5;
+	dy = (double) y / height - 0.5;
+	r = sqrt( dx*dx + dy*dy );
+
+	return clamp( 255 * (0.75 * fabs( u ) + 0.25 * r * 1.4) );
+}
+
+/**
+ *  :     1  2 ޣ 
+ * ң ,      
+ * .
+ */
+static unsigned char
+lines_sample( unsigned long x, unsigned long y, int ch )
+{
+	unsigned long band = x * 4 / width;
+	unsigned long o = ch * 3;
+
+	switch ( band ) {
+	case 0:
+		return (x + o) % 12 == 0 ? 255 : 0;
+	case 1:
+		return (y + o) % 12 == 0 ? 255 : 0;
+	case 2:
+		return (x + y + o) % 17 == 0 ? 255 : 0;
+	default:
+		return (x + height - y % height + o) % 17 < 2 ? 255 : 0;
+	}
+}
+
+/**
+ * :    5x7    . 
+ * 4-    ޣ  
+ *    .
+ */
+static unsigned char
+text_sample( unsigned long x, unsigned long y, int ch )
+{
+	unsigned long cx = x / CELL_W, cy = y / CELL_H;
+	unsigned long gx = (x % CELL_W) / GLYPH_SCALE;
+	unsigned long gy = (y % CELL_H) / GLYPH_SCALE;
+	unsigned int h;
+
+	if ( is_cmyk && ch != 3 ) {
+		return 24 * (ch + 1);
+	}
+
+	/*  ,     . */
+	if ( gx >= 5 || gy < 1 || gy >= 8 ) {
+		return 0;
+	}
+	h = hash3( cx, cy, 0 );
+	if ( h % 7 == 0 ) {
+		return 0;
+	}
+	/*    . */
+	if ( cy % 8 == 7 && cx > (hash3( cy, 0, 1 ) % (width / CELL_W + 1)) ) {
+		return 0;
+	}
+
+	return (font[(h >> 8) % FONT_GLYPHS][gy - 1] >> (4 - gx)) & 1 ? 255 : 0;
+}
+
+/**
+ * ,  :    
+ *  ,    , 
+ *  .
+ */
+static unsigned char
+noise_sample( unsigned long x, unsigned long y, int ch, double a )
+{
+	double u, v, s, tone;
+	const double period = 8;
+
+	u = x * cos( a ) + y * sin( a );
+	v = y * cos( a ) - x * sin( a );
+	s = (cos( 2 * M_PI * u / period ) + cos( 2 * M_PI * v / period )) / 4 + 0.5;
+	tone = (double) (x + y) / (width + height);
+
+	return clamp( (s < tone ? 230 : 25) +
+				  (int) (hash3( x, y, ch ) % 41) - 20 );
+}
+
+/**
+ * :   256x256 ޣ   .
+ */
+static unsigned char
+flat_sample( unsigned long x, unsigned long y, int ch )
+{
+	return hash3( x / 256, y / 256, ch ) & 0xff;
+}
+
+/**
+ *   #y    #row.
+ */
+static void
+fill_row( unsigned char *row, unsigned long y )
+{
+	int spp = is_cmyk ? 4 : 1;
+	unsigned long x;
+	int s, ch;
+	double a;
+
+	for ( x = 0; x < width; x++ ) {
+		for ( s = 0; s < spp; s++ ) {
+			ch = is_cmyk ? s : 3;
+			a = channel_angles[ch] * M_PI / 180;
+			switch ( pattern ) {
+			case GRADIENT:
+				row[x*spp + s] = gradient_sample( x, y, ch, a );
+				break;
+			case LINES:
+				row[x*spp + s] = lines_sample( x, y, ch );
+				break;
+			case TEXT:
+				row[x*spp + s] = text_sample( x, y, ch );
+				break;
+			case NOISE:
+				row[x*spp + s] = noise_sample( x, y, ch, a );
+				break;
+			default:
+				row[x*spp + s] = flat_sample( x, y, ch );
+				break;
+			}
+		}
+	}
+}
+
+/*         . */
+static void
+usage( const char *program_name, int status )
+{
+	fprintf( status ? stderr : stdout, "\
+Usage: %s [OPTIONS] -o FILE\n\
+Generates a synthetic 8-bit image for benchmarking.\n\
+\n\
+  -p, --pattern=NAME  gradient, lines, text, noise or flat\n\
+  -m, --mpix=N        image size in megapixels (4:3), default is 1\n\
+  -W, --width=N       image width (overrides --mpix)\n\
+  -H, --height=N      image height (overrides --mpix)\n\
+  -c, --cmyk          make a CMYK image instead of a grayscale one\n\
+  -r, --res=DPI       resolution, default is 300\n\
+  -s, --seed=N        seed for the pseudo-random parts, default is 1\n\
+  -R, --raw           write raw samples instead of TIFF\n\
+  -o, --output=FILE   output file name ('-' for stdout with --raw)\n\
+", program_name );
+	exit( status );
+}
+
+int
+main( int argc, char **argv )
+{
+	static struct option const long_options[] = {
+		{ "pattern", required_argument, NULL, 'p' },
+		{ "mpix", required_argument, NULL, 'm' },
+		{ "width", required_argument, NULL, 'W' },
+		{ "height", required_argument, NULL, 'H' },
+		{ "cmyk", no_argument, NULL, 'c' },
+		{ "res", required_argument, NULL, 'r' },
+		{ "seed", required_argument, NULL, 's' },
+		{ "raw", no_argument, NULL, 'R' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	unsigned char *row;
+	unsigned long y;
+	size_t rowsize;
+	int spp, c, i;
+	TIFF *tif = NULL;
+	FILE *out = NULL;
+
+	while ( (c = getopt_long( argc, argv, "p:m:W:H:cr:s:Ro:h",
+							  long_options, NULL )) != -1 ) {
+		switch ( c ) {
+		case 'p':
+			for ( i = 0; pattern_names[i] != NULL; i++ ) {
+				if ( strcmp( optarg, pattern_names[i] ) == 0 ) {
+					break;
+				}
+			}
+			if ( pattern_names[i] == NULL ) {
+				fprintf( stderr, "%s: Unknown pattern: %s\n", argv[0], optarg );
+				exit( EXIT_FAILURE );
+			}
+			pattern = i;
+			break;
+		case 'm':
+			mpix = atof( optarg );
+			break;
+		case 'W':
+			width = strtoul( optarg, NULL, 10 );
+			break;
+		case 'H':
+			height = strtoul( optarg, NULL, 10 );
+			break;
+		case 'c':
+			is_cmyk = 1;
+			break;
+		case 'r':
+			res = atof( optarg );
+			break;
+		case 's':
+			seed = strtoul( optarg, NULL, 10 );
+			break;
+		case 'R':
+			want_raw = 1;
+			break;
+		case 'o':
+			output_name = optarg;
+			break;
+		case 'h':
+			usage( argv[0], EXIT_SUCCESS );
+		default:
+			usage( argv[0], EXIT_FAILURE );
+		}
+	}
+
+	if ( output_name == NULL || mpix <= 0 || res <= 0 ) {
+		usage( argv[0], EXIT_FAILURE );
+	}
+
+	/*        4:3. */
+	if ( !width ) {
+		width = height ? (unsigned long) (mpix * 1e6 / height)
+			: (unsigned long) sqrt( mpix * 1e6 * 4 / 3 );
+	}
+	if ( !height ) {
+		height = (unsigned long) (mpix * 1e6 / width);
+	}
+	if ( !width || !height ) {
+		fprintf( stderr, "%s: Image size is zero\n", argv[0] );
+		exit( EXIT_FAILURE );
+	}
+
+	spp = is_cmyk ? 4 : 1;
+	rowsize = width * spp;
+	row = malloc( rowsize );
+	if ( row == NULL ) {
+		fprintf( stderr, "%s: Row buffer allocation failed\n", argv[0] );
+		exit( EXIT_FAILURE );
+	}
+
+	if ( want_raw ) {
+		out = strcmp( output_name, "-" ) ? fopen( output_name, "wb" ) : stdout;
+		if ( out == NULL ) {
+			perror( output_name );
+			exit( EXIT_FAILURE );
+		}
+	} else {
+		/*   4     BigTIFF. */
+		tif = TIFFOpen( output_name,
+						(double) rowsize * height > 4e9 ? "w8" : "w" );
+		if ( tif == NULL ) {
+			exit( EXIT_FAILURE );
+		}
+		TIFFSetField( tif, TIFFTAG_IMAGEWIDTH, (uint32_t) width );
+		TIFFSetField( tif, TIFFTAG_IMAGELENGTH, (uint32_t) height );
+		TIFFSetField( tif, TIFFTAG_BITSPERSAMPLE, 8 );
+		TIFFSetField( tif, TIFFTAG_SAMPLESPERPIXEL, spp );
+		TIFFSetField( tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
+		TIFFSetField( tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE );
+		if ( is_cmyk ) {
+			TIFFSetField( tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_SEPARATED );
+			TIFFSetField( tif, TIFFTAG_INKSET, INKSET_CMYK );
+		} else {
+			TIFFSetField( tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISWHITE );
+		}
+		TIFFSetField( tif, TIFFTAG_XRESOLUTION, (float) res );
+		TIFFSetField( tif, TIFFTAG_YRESOLUTION, (float) res );
+		TIFFSetField( tif, TIFFTAG_RESOLUTIONUNIT, RESUNIT_INCH );
+		TIFFSetField( tif, TIFFTAG_ROWSPERSTRIP,
+					  TIFFDefaultStripSize( tif, 0 ) );
+	}
+
+	for ( y = 0; y < height; y++ ) {
+		fill_row( row, y );
+		if ( want_raw ? fwrite( row, rowsize, 1, out ) != 1
+			 : TIFFWriteScanline( tif, row, y, 0 ) < 0 ) {
+			fprintf( stderr, "%s: Write error at row %lu\n", argv[0], y );
+			exit( EXIT_FAILURE );
+		}
+	}
+
+	if ( want_raw ) {
+		if ( fclose( out ) ) {
+			perror( output_name );
+			exit( EXIT_FAILURE );
+		}
+	} else {
+		TIFFClose( tif );
+	}
+	free( row );
+
+	return 0;
+}
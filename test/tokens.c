@@ -0,0 +1,549 @@
+/*
+ *  engrave --- preparation of image files for adaptive screening
+ *              in a conventional RIP (Raster Image Processor).
+ *
+ *  Copyright (C) 2018 Yuri V. Kouznetsov, Paul A. Wolneykien.
+ *
+ *  This program is free software: you can redistribute it and/or
+ *  modify it under the terms of the GNU Affero General Public License
+ *  as published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public
+ *  License along with this program.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ *  Contact information:
+ *
+ *  The High Definition Screening project:
+ *    <https://github.com/wolneykien/engrave/>.
+ *
+ *  Yuri Kuznetsov <yurivk@mail.ru).
+ *
+ *  Paul Wolneykien <manowar@altlinux.org).
+ *
+ *  The Graphic Arts Department of the
+ *  North-West Institute of Printing of the
+ *  Saint-Petersburg State University of Technology and Design
+ *
+ *  191180 Saint-Petersburg Jambula lane 13.
+ *
+ */
+
+
+/*     .
+ *
+ *  ,     EPS (ASCII-85), 
+ *  :    --   
+ * ,   ,    -- ޣ
+ * .     , 
+ *     ,   
+ *        
+ * ޣ.
+ *
+ *   tokens info IMAGE.tif            
+ *   tokens raw IMAGE.tif          ޣ   stdout
+ *   tokens dump LAYER                stdout
+ *   tokens diff [-i IMAGE.tif -c N] [-b WIDTH:SS] GOLD CAND
+ *                                   ϣ
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tiffio.h>
+
+static const char *program_name;
+
+/*    . */
+struct tile {
+	unsigned long y;
+	unsigned long x;
+	unsigned int idx;
+	unsigned int area;
+};
+
+/**
+ *   #name  ,    
+ *  : 8   ޣ, 1  4 ޣ  .
+ */
+static TIFF *
+open_image( const char *name, uint32_t *width, uint32_t *height,
+			uint16_t *spp )
+{
+	TIFF *tif;
+	uint16_t bps = 8;
+
+	tif = TIFFOpen( name, "r" );
+	if ( tif == NULL ) {
+		exit( EXIT_FAILURE );
+	}
+	TIFFGetField( tif, TIFFTAG_IMAGEWIDTH, width );
+	TIFFGetField( tif, TIFFTAG_IMAGELENGTH, height );
+	TIFFGetFieldDefaulted( tif, TIFFTAG_BITSPERSAMPLE, &bps );
+	TIFFGetFieldDefaulted( tif, TIFFTAG_SAMPLESPERPIXEL, spp );
+	if ( bps != 8 || (*spp != 1 && *spp != 4) ) {
+		fprintf( stderr, "%s: %s: Only 8-bit gray and CMYK images are supported\n",
+				 program_name, name );
+		exit( EXIT_FAILURE );
+	}
+
+	return tif;
+}
+
+/**
+ *   #y  #tif   #row, 
+ * ޣ   CONTIG.  #plane   
+ *  .
+ */
+static void
+read_image_row( TIFF *tif, unsigned char *row, unsigned char *plane,
+				uint32_t width, uint16_t spp, uint32_t y )
+{
+	uint16_t planar = PLANARCONFIG_CONTIG;
+	uint32_t x;
+	uint16_t s;
+
+	TIFFGetFieldDefaulted( tif, TIFFTAG_PLANARCONFIG, &planar );
+	if ( planar == PLANARCONFIG_CONTIG || spp == 1 ) {
+		if ( TIFFReadScanline( tif, row, y, 0 ) < 0 ) {
+			exit( EXIT_FAILURE );
+		}
+		return;
+	}
+	for ( s = 0; s < spp; s++ ) {
+		if ( TIFFReadScanline( tif, plane, y, s ) < 0 ) {
+			exit( EXIT_FAILURE );
+		}
+		for ( x = 0; x < width; x++ ) {
+			row[x*spp + s] = plane[x];
+		}
+	}
+}
+
+/**
+ *       :
+ * ,   ,     
+ * .
+ */
+static int
+cmd_info( const char *name )
+{
+	uint32_t width, height;
+	uint16_t spp, phm = PHOTOMETRIC_MINISBLACK;
+	float xres = 0, yres = 0;
+	TIFF *tif;
+
+	tif = open_image( name, &width, &height, &spp );
+	TIFFGetFieldDefaulted( tif, TIFFTAG_PHOTOMETRIC, &phm );
+	TIFFGetField( tif, TIFFTAG_XRESOLUTION, &xres );
+	TIFFGetField( tif, TIFFTAG_YRESOLUTION, &yres );
+	printf( "-w %u -h %u -x %.2f -y %.2f%s %s\n", width, height,
+			xres > 0 ? xres : 300, yres > 0 ? yres : 300,
+			spp == 4 ? " -c" : "",
+			phm == PHOTOMETRIC_MINISWHITE || phm == PHOTOMETRIC_SEPARATED
+			? "-D" : "-I" );
+	TIFFClose( tif );
+
+	return 0;
+}
+
+/**
+ *  ޣ    .
+ */
+static int
+cmd_raw( const char *name )
+{
+	uint32_t width, height, y;
+	uint16_t spp;
+	unsigned char *row, *plane;
+	TIFF *tif;
+
+	tif = open_image( name, &width, &height, &spp );
+	row = malloc( (size_t) width * spp );
+	plane = malloc( width );
+	if ( row == NULL || plane == NULL ) {
+		fprintf( stderr, "%s: Row buffer allocation failed\n", program_name );
+		exit( EXIT_FAILURE );
+	}
+	for ( y = 0; y < height; y++ ) {
+		read_image_row( tif, row, plane, width, spp, y );
+		if ( fwrite( row, (size_t) width * spp, 1, stdout ) != 1 ) {
+			exit( EXIT_FAILURE );
+		}
+	}
+	free( plane );
+	free( row );
+	TIFFClose( tif );
+
+	return 0;
+}
+
+/*   ASCII-85. */
+struct a85 {
+	FILE *f;
+	unsigned char out[4];
+	int n;			/*    out. */
+	int pos;		/*     out. */
+	int eod;		/*   . */
+};
+
+/**
+ *      -1   .
+ */
+static int
+a85_getc( struct a85 *a )
+{
+	unsigned long code = 0;
+	int c, k = 0;
+
+	if ( a->pos < a->n ) {
+		return a->out[a->pos++];
+	}
+	if ( a->eod ) {
+		return -1;
+	}
+
+	while ( k < 5 ) {
+		c = fgetc( a->f );
+		if ( c == EOF || c == '~' ) {
+			a->eod = 1;
+			break;
+		}
+		if ( c == 'z' && k == 0 ) {
+			code = 0;
+			k = 5;
+			break;
+		}
+		if ( c < '!' || c > 'u' ) {
+			continue;
+		}
+		code = code * 85 + (c - '!');
+		k++;
+	}
+	if ( k < 2 ) {
+		return -1;
+	}
+	/*     . */
+	a->n = k - 1;
+	for ( ; k < 5; k++ ) {
+		code = code * 85 + 84;
+	}
+	a->out[0] = code >> 24;
+	a->out[1] = code >> 16;
+	a->out[2] = code >> 8;
+	a->out[3] = code;
+	a->pos = 0;
+
+	return a->out[a->pos++];
+}
+
+/**
+ *  PostScript-    . 
+ * 1   , 0   ;   
+ * #size   ޣ.
+ */
+static int
+skip_header( FILE *f, const char *name, unsigned long long *size )
+{
+	char line[256];
+	unsigned long w = 0, h = 0;
+
+	while ( fgets( line, sizeof(line), f ) != NULL ) {
+		sscanf( line, " /Width %lu", &w );
+		sscanf( line, " /Height %lu", &h );
+		*size = (unsigned long long) w * h;
+		if ( strncmp( line, "drawtiles", 9 ) == 0 ) {
+			return 1;
+		}
+		if ( strncmp( line, "image", 5 ) == 0 ) {
+			return 0;
+		}
+	}
+	fprintf( stderr, "%s: %s: Not an EPS layer of tile32 or ct\n",
+			 program_name, name );
+	exit( EXIT_FAILURE );
+}
+
+/**
+ *   #name:    "y x  ",
+ *  ޣ --  .
+ */
+static int
+cmd_dump( const char *name )
+{
+	struct a85 a = { NULL, {0}, 0, 0, 0 };
+	unsigned long long size = 0;
+	unsigned long x = 0, y = 0;
+	int b, b1, b2;
+
+	a.f = fopen( name, "r" );
+	if ( a.f == NULL ) {
+		perror( name );
+		exit( EXIT_FAILURE );
+	}
+
+	if ( !skip_header( a.f, name, &size ) ) {
+		/*    ASCII-85 . */
+		while ( size-- && (b = a85_getc( &a )) != -1 ) {
+			putchar( b );
+		}
+		fclose( a.f );
+		return 0;
+	}
+
+	/*    (.  ascii85.c):
+	 *   FF FF FF     --  ;
+	 *   FF FF hi lo  --   hi:lo  ;
+	 *   FF hi lo     -- hi:lo ;
+	 *   00           --  ;
+	 *   idx area     -- . */
+	while ( (b = a85_getc( &a )) != -1 ) {
+		if ( b == 0 ) {
+			x++;
+		} else if ( b == 0xFF ) {
+			b1 = a85_getc( &a );
+			b2 = a85_getc( &a );
+			if ( b1 == 0xFF && b2 == 0xFF ) {
+				break;
+			}
+			if ( b1 == 0xFF ) {
+				y += (b2 << 8) | a85_getc( &a );
+				x = 0;
+			} else {
+				x += (b1 << 8) | b2;
+			}
+		} else {
+			printf( "%lu %lu %d %d\n", y, x, b, a85_getc( &a ) );
+			x++;
+		}
+	}
+	fclose( a.f );
+
+	return 0;
+}
+
+/**
+ *   5x5 ޣ (#x, #y)  #c 
+ * #image_name.
+ */
+static void
+print_neighbourhood( const char *image_name, int c, unsigned long x,
+					 unsigned long y )
+{
+	uint32_t width, height, r;
+	uint16_t spp;
+	unsigned char *row, *plane;
+	long i, j;
+	TIFF *tif;
+
+	tif = open_image( image_name, &width, &height, &spp );
+	if ( spp == 1 ) {
+		c = 0;
+	}
+	row = malloc( (size_t) width * spp );
+	plane = malloc( width );
+	if ( row == NULL || plane == NULL ) {
+		exit( EXIT_FAILURE );
+	}
+
+	printf( "Neighbourhood of (%lu, %lu), channel %d:\n", x, y, c );
+	for ( j = (long) y - 2; j <= (long) y + 2; j++ ) {
+		if ( j < 0 || j >= height ) {
+			continue;
+		}
+		/*     . */
+		for ( r = 0; r <= j; r++ ) {
+			read_image_row( tif, row, plane, width, spp, r );
+		}
+		printf( "%6ld:", j );
+		for ( i = (long) x - 2; i <= (long) x + 2; i++ ) {
+			if ( i < 0 || i >= width ) {
+				printf( "     " );
+			} else {
+				printf( i == x && j == y ? "[%3u]" : " %3u ",
+						row[i*spp + c] );
+			}
+		}
+		printf( "\n" );
+	}
+	free( plane );
+	free( row );
+	TIFFClose( tif );
+}
+
+/*      . */
+static int
+read_tile( FILE *f, struct tile *t )
+{
+	return fscanf( f, "%lu %lu %u %u", &t->y, &t->x, &t->idx, &t->area ) == 4;
+}
+
+/*       . */
+static int
+tile_before( const struct tile *a, const struct tile *b )
+{
+	return a->y < b->y || (a->y == b->y && a->x < b->x);
+}
+
+static FILE *
+open_dump( const char *name )
+{
+	FILE *f = fopen( name, "r" );
+
+	if ( f == NULL ) {
+		perror( name );
+		exit( EXIT_FAILURE );
+	}
+	return f;
+}
+
+/**
+ *    #gold  #cand.  
+ *     #width   ޣ #ss.
+ *    ,   , 
+ *  ޣ.  0  .
+ */
+static int
+cmd_diff( const char *gold, const char *cand, unsigned long width,
+		  int ss, const char *image_name, int c )
+{
+	FILE *fg = open_dump( gold ), *fc = open_dump( cand );
+	struct tile tg, tc;
+	unsigned long long n = 0;
+	unsigned long x = 0, y = 0;
+	int hg, hc, bg, bc, diff = 0;
+
+	if ( width ) {
+		/*    . */
+		for ( ;; n++ ) {
+			bg = fgetc( fg );
+			bc = fgetc( fc );
+			if ( bg == EOF && bc == EOF ) {
+				break;
+			}
+			if ( bg != bc ) {
+				x = (n / ss) % width;
+				y = (n / ss) / width;
+				printf( "%s: background differs at (%lu, %lu), sample %llu: ",
+						gold, x, y, n % ss );
+				printf( bg == EOF ? "gold ends" : "gold %d", bg );
+				printf( bc == EOF ? ", candidate ends\n" : ", candidate %d\n", bc );
+				if ( ss > 1 ) {
+					c = n % ss;
+				}
+				diff = 1;
+				break;
+			}
+		}
+	} else {
+		for ( ;; ) {
+			hg = read_tile( fg, &tg );
+			hc = read_tile( fc, &tc );
+			if ( !hg && !hc ) {
+				break;
+			}
+			if ( hg && hc && memcmp( &tg, &tc, sizeof(tg) ) == 0 ) {
+				continue;
+			}
+			/*   --   . */
+			if ( hg && (!hc || !tile_before( &tc, &tg )) ) {
+				x = tg.x;
+				y = tg.y;
+			} else {
+				x = tc.x;
+				y = tc.y;
+			}
+			printf( "%s: tiles differ at (%lu, %lu): ", gold, x, y );
+			if ( hg && tg.x == x && tg.y == y ) {
+				printf( "gold #%u area %u", tg.idx, tg.area );
+			} else {
+				printf( "gold none" );
+			}
+			if ( hc && tc.x == x && tc.y == y ) {
+				printf( ", candidate #%u area %u\n", tc.idx, tc.area );
+			} else {
+				printf( ", candidate none\n" );
+			}
+			diff = 1;
+			break;
+		}
+	}
+	fclose( fg );
+	fclose( fc );
+
+	if ( diff && image_name != NULL ) {
+		print_neighbourhood( image_name, c, x, y );
+	}
+
+	return diff;
+}
+
+static void
+usage( int status )
+{
+	fprintf( status ? stderr : stdout, "\
+Usage: %s info IMAGE.tif\n\
+       %s raw IMAGE.tif\n\
+       %s dump LAYER\n\
+       %s diff [-i IMAGE.tif -c CHANNEL] [-b WIDTH:SS] GOLD CAND\n",
+			 program_name, program_name, program_name, program_name );
+	exit( status );
+}
+
+int
+main( int argc, char **argv )
+{
+	const char *image_name = NULL;
+	unsigned long width = 0;
+	int ss = 1, c = 0, opt;
+
+	program_name = argv[0];
+	if ( argc < 3 ) {
+		usage( EXIT_FAILURE );
+	}
+
+	if ( strcmp( argv[1], "info" ) == 0 ) {
+		return cmd_info( argv[2] );
+	}
+	if ( strcmp( argv[1], "raw" ) == 0 ) {
+		return cmd_raw( argv[2] );
+	}
+	if ( strcmp( argv[1], "dump" ) == 0 ) {
+		return cmd_dump( argv[2] );
+	}
+	if ( strcmp( argv[1], "diff" ) != 0 ) {
+		usage( EXIT_FAILURE );
+	}
+
+	optind = 2;
+	while ( (opt = getopt( argc, argv, "i:c:b:" )) != -1 ) {
+		switch ( opt ) {
+		case 'i':
+			image_name = optarg;
+			break;
+		case 'c':
+			c = atoi( optarg );
+			break;
+		case 'b':
+			if ( sscanf( optarg, "%lu:%d", &width, &ss ) < 1 || ss < 1 ) {
+				usage( EXIT_FAILURE );
+			}
+			break;
+		default:
+			usage( EXIT_FAILURE );
+		}
+	}
+	if ( argc - optind != 2 ) {
+		usage( EXIT_FAILURE );
+	}
+
+	return cmd_diff( argv[optind], argv[optind + 1], width, ss,
+					 image_name, c );
+}